@@ -311,6 +311,19 @@ void CL_ReadDemoMessage( void ) {
 		return;
 	}
 
+	if ( clc.demoReader ) {
+		MSG_Init( &buf, bufData, sizeof( bufData ) );
+		if ( !Demo_ReadMessage( clc.demoReader, &s, &buf ) ) {
+			CL_DemoCompleted ();
+			return;
+		}
+		clc.serverMessageSequence = s;
+		clc.lastPacketTime = cls.realtime;
+		buf.readcount = 0;
+		CL_ParseServerMessage( &buf );
+		return;
+	}
+
 	// get the sequence number
 	r = FS_Read( &s, 4, clc.demofile);
 	if ( r != 4 ) {
@@ -359,33 +372,35 @@ static void CL_CompleteDemoName( char *args, int argNum )
 	}
 }
 
-// demo <demoname>
-void CL_PlayDemo_f( void ) {
+// opens demos/<arg>, which may leave out the .dm_/.dmz_ extension, and plays it from seekMsec in
+static void CL_StartDemo( const char *arg, int seekMsec ) {
 	char		name[MAX_OSPATH], extension[32];
-	char		*arg;
-
-	if (Cmd_Argc() != 2) {
-		Com_Printf ("demo <demoname>\n");
-		return;
-	}
+	const char	*extensions[] = { "dm", DEMO_INDEXED_EXT };
+	int			i, length = -1, keyframeMsec;
 
 	// make sure a local server is killed
 	// 2 means don't force disconnect of local client
 	Cvar_Set( "sv_killserver", "2" );
 
-	// open the demo file
-	arg = Cmd_Argv(1);
-
 	CL_Disconnect( true );
 
-	Com_sprintf(extension, sizeof(extension), ".dm_%d", PROTOCOL_VERSION);
-	if ( !Q_stricmp( arg + strlen(arg) - strlen(extension), extension ) ) {
+	// open the demo file
+	for ( i = 0 ; i < (int)ARRAY_LEN( extensions ) ; i++ ) {
+		Com_sprintf(extension, sizeof(extension), ".%s_%d", extensions[i], PROTOCOL_VERSION);
+		if ( !Q_stricmp( arg + strlen(arg) - strlen(extension), extension ) ) {
+			break;
+		}
+	}
+	if ( i < (int)ARRAY_LEN( extensions ) ) {
 		Com_sprintf (name, sizeof(name), "demos/%s", arg);
+		length = FS_FOpenFileRead( name, &clc.demofile, true );
 	} else {
-		Com_sprintf (name, sizeof(name), "demos/%s.dm_%d", arg, PROTOCOL_VERSION);
+		for ( i = 0 ; !clc.demofile && i < (int)ARRAY_LEN( extensions ) ; i++ ) {
+			Com_sprintf (name, sizeof(name), "demos/%s.%s_%d", arg, extensions[i], PROTOCOL_VERSION);
+			length = FS_FOpenFileRead( name, &clc.demofile, true );
+		}
 	}
 
-	FS_FOpenFileRead( name, &clc.demofile, true );
 	if (!clc.demofile) {
 		if (!Q_stricmp(arg, "(null)"))
 		{
@@ -397,13 +412,24 @@ void CL_PlayDemo_f( void ) {
 		}
 		return;
 	}
-	Q_strncpyz( clc.demoName, Cmd_Argv(1), sizeof( clc.demoName ) );
+
+	// indexed demos are recognised by their header, whatever the file is called
+	clc.demoReader = Demo_BeginRead( clc.demofile, length );
+	if ( clc.demoReader ) {
+		if ( seekMsec > 0 && ( keyframeMsec = Demo_SeekKeyframe( clc.demoReader, seekMsec ) ) >= 0 ) {
+			Com_Printf( "Playing from %i:%02i.\n", keyframeMsec / 60000, ( keyframeMsec / 1000 ) % 60 );
+		}
+	} else {
+		FS_Seek( clc.demofile, 0, FS_SEEK_SET );
+	}
+	// with the extension of the file that was opened, so demo_seek reopens that same file
+	Q_strncpyz( clc.demoName, name + strlen( "demos/" ), sizeof( clc.demoName ) );
 
 	Con_Close();
 
 	cls.state = CA_CONNECTED;
 	clc.demoplaying = true;
-	Q_strncpyz( cls.servername, Cmd_Argv(1), sizeof( cls.servername ) );
+	Q_strncpyz( cls.servername, arg, sizeof( cls.servername ) );
 
 	// read demo messages until connected
 	while ( cls.state >= CA_CONNECTED && cls.state < CA_PRIMED ) {
@@ -414,6 +440,45 @@ void CL_PlayDemo_f( void ) {
 	clc.firstDemoFrameSkipped = false;
 }
 
+// demo <demoname>
+void CL_PlayDemo_f( void ) {
+	if (Cmd_Argc() != 2) {
+		Com_Printf ("demo <demoname>\n");
+		return;
+	}
+
+	CL_StartDemo( Cmd_Argv( 1 ), 0 );
+}
+
+// demo_seek <seconds|mm:ss>
+// restarts the indexed demo being played from the last keyframe before the given time
+static void CL_SeekDemo_f( void ) {
+	char		demoName[MAX_QPATH];
+	const char	*arg, *colon;
+	int			seconds;
+
+	if ( Cmd_Argc() != 2 ) {
+		Com_Printf( "demo_seek <seconds|mm:ss>\n" );
+		return;
+	}
+	if ( !clc.demoplaying ) {
+		Com_Printf( "Not playing a demo.\n" );
+		return;
+	}
+	if ( !clc.demoReader ) {
+		Com_Printf( "Only indexed (.%s_%d) demos can be seeked.\n", DEMO_INDEXED_EXT, PROTOCOL_VERSION );
+		return;
+	}
+
+	arg = Cmd_Argv( 1 );
+	colon = strchr( arg, ':' );
+	seconds = colon ? atoi( arg ) * 60 + atoi( colon + 1 ) : atoi( arg );
+
+	// the connection is wiped when the demo is reopened, the name includes the extension
+	Q_strncpyz( demoName, clc.demoName, sizeof( demoName ) );
+	CL_StartDemo( demoName, seconds * 1000 );
+}
+
 // Called when a demo or cinematic finishes
 // If the "nextdemo" cvar is set, that command will be issued
 void CL_NextDemo( void ) {
@@ -642,6 +707,10 @@ void CL_Disconnect( bool showMainMenu ) {
 	*clc.downloadTempName = *clc.downloadName = 0;
 	Cvar_Set( "cl_downloadName", "" );
 
+	if ( clc.demoReader ) {
+		Demo_EndRead( clc.demoReader );
+		clc.demoReader = nullptr;
+	}
 	if ( clc.demofile ) {
 		FS_FCloseFile( clc.demofile );
 		clc.demofile = 0;
@@ -2326,6 +2395,7 @@ void CL_Init( void ) {
 	Cmd_AddCommand ("record", CL_Record_f, "Record a demo" );
 	Cmd_AddCommand ("demo", CL_PlayDemo_f, "Playback a demo" );
 	Cmd_SetCommandCompletionFunc( "demo", CL_CompleteDemoName );
+	Cmd_AddCommand ("demo_seek", CL_SeekDemo_f, "Jump to a time in the indexed demo being played" );
 	Cmd_AddCommand ("stoprecord", CL_StopRecord_f, "Stop recording a demo" );
 	Cmd_AddCommand ("configstrings", CL_Configstrings_f, "Prints the configstrings list" );
 	Cmd_AddCommand ("clientinfo", CL_Clientinfo_f, "Prints the userinfo variables" );
@@ -2397,6 +2467,7 @@ void CL_Shutdown( void ) {
 	Cmd_RemoveCommand ("disconnect");
 	Cmd_RemoveCommand ("record");
 	Cmd_RemoveCommand ("demo");
+	Cmd_RemoveCommand ("demo_seek");
 	Cmd_RemoveCommand ("cinematic");
 	Cmd_RemoveCommand ("stoprecord");
 	Cmd_RemoveCommand ("connect");
@@ -2516,6 +2587,7 @@ void CL_ServerInfoPacket( netadr_t from, msg_t *msg ) {
 			{
 				case NA_BROADCAST:
 				case NA_IP:
+				case NA_IP6:
 					type = 1;
 					break;
 
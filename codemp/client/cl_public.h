@@ -27,6 +27,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "cgame/cg_public.h"
 #include "qcommon/q_shared.h"
 #include "qcommon/q_common.h"
+#include "qcommon/com_demo.h"
 #include "qcommon/q_files.h"
 #include "rd-common/tr_public.h"
 #include "sys/sys_public.h"
@@ -186,6 +187,7 @@ struct clientConnection_t {
 	bool	demowaiting;	// don't record until a non-delta message is received
 	bool	firstDemoFrameSkipped;
 	fileHandle_t	demofile;
+	demoReader_t	*demoReader;	// non-null when playing an indexed demo
 
 	int			timeDemoFrames;		// counter of rendered frames
 	int			timeDemoStart;		// cls.realtime before first frame
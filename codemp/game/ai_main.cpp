@@ -901,7 +901,34 @@ int OrgVisibleBox(vec3_t org1, vec3_t mins, vec3_t maxs, vec3_t org2, int ignore
 		trap->Trace(&tr, org1, mins, maxs, org2, ignore, MASK_SOLID, false, 0, 0);
 	}
 
-	if (tr.fraction == 1 && !tr.startsolid && !tr.allsolid)
+	return OrgVisibleBoxResult(&tr);
+}
+
+//the trace OrgVisibleBox would do, for trap->TraceBatch
+void OrgVisibleBoxRequest(traceRequest_t *r, vec3_t org1, vec3_t mins, vec3_t maxs, vec3_t org2, int ignore)
+{
+	VectorCopy(org1, r->start);
+	VectorCopy(org2, r->end);
+	if (RMG.integer)
+	{
+		VectorClear(r->mins);
+		VectorClear(r->maxs);
+	}
+	else
+	{
+		VectorCopy(mins, r->mins);
+		VectorCopy(maxs, r->maxs);
+	}
+	r->passEntityNum = ignore;
+	r->contentmask = MASK_SOLID;
+	r->capsule = false;
+	r->traceFlags = 0;
+	r->useLod = 0;
+}
+
+int OrgVisibleBoxResult(const trace_t *tr)
+{
+	if (tr->fraction == 1 && !tr->startsolid && !tr->allsolid)
 	{
 		return 1;
 	}
@@ -962,26 +989,46 @@ bool BotPVSCheck( const vec3_t p1, const vec3_t p2 )
 	return trap->InPVS(p1, p2);
 }
 
+#define NEAREST_WP_BATCH 16
+
+struct nearestWP_t {
+	int index;
+	float dist;
+};
+
+static int QDECL NearestWPCompare(const void *a, const void *b)
+{
+	const nearestWP_t *wa = (const nearestWP_t *)a;
+	const nearestWP_t *wb = (const nearestWP_t *)b;
+
+	if (wa->dist != wb->dist)
+	{
+		return (wa->dist < wb->dist) ? -1 : 1;
+	}
+	return wa->index - wb->index;
+}
+
 //get the index to the nearest visible waypoint in the global trail
+//candidates are checked closest first, a few traces at a time
 int GetNearestVisibleWP(vec3_t org, int ignore)
 {
-	int i;
-	float bestdist;
+	static nearestWP_t candidates[MAX_WPARRAY_SIZE];
+	traceRequest_t requests[NEAREST_WP_BATCH];
+	trace_t results[NEAREST_WP_BATCH];
+	int i, j, numCandidates, num;
+	float maxdist;
 	float flLen;
-	int bestindex;
 	vec3_t a, mins, maxs;
 
-	i = 0;
 	if (RMG.integer)
 	{
-		bestdist = 300;
+		maxdist = 300;
 	}
 	else
 	{
-		bestdist = 800;//99999;
+		maxdist = 800;//99999;
 				   //don't trace over 800 units away to avoid GIANT HORRIBLE SPEED HITS ^_^
 	}
-	bestindex = -1;
 
 	mins[0] = -15;
 	mins[1] = -15;
@@ -990,24 +1037,49 @@ int GetNearestVisibleWP(vec3_t org, int ignore)
 	maxs[1] = 15;
 	maxs[2] = 1;
 
-	while (i < gWPNum)
+	numCandidates = 0;
+	for (i = 0; i < gWPNum; i++)
 	{
 		if (gWPArray[i] && gWPArray[i]->inuse)
 		{
 			VectorSubtract(org, gWPArray[i]->origin, a);
 			flLen = VectorLength(a);
 
-			if (flLen < bestdist && (RMG.integer || BotPVSCheck(org, gWPArray[i]->origin)) && OrgVisibleBox(org, mins, maxs, gWPArray[i]->origin, ignore))
+			if (flLen < maxdist && (RMG.integer || BotPVSCheck(org, gWPArray[i]->origin)))
 			{
-				bestdist = flLen;
-				bestindex = i;
+				candidates[numCandidates].index = i;
+				candidates[numCandidates].dist = flLen;
+				numCandidates++;
 			}
 		}
+	}
 
-		i++;
+	qsort(candidates, numCandidates, sizeof(candidates[0]), NearestWPCompare);
+
+	for (i = 0; i < numCandidates; i += NEAREST_WP_BATCH)
+	{
+		num = numCandidates - i;
+		if (num > NEAREST_WP_BATCH)
+		{
+			num = NEAREST_WP_BATCH;
+		}
+
+		for (j = 0; j < num; j++)
+		{
+			OrgVisibleBoxRequest(&requests[j], org, mins, maxs, gWPArray[candidates[i + j].index]->origin, ignore);
+		}
+		trap->TraceBatch(results, requests, num);
+
+		for (j = 0; j < num; j++)
+		{
+			if (OrgVisibleBoxResult(&results[j]))
+			{
+				return candidates[i + j].index;
+			}
+		}
 	}
 
-	return bestindex;
+	return -1;
 }
 
 //wpDirection
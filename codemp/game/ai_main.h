@@ -313,6 +313,7 @@ int GetBestIdleGoal(bot_state_t* bs);
 int GetNearestVisibleWP(vec3_t org, int ignore);
 int NumBots(void);
 int OrgVisibleBox(vec3_t org1, vec3_t mins, vec3_t maxs, vec3_t org2, int ignore);
+int OrgVisibleBoxResult(const trace_t* tr);
 int PassLovedOneCheck(bot_state_t* bs, gentity_t* ent);
 void B_Free(void* ptr);
 void B_TempFree(int size);
@@ -320,6 +321,7 @@ void BotResetState(bot_state_t* bs);
 void BotUtilizePersonality(bot_state_t* bs);
 void BotWaypointRender(void);
 void LoadPath_ThisLevel(void);
+void OrgVisibleBoxRequest(traceRequest_t* r, vec3_t org1, vec3_t mins, vec3_t maxs, vec3_t org2, int ignore);
 void StandardBotAI(bot_state_t* bs, float thinktime);
 void* B_Alloc(int size);
 void* B_TempAlloc(int size);
@@ -1522,11 +1522,25 @@ int CanForceJumpTo(int baseindex, int testingindex, float distance)
 	}
 }
 
+#define PATH_TRACE_BATCH 16
+
+struct pathCandidate_t {
+	int num;
+	float dist;
+	int forceJumpable;
+	int request; //index into the trace batch, -1 if no trace is needed
+};
+
 void CalculatePaths(void)
 {
 	int i;
 	int c;
+	int j;
 	int forceJumpable;
+	int numPending, numRequests;
+	pathCandidate_t pending[PATH_TRACE_BATCH];
+	traceRequest_t requests[PATH_TRACE_BATCH];
+	trace_t results[PATH_TRACE_BATCH];
 	int maxNeighborDist = MAX_NEIGHBOR_LINK_DISTANCE;
 	float nLDist;
 	vec3_t a;
@@ -1576,22 +1590,50 @@ void CalculatePaths(void)
 		{
 			c = 0;
 
-			while (c < gWPNum)
-			{
-				if (gWPArray[c] && gWPArray[c]->inuse && i != c &&
-					NotWithinRange(i, c))
+			while (c < gWPNum && gWPArray[i]->neighbornum < MAX_NEIGHBOR_SIZE)
+			{ //gather a chunk of candidates, then do their visibility traces in one batch
+				numPending = 0;
+				numRequests = 0;
+
+				while (c < gWPNum && numPending < PATH_TRACE_BATCH)
 				{
-					VectorSubtract(gWPArray[i]->origin, gWPArray[c]->origin, a);
+					if (gWPArray[c] && gWPArray[c]->inuse && i != c &&
+						NotWithinRange(i, c))
+					{
+						VectorSubtract(gWPArray[i]->origin, gWPArray[c]->origin, a);
 
-					nLDist = VectorLength(a);
-					forceJumpable = CanForceJumpTo(i, c, nLDist);
+						pending[numPending].num = c;
+						pending[numPending].dist = VectorLength(a);
+						pending[numPending].forceJumpable = CanForceJumpTo(i, c, pending[numPending].dist);
+						pending[numPending].request = -1;
+
+						if (!pending[numPending].forceJumpable &&
+							pending[numPending].dist < maxNeighborDist &&
+							(int)gWPArray[i]->origin[2] == (int)gWPArray[c]->origin[2])
+						{
+							pending[numPending].request = numRequests;
+							OrgVisibleBoxRequest(&requests[numRequests], gWPArray[i]->origin, mins, maxs, gWPArray[c]->origin, ENTITYNUM_NONE);
+							numRequests++;
+						}
+						numPending++;
+					}
+					c++;
+				}
+
+				if (numRequests)
+				{
+					trap->TraceBatch(results, requests, numRequests);
+				}
+
+				for (j = 0; j < numPending; j++)
+				{
+					nLDist = pending[j].dist;
+					forceJumpable = pending[j].forceJumpable;
 
-					if ((nLDist < maxNeighborDist || forceJumpable) &&
-						((int)gWPArray[i]->origin[2] == (int)gWPArray[c]->origin[2] || forceJumpable) &&
-						(OrgVisibleBox(gWPArray[i]->origin, mins, maxs, gWPArray[c]->origin, ENTITYNUM_NONE) || forceJumpable))
+					if (forceJumpable || (pending[j].request >= 0 && OrgVisibleBoxResult(&results[pending[j].request])))
 					{
-						gWPArray[i]->neighbors[gWPArray[i]->neighbornum].num = c;
-						if (forceJumpable && ((int)gWPArray[i]->origin[2] != (int)gWPArray[c]->origin[2] || nLDist < maxNeighborDist))
+						gWPArray[i]->neighbors[gWPArray[i]->neighbornum].num = pending[j].num;
+						if (forceJumpable && ((int)gWPArray[i]->origin[2] != (int)gWPArray[pending[j].num]->origin[2] || nLDist < maxNeighborDist))
 						{
 							gWPArray[i]->neighbors[gWPArray[i]->neighbornum].forceJumpTo = 999;//forceJumpable; //FJSR
 						}
@@ -1607,7 +1649,6 @@ void CalculatePaths(void)
 						break;
 					}
 				}
-				c++;
 			}
 		}
 		i++;
@@ -915,7 +915,7 @@ void Q3_RemoveEnt( gentity_t *victim )
 		victim->s.eType = ET_INVISIBLE;
 		victim->contents = 0;
 		victim->health = 0;
-		victim->targetname = nullptr;
+		G_SetTargetname( victim, nullptr );
 
 		if ( victim->NPC && victim->NPC->tempGoal != nullptr )
 		{
@@ -2151,11 +2151,11 @@ static void Q3_SetTargetName (int entID, const char *targetname)
 
 	if(!Q_stricmp("NULL", ((char *)targetname)))
 	{
-		self->targetname = nullptr;
+		G_SetTargetname( self, nullptr );
 	}
 	else
 	{
-		self->targetname = G_NewString( targetname );
+		G_SetTargetname( self, G_NewString( targetname ) );
 	}
 }
 
@@ -119,7 +119,7 @@ Targets will be fired when someone spawns in on them.
 equivelant to info_player_deathmatch
 */
 void SP_info_player_start(gentity_t *ent) {
-	ent->classname = "info_player_deathmatch";
+	G_SetClassname( ent, "info_player_deathmatch" );
 	SP_info_player_deathmatch( ent );
 }
 
@@ -822,7 +822,7 @@ void InitBodyQue (void) {
 	level.bodyQueIndex = 0;
 	for (i=0; i<BODY_QUEUE_SIZE ; i++) {
 		ent = G_Spawn();
-		ent->classname = "bodyque";
+		G_SetClassname( ent, "bodyque" );
 		ent->neverFree = true;
 		level.bodyQue[i] = ent;
 	}
@@ -1903,7 +1903,7 @@ char *ClientConnect( int clientNum, bool firstTime, bool isBot ) {
 	ent = &g_entities[ clientNum ];
 
 	ent->s.number = clientNum;
-	ent->classname = "connecting";
+	G_SetClassname( ent, "connecting" );
 
 	trap->GetUserinfo( clientNum, userinfo, sizeof( userinfo ) );
 
@@ -2615,7 +2615,7 @@ void ClientSpawn(gentity_t *ent) {
 	ent->playerState = &ent->client->ps;
 	ent->takedamage = true;
 	ent->inuse = true;
-	ent->classname = "player";
+	G_SetClassname( ent, "player" );
 	ent->r.contents = CONTENTS_BODY;
 	ent->clipmask = MASK_PLAYERSOLID;
 	ent->die = player_die;
@@ -3109,7 +3109,7 @@ void ClientDisconnect( int clientNum ) {
 	trap->UnlinkEntity ((sharedEntity_t *)ent);
 	ent->s.modelindex = 0;
 	ent->inuse = false;
-	ent->classname = "disconnected";
+	G_SetClassname( ent, "disconnected" );
 	ent->client->pers.connected = CON_DISCONNECTED;
 	ent->client->ps.persistant[PERS_TEAM] = TEAM_FREE;
 	ent->client->sess.sessionTeam = TEAM_FREE;
@@ -282,7 +282,7 @@ void G_Give( gentity_t *ent, const char *name, const char *args, int argc )
 
 		it_ent = G_Spawn();
 		VectorCopy( ent->r.currentOrigin, it_ent->s.origin );
-		it_ent->classname = it->classname;
+		G_SetClassname( it_ent, it->classname );
 		G_SpawnItem( it_ent, it );
 		if ( !it_ent || !it_ent->inuse )
 			return;
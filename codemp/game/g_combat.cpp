@@ -2673,7 +2673,7 @@ void G_Dismember( gentity_t *ent, gentity_t *enemy, vec3_t point, int limbType,
 
 	VectorCopy( point, newPoint );
 	limb = G_Spawn();
-	limb->classname = "playerlimb";
+	G_SetClassname( limb, "playerlimb" );
 
 	/*
 	if (limbType == G2_MODELPART_WAIST)
@@ -426,7 +426,7 @@ bool PlaceShield(gentity_t *playerent)
 
 			shield->s.eType = ET_SPECIAL;
 			shield->s.modelindex =  HI_SHIELD;	// this'll be used in CG_Useable() for rendering.
-			shield->classname = shieldItem->classname;
+			G_SetClassname( shield, shieldItem->classname );
 
 			shield->r.contents = CONTENTS_TRIGGER;
 
@@ -1022,7 +1022,7 @@ void ItemUse_Sentry( gentity_t *ent )
 
 	sentry = G_Spawn();
 
-	sentry->classname = "sentryGun";
+	G_SetClassname( sentry, "sentryGun" );
 	sentry->s.modelindex = G_ModelIndex("models/items/psgun.glm"); //replace ASAP
 
 	sentry->s.g2radius = 30.0f;
@@ -1341,7 +1341,7 @@ void ItemUse_UseDisp(gentity_t *ent, int type)
 
 		eItem = G_Spawn();
 		eItem->r.ownerNum = ent->s.number;
-		eItem->classname = item->classname;
+		G_SetClassname( eItem, item->classname );
 
 		VectorCopy(ent->client->ps.origin, pos);
 		pos[2] += ent->client->ps.viewheight;
@@ -1589,7 +1589,7 @@ void EWebFire(gentity_t *owner, gentity_t *eweb)
 	//create the missile
 	missile = CreateMissile( bPoint, d, 1200.0f, 10000, owner, false );
 
-	missile->classname = "generic_proj";
+	G_SetClassname( missile, "generic_proj" );
 	missile->s.weapon = WP_TURRET;
 
 	missile->damage = EWEB_MISSILE_DAMAGE;
@@ -2474,7 +2474,7 @@ gentity_t *LaunchItem( gitem_t *item, vec3_t origin, vec3_t velocity ) {
 	}
 	dropped->s.modelindex2 = 1; // This is non-zero is it's a dropped item
 
-	dropped->classname = item->classname;
+	G_SetClassname( dropped, item->classname );
 	dropped->item = item;
 	VectorSet (dropped->r.mins, -ITEM_RADIUS, -ITEM_RADIUS, -ITEM_RADIUS);
 	VectorSet (dropped->r.maxs, ITEM_RADIUS, ITEM_RADIUS, ITEM_RADIUS);
@@ -835,7 +835,11 @@ char            *G_GetBotInfoByNumber                ( int num );
 int              G_GetHitLocation                    ( gentity_t *target, vec3_t ppoint );
 const char      *G_GetStringEdString                 ( char *refSection, char *refName );
 int              G_IconIndex                         ( const char* name );
+void             G_IndexEntityNames                  ( gentity_t *ent );
 void             G_InitBots                          ( void );
+void             G_InitConfigstringIndexes           ( void );
+void             G_InitEntityFreeList                ( void );
+void             G_InitEntityIndex                   ( void );
 void             G_InitGentity                       ( gentity_t *e );
 void             G_InitMemory                        ( void );
 void             G_InitSessionData                   ( gclient_t *client, char *userinfo, bool isBot );
@@ -882,6 +886,7 @@ const char      *G_RefreshNextMap                    ( int gametype, bool forced
 void             G_RegisterCvars                     ( void );
 void             G_RemoveQueuedBotBegin              ( int clientNum );
 void             G_ROFF_NotetrackCallback            ( gentity_t *cent, const char *notetrack );
+void             G_RollEntityStats                   ( void );
 void             G_RunClient                         ( gentity_t *ent );
 void             G_RunExPhys                         ( gentity_t *ent, float gravity, float mass, float bounce, bool autoKill, int *g2Bolts, int numG2Bolts );
 void             G_RunItem                           ( gentity_t *ent );
@@ -895,10 +900,12 @@ void             G_SecurityLogPrintf                 ( const char *fmt, ... );
 void             G_SendG2KillQueue                   ( void );
 void             G_SetAngles                         ( gentity_t *ent, vec3_t angles );
 void             G_SetAnim                           ( gentity_t *ent, usercmd_t *ucmd, int setAnimParts, int anim, int setAnimFlags, int blendTime );
+void             G_SetClassname                      ( gentity_t *ent, const char *classname );
 void             G_SetMovedir                        ( vec3_t angles, vec3_t movedir );
 void             G_SetOrigin                         ( gentity_t *ent, vec3_t origin );
 bool             G_SetSaber                          ( gentity_t *ent, int saberNum, char *saberName );
 void             G_SetStats                          ( gentity_t *ent );
+void             G_SetTargetname                     ( gentity_t *ent, char *targetname );
 void             G_Sound                             ( gentity_t *ent, int channel, int soundIndex );
 void             G_SoundAtLoc                        ( vec3_t loc, int channel, int soundIndex );
 int              G_SoundIndex                        ( const char *name );
@@ -1090,6 +1097,7 @@ bool             StringIsInteger                     ( const char *s );
 void             StopFollowing                       ( gentity_t *ent );
 void             Svcmd_AddBot_f                      ( void );
 void             Svcmd_BotList_f                     ( void );
+void             Svcmd_EntStats_f                    ( void );
 void             Svcmd_GameMem_f                     ( void );
 void             Svcmd_ToggleAllowVote_f             ( void );
 void             Svcmd_ToggleUserinfoValidation_f    ( void );
@@ -86,8 +86,8 @@ void G_FindTeams( void ) {
 
 				// make sure that targets only point at the master
 				if ( e2->targetname ) {
-					e->targetname = e2->targetname;
-					e2->targetname = nullptr;
+					G_SetTargetname( e, e2->targetname );
+					G_SetTargetname( e2, nullptr );
 				}
 			}
 		}
@@ -157,6 +157,7 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 	G_ProcessIPBans();
 
 	G_InitMemory();
+	G_InitConfigstringIndexes();
 
 	// set some level globals
 	memset( &level, 0, sizeof( level ) );
@@ -212,6 +213,8 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 	// initialize all entities for this game
 	memset( g_entities, 0, MAX_GENTITIES * sizeof(g_entities[0]) );
 	level.gentities = g_entities;
+	G_InitEntityIndex();
+	G_InitEntityFreeList();
 
 	// initialize all clients for this game
 	level.maxclients = sv_maxclients.integer;
@@ -229,7 +232,7 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 	level.num_entities = MAX_CLIENTS;
 
 	for ( i=0 ; i<MAX_CLIENTS ; i++ ) {
-		g_entities[i].classname = "clientslot";
+		G_SetClassname( &g_entities[i], "clientslot" );
 	}
 
 	// let the server system know where the entites are
@@ -2444,6 +2447,7 @@ void G_RunFrame( int levelTime ) {
 	}
 
 	level.framenum++;
+	G_RollEntityStats();
 	level.previousTime = level.time;
 	level.time = levelTime;
 
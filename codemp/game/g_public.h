@@ -30,7 +30,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #define Q3_INFINITE			16777216
 
-#define	GAME_API_VERSION	1
+#define	GAME_API_VERSION	2
 
 // entity->svFlags
 // the server does not know how to interpret most of the values
@@ -239,6 +239,19 @@ struct sharedEntity_t {
 	int				next_roff_time; //rww - npc's need to know when they're getting roff'd
 };
 
+// the arguments of one Trace call, for TraceBatch
+struct traceRequest_t {
+	vec3_t	start;
+	vec3_t	mins;				// zero for a point trace
+	vec3_t	maxs;
+	vec3_t	end;
+	int		passEntityNum;
+	int		contentmask;
+	int		capsule;
+	int		traceFlags;
+	int		useLod;
+};
+
 struct T_G_ICARUS_PLAYSOUND {
 	int taskID;
 	int entID;
@@ -402,6 +415,7 @@ struct gameImport_t {
 	void		(*SetServerCull)						( float cullDistance );
 	void		(*SetUserinfo)							( int num, const char *buffer );
 	void		(*Trace)								( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod );
+	void		(*TraceBatch)							( trace_t *results, const traceRequest_t *requests, int count );
 	void		(*TraceEntity)							( trace_t *trace, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int entityNum, int contentmask, int capsule );
 	void		(*UnlinkEntity)							( sharedEntity_t *ent );
 
@@ -264,8 +264,8 @@ void SP_gametype_item ( gentity_t* ent )
 
 		if (item)
 		{
-			ent->targetname = nullptr;
-			ent->classname = item->classname;
+			G_SetTargetname( ent, nullptr );
+			G_SetClassname( ent, item->classname );
 			G_SpawnItem( ent, item );
 		}
 	}
@@ -565,6 +565,7 @@ void G_SpawnGEntityFromSpawnVars( bool inSubBSP ) {
 	for ( i = 0 ; i < level.numSpawnVars ; i++ ) {
 		G_ParseField( level.spawnVars[i][0], level.spawnVars[i][1], ent );
 	}
+	G_IndexEntityNames( ent );
 
 	// check for "notteam" flag (GT_FFA, GT_DUEL)
 	if ( level.gametype >= GT_TEAM ) {
@@ -1102,11 +1103,11 @@ void SP_worldspawn( void )
 
 	g_entities[ENTITYNUM_WORLD].s.number = ENTITYNUM_WORLD;
 	g_entities[ENTITYNUM_WORLD].r.ownerNum = ENTITYNUM_NONE;
-	g_entities[ENTITYNUM_WORLD].classname = "worldspawn";
+	G_SetClassname( &g_entities[ENTITYNUM_WORLD], "worldspawn" );
 
 	g_entities[ENTITYNUM_NONE].s.number = ENTITYNUM_NONE;
 	g_entities[ENTITYNUM_NONE].r.ownerNum = ENTITYNUM_NONE;
-	g_entities[ENTITYNUM_NONE].classname = "nothing";
+	G_SetClassname( &g_entities[ENTITYNUM_NONE], "nothing" );
 
 	// see if we want a warmup time
 	trap->SetConfigstring( CS_WARMUP, "" );
@@ -416,6 +416,7 @@ constexpr svcmd_t svcmds[] = {
 	{ "botlist",                  Svcmd_BotList_f,                  false },
 	{ "entitylist",               Svcmd_EntityList_f,               false },
 	{ "forceteam",                Svcmd_ForceTeam_f,                false },
+	{ "g_entstats",               Svcmd_EntStats_f,                 false },
 	{ "game_memory",              Svcmd_GameMem_f,                  false },
 	{ "listip",                   Svcmd_ListIP_f,                   false },
 	{ "removeip",                 Svcmd_RemoveIP_f,                 false },
@@ -72,21 +72,83 @@ const char *BuildShaderStateConfig(void) {
 
 // model / sound configstring indexes
 
-static int G_FindConfigstringIndex( const char *name, int start, int max, bool create ) {
-	int		i;
-	char	s[MAX_STRING_CHARS];
+// Names are looked up through a hash table instead of reading back every slot through the trap. Only this file
+// sets configstrings in these ranges, so the table is kept in step as names are added. A range is read from the
+// server the first time it's used after G_InitGame, which picks up what survived a map_restart.
+// CS_AMBIENT_SET overlaps CS_MODELS, so everything is kept by configstring number: a slot is in the table once,
+// whichever range read or set it, and both ranges see it as taken, same as the linear scan did.
 
-	if ( !VALIDSTRING( name ) ) {
-		return 0;
+#define CSHASH_SIZE		(1024)
+
+static char	*csNames[MAX_CONFIGSTRINGS];		// by configstring number, from G_Alloc
+static int	csHashNext[MAX_CONFIGSTRINGS];		// next configstring number in the chain, 0 ends it
+static int	csHashTable[CSHASH_SIZE];
+static int	csRangeNext[MAX_CONFIGSTRINGS];		// by range start, no free index below it, 0 until the range is read
+
+// the pool the names live in is reset along with the level
+void G_InitConfigstringIndexes( void ) {
+	memset( csNames, 0, sizeof( csNames ) );
+	memset( csHashNext, 0, sizeof( csHashNext ) );
+	memset( csHashTable, 0, sizeof( csHashTable ) );
+	memset( csRangeNext, 0, sizeof( csRangeNext ) );
+}
+
+// names are case sensitive, same as the strcmp they replace
+static int G_ConfigstringHash( const char *name ) {
+	int hash, i;
+
+	hash = 0;
+	for ( i=0; name[i]; i++ ) {
+		hash += name[i] * (119 + i);
 	}
 
+	hash = (hash ^ (hash >> 10) ^ (hash >> 20)) & (CSHASH_SIZE-1);
+	return hash;
+}
+
+static void G_AddConfigstringIndex( const char *name, int num ) {
+	int hash = G_ConfigstringHash( name );
+
+	csNames[num] = (char *)G_Alloc( strlen( name ) + 1 );
+	strcpy( csNames[num], name );
+	csHashNext[num] = csHashTable[hash];
+	csHashTable[hash] = num;
+}
+
+// Reads in whatever the server already has in the range, names are only ever appended so it stops at the first gap
+static void G_LoadConfigstringRange( int start, int max ) {
+	int		i;
+	char	s[MAX_STRING_CHARS];
+
 	for ( i=1 ; i<max ; i++ ) {
+		if ( csNames[start + i] ) {
+			continue;	// already read through an overlapping range
+		}
 		trap->GetConfigstring( start + i, s, sizeof( s ) );
 		if ( !s[0] ) {
 			break;
 		}
-		if ( !strcmp( s, name ) ) {
-			return i;
+		G_AddConfigstringIndex( s, start + i );
+	}
+
+	csRangeNext[start] = i;
+}
+
+static int G_FindConfigstringIndex( const char *name, int start, int max, bool create ) {
+	int		i, num;
+
+	if ( !VALIDSTRING( name ) ) {
+		return 0;
+	}
+
+	if ( !csRangeNext[start] ) {
+		G_LoadConfigstringRange( start, max );
+	}
+
+	// the chain holds names from every range, only a number inside this one counts
+	for ( num = csHashTable[G_ConfigstringHash( name )] ; num ; num = csHashNext[num] ) {
+		if ( num > start && num < start + max && !strcmp( csNames[num], name ) ) {
+			return num - start;
 		}
 	}
 
@@ -94,11 +156,16 @@ static int G_FindConfigstringIndex( const char *name, int start, int max, bool c
 		return 0;
 	}
 
+	// the lowest free slot, an overlapping range may have taken some since
+	for ( i = csRangeNext[start] ; i < max && csNames[start + i] ; i++ ) {
+	}
 	if ( i == max ) {
 		trap->Error( ERR_DROP, "G_FindConfigstringIndex: overflow" );
 	}
 
 	trap->SetConfigstring( start + i, name );
+	G_AddConfigstringIndex( name, start + i );
+	csRangeNext[start] = i + 1;
 
 	return i;
 }
@@ -170,11 +237,135 @@ void G_TeamCommand( team_e team, char *cmd ) {
 	}
 }
 
-// Searches all active entities for the next one that holds the matching string at fieldofs (use the FOFS() macro) in
-//	the structure.
-// Searches beginning at the entity after from, or the beginning if nullptr
-// nullptr will be returned if the end of the list is reached.
-gentity_t *G_Find (gentity_t *from, int fieldofs, const char *match)
+// Entity name index
+// G_Find on classname or targetname walks a hash chain holding the entities with that name instead of every entity.
+// Chains are kept in entity number order, so matches come back in the same order as a full scan. Names have to be
+// set through G_SetClassname/G_SetTargetname, or parsed at spawn, for the index to see them. g_debugEntityIndex
+// checks every lookup against the full scan.
+
+#define ENTHASH_SIZE	(1024)
+
+struct entityIndex_t {
+	int		fieldofs;
+	int		hashTable[ENTHASH_SIZE];	// lowest entity number on each chain, -1 if empty
+	int		hash[MAX_GENTITIES];		// chain an entity is on, -1 if none
+	int		next[MAX_GENTITIES];
+	int		prev[MAX_GENTITIES];
+};
+
+static entityIndex_t entityIndexes[] = {
+	{ FOFS( classname ) },
+	{ FOFS( targetname ) },
+};
+
+void G_InitEntityIndex( void ) {
+	entityIndex_t	*idx;
+
+	for ( idx = entityIndexes ; idx < entityIndexes + ARRAY_LEN( entityIndexes ) ; idx++ ) {
+		memset( idx->hashTable, -1, sizeof( idx->hashTable ) );
+		memset( idx->hash, -1, sizeof( idx->hash ) );
+	}
+}
+
+static entityIndex_t *G_EntityIndexForField( int fieldofs ) {
+	entityIndex_t	*idx;
+
+	for ( idx = entityIndexes ; idx < entityIndexes + ARRAY_LEN( entityIndexes ) ; idx++ ) {
+		if ( idx->fieldofs == fieldofs ) {
+			return idx;
+		}
+	}
+	return nullptr;
+}
+
+// folds case the same way as Q_stricmp
+static int G_EntityNameHash( const char *name ) {
+	int hash, i;
+
+	hash = 0;
+	for ( i=0; name[i]; i++ ) {
+		if ( name[i] >= 'A' && name[i] <= 'Z' )
+			hash += (name[i] + ('a'-'A')) * (119 + i);
+		else
+			hash += name[i] * (119 + i);
+	}
+
+	hash = (hash ^ (hash >> 10) ^ (hash >> 20)) & (ENTHASH_SIZE-1);
+	return hash;
+}
+
+static void G_UnlinkEntityName( entityIndex_t *idx, int num ) {
+	if ( idx->hash[num] < 0 ) {
+		return;
+	}
+
+	if ( idx->prev[num] >= 0 )
+		idx->next[idx->prev[num]] = idx->next[num];
+	else
+		idx->hashTable[idx->hash[num]] = idx->next[num];
+	if ( idx->next[num] >= 0 )
+		idx->prev[idx->next[num]] = idx->prev[num];
+
+	idx->hash[num] = -1;
+}
+
+// Files the entity under whatever name it has now
+static void G_LinkEntityName( entityIndex_t *idx, gentity_t *ent ) {
+	const char	*name = *(char **)((byte *)ent + idx->fieldofs);
+	int			num = ent - g_entities;
+	int			hash, prev, next;
+
+	G_UnlinkEntityName( idx, num );
+	if ( !name ) {
+		return;
+	}
+
+	hash = G_EntityNameHash( name );
+	prev = -1;
+	for ( next = idx->hashTable[hash] ; next >= 0 && next < num ; next = idx->next[next] ) {
+		prev = next;
+	}
+
+	idx->hash[num] = hash;
+	idx->prev[num] = prev;
+	idx->next[num] = next;
+	if ( prev >= 0 )
+		idx->next[prev] = num;
+	else
+		idx->hashTable[hash] = num;
+	if ( next >= 0 )
+		idx->prev[next] = num;
+}
+
+// For names written straight into the entity, like the spawn fields
+void G_IndexEntityNames( gentity_t *ent ) {
+	entityIndex_t	*idx;
+
+	for ( idx = entityIndexes ; idx < entityIndexes + ARRAY_LEN( entityIndexes ) ; idx++ ) {
+		G_LinkEntityName( idx, ent );
+	}
+}
+
+// Takes the entity out of the index before it's cleared
+static void G_UnindexEntityNames( gentity_t *ent ) {
+	entityIndex_t	*idx;
+
+	for ( idx = entityIndexes ; idx < entityIndexes + ARRAY_LEN( entityIndexes ) ; idx++ ) {
+		G_UnlinkEntityName( idx, ent - g_entities );
+	}
+}
+
+void G_SetClassname( gentity_t *ent, const char *classname ) {
+	ent->classname = (char *)classname;
+	G_LinkEntityName( &entityIndexes[0], ent );
+}
+
+void G_SetTargetname( gentity_t *ent, char *targetname ) {
+	ent->targetname = targetname;
+	G_LinkEntityName( &entityIndexes[1], ent );
+}
+
+static gentity_t *G_FindLinear( gentity_t *from, int fieldofs, const char *match )
 {
 	char	*s;
 
@@ -197,6 +388,65 @@ gentity_t *G_Find (gentity_t *from, int fieldofs, const char *match)
 	return nullptr;
 }
 
+static gentity_t *G_FindIndexed( entityIndex_t *idx, gentity_t *from, const char *match )
+{
+	gentity_t	*ent;
+	char		*s;
+	int			hash, num;
+
+	if ( !match ) {
+		return nullptr;
+	}
+
+	hash = G_EntityNameHash( match );
+
+	// carry on along the chain when the last match is on it
+	if ( from && idx->hash[from - g_entities] == hash ) {
+		num = idx->next[from - g_entities];
+	} else {
+		for ( num = idx->hashTable[hash] ; num >= 0 && from && num <= from - g_entities ; num = idx->next[num] )
+			;
+	}
+
+	for ( ; num >= 0 && num < level.num_entities ; num = idx->next[num] ) {
+		ent = &g_entities[num];
+		if ( !ent->inuse )
+			continue;
+		s = *(char **) ((byte *)ent + idx->fieldofs);
+		if ( s && !Q_stricmp( s, match ) )
+			return ent;
+	}
+
+	return nullptr;
+}
+
+// Searches all active entities for the next one that holds the matching string at fieldofs (use the FOFS() macro) in
+//	the structure.
+// Searches beginning at the entity after from, or the beginning if nullptr
+// nullptr will be returned if the end of the list is reached.
+gentity_t *G_Find (gentity_t *from, int fieldofs, const char *match)
+{
+	entityIndex_t	*idx = G_EntityIndexForField( fieldofs );
+	gentity_t		*found, *expected;
+
+	if ( !idx ) {
+		return G_FindLinear( from, fieldofs, match );
+	}
+
+	found = G_FindIndexed( idx, from, match );
+
+	if ( g_debugEntityIndex.integer ) {
+		expected = G_FindLinear( from, fieldofs, match );
+		if ( found != expected ) {
+			Com_Printf( S_COLOR_RED "G_Find: index found %i for \"%s\", a full scan found %i\n",
+				found ? found->s.number : -1, match, expected ? expected->s.number : -1 );
+			return expected;
+		}
+	}
+
+	return found;
+}
+
 // given an origin and a radius, return all entities that are in use that are within the list
 int G_RadiusList ( vec3_t origin, float radius,	gentity_t *ignore, bool takeDamage, gentity_t *ent_list[MAX_GENTITIES])
 {
@@ -466,9 +716,129 @@ void G_SetMovedir( vec3_t angles, vec3_t movedir ) {
 	VectorClear( angles );
 }
 
+// Entity free list
+// Freed slots are queued in the order they were freed, so the head is always the one freed longest ago. If the head
+// was freed too recently to reuse, so was every slot behind it, and G_Spawn never has to look past it.
+
+#define ENTSTATS_FRAMES	(64)
+
+static int	entFreeHead, entFreeTail, entFreeCount;
+static int	entFreeNext[MAX_GENTITIES];
+static int	entFreePrev[MAX_GENTITIES];
+static int	entFreeTime[MAX_GENTITIES];
+static bool	entFreeQueued[MAX_GENTITIES];
+
+static struct entStats_t {
+	int		frame;							// slot counting the current frame
+	int		frames;							// frames finished since the map started
+	int		spawns[ENTSTATS_FRAMES];
+	int		frees[ENTSTATS_FRAMES];
+	int		totalSpawns, totalFrees;
+	int		peakSpawns, peakFrees;
+} entStats;
+
+void G_InitEntityFreeList( void ) {
+	entFreeHead = entFreeTail = -1;
+	entFreeCount = 0;
+	memset( entFreeQueued, 0, sizeof( entFreeQueued ) );
+	memset( &entStats, 0, sizeof( entStats ) );
+}
+
+static void G_UnqueueFreeEntity( int num ) {
+	if ( !entFreeQueued[num] ) {
+		return;
+	}
+
+	if ( entFreePrev[num] >= 0 )
+		entFreeNext[entFreePrev[num]] = entFreeNext[num];
+	else
+		entFreeHead = entFreeNext[num];
+	if ( entFreeNext[num] >= 0 )
+		entFreePrev[entFreeNext[num]] = entFreePrev[num];
+	else
+		entFreeTail = entFreePrev[num];
+
+	entFreeQueued[num] = false;
+	entFreeCount--;
+}
+
+// Freeing an entity twice moves it to the back with the new time
+static void G_QueueFreeEntity( int num ) {
+	G_UnqueueFreeEntity( num );
+
+	entFreeTime[num] = level.time;
+	entFreePrev[num] = entFreeTail;
+	entFreeNext[num] = -1;
+	if ( entFreeTail >= 0 )
+		entFreeNext[entFreeTail] = num;
+	else
+		entFreeHead = num;
+	entFreeTail = num;
+
+	entFreeQueued[num] = true;
+	entFreeCount++;
+}
+
+// Closes the allocation counts of the last frame
+void G_RollEntityStats( void ) {
+	const int spawns = entStats.spawns[entStats.frame];
+	const int frees = entStats.frees[entStats.frame];
+
+	entStats.peakSpawns = Q_max( entStats.peakSpawns, spawns );
+	entStats.peakFrees = Q_max( entStats.peakFrees, frees );
+	entStats.frames++;
+
+	entStats.frame = (entStats.frame + 1) % ENTSTATS_FRAMES;
+	entStats.spawns[entStats.frame] = 0;
+	entStats.frees[entStats.frame] = 0;
+}
+
+void Svcmd_EntStats_f( void ) {
+	const int	frames = Q_min( entStats.frames, ENTSTATS_FRAMES - 1 );
+	const int	last = (entStats.frame + ENTSTATS_FRAMES - 1) % ENTSTATS_FRAMES;
+	int			i, inuse, recent, spawns, frees, peakSpawns, peakFrees;
+
+	inuse = 0;
+	for ( i = 0 ; i < level.num_entities ; i++ ) {
+		if ( g_entities[i].inuse ) {
+			inuse++;
+		}
+	}
+
+	// the queue is in free order, so the slots still held back are all at the back
+	recent = 0;
+	for ( i = entFreeTail ; i >= 0 ; i = entFreePrev[i] ) {
+		if ( entFreeTime[i] <= level.startTime + 2000 || level.time - entFreeTime[i] >= 1000 ) {
+			break;
+		}
+		recent++;
+	}
+
+	spawns = frees = peakSpawns = peakFrees = 0;
+	for ( i = 1 ; i <= frames ; i++ ) {
+		const int f = (entStats.frame + ENTSTATS_FRAMES - i) % ENTSTATS_FRAMES;
+		spawns += entStats.spawns[f];
+		frees += entStats.frees[f];
+		peakSpawns = Q_max( peakSpawns, entStats.spawns[f] );
+		peakFrees = Q_max( peakFrees, entStats.frees[f] );
+	}
+
+	trap->Print( "%i entities in use, %i slots open, %i free (%i freed less than a second ago)\n",
+		inuse, level.num_entities, entFreeCount, recent );
+	if ( frames ) {
+		trap->Print( "last frame:       %4i spawns %4i frees\n", entStats.spawns[last], entStats.frees[last] );
+		trap->Print( "last %2i frames:   %4.1f spawns %4.1f frees on average, %i / %i at most\n", frames,
+			(float)spawns / frames, (float)frees / frames, peakSpawns, peakFrees );
+	}
+	trap->Print( "since map start:  %i spawns %i frees over %i frames, %i / %i at most\n", entStats.totalSpawns,
+		entStats.totalFrees, entStats.frames, entStats.peakSpawns, entStats.peakFrees );
+}
+
 void G_InitGentity( gentity_t *e ) {
+	G_UnqueueFreeEntity( e - g_entities );
+
 	e->inuse = true;
-	e->classname = "noclass";
+	G_SetClassname( e, "noclass" );
 	e->s.number = e - g_entities;
 	e->r.ownerNum = ENTITYNUM_NONE;
 	e->s.modelGhoul2 = 0; //assume not
@@ -556,69 +926,44 @@ static void G_SpewEntList(void)
 // Try to avoid reusing an entity that was recently freed, because it can cause the client to think the entity morphed
 //	into something else instead of being removed and recreated, which can cause interpolated angles and bad trails.
 gentity_t *G_Spawn( void ) {
-	int			i, force;
 	gentity_t	*e;
+	int			num;
 
-	e = nullptr;	// shut up warning
-	i = 0;		// shut up warning
-	for ( force = 0 ; force < 2 ; force++ ) {
-		// if we go through all entities and can't find one to free,
-		// override the normal minimum times before use
-		e = &g_entities[MAX_CLIENTS];
-		for ( i = MAX_CLIENTS ; i<level.num_entities ; i++, e++) {
-			if ( e->inuse ) {
-				continue;
-			}
-
-			// the first couple seconds of server time can involve a lot of
-			// freeing and allocating, so relax the replacement policy
-			if ( !force && e->freetime > level.startTime + 2000 && level.time - e->freetime < 1000 )
-			{
-				continue;
-			}
+	// the first couple seconds of server time can involve a lot of freeing and allocating, so relax the replacement
+	// policy. once every slot is open, reuse the oldest one regardless
+	num = entFreeHead;
+	if ( num >= 0 && entFreeTime[num] > level.startTime + 2000 && level.time - entFreeTime[num] < 1000
+		&& level.num_entities < ENTITYNUM_MAX_NORMAL ) {
+		num = -1;
+	}
 
-			// reuse this slot
-			G_InitGentity( e );
-			return e;
-		}
-		if ( i != MAX_GENTITIES ) {
-			break;
-		}
+	if ( num >= 0 ) {
+		// reuse this slot
+		e = &g_entities[num];
 	}
-	if ( i == ENTITYNUM_MAX_NORMAL ) {
-		/*
-		for (i = 0; i < MAX_GENTITIES; i++) {
-			trap->Print("%4i: %s\n", i, g_entities[i].classname);
+	else {
+		if ( level.num_entities == ENTITYNUM_MAX_NORMAL ) {
+			G_SpewEntList();
+			trap->Error( ERR_DROP, "G_Spawn: no free entities" );
 		}
-		*/
-		G_SpewEntList();
-		trap->Error( ERR_DROP, "G_Spawn: no free entities" );
-	}
 
-	// open up a new slot
-	level.num_entities++;
+		// open up a new slot
+		e = &g_entities[level.num_entities];
+		level.num_entities++;
 
-	// let the server system know that there are more entities
-	trap->LocateGameData( (sharedEntity_t *)level.gentities, level.num_entities, sizeof( gentity_t ),
-		&level.clients[0].ps, sizeof( level.clients[0] ) );
+		// let the server system know that there are more entities
+		trap->LocateGameData( (sharedEntity_t *)level.gentities, level.num_entities, sizeof( gentity_t ),
+			&level.clients[0].ps, sizeof( level.clients[0] ) );
+	}
 
 	G_InitGentity( e );
+	entStats.spawns[entStats.frame]++;
+	entStats.totalSpawns++;
 	return e;
 }
 
 bool G_EntitiesFree( void ) {
-	int			i;
-	gentity_t	*e;
-
-	e = &g_entities[MAX_CLIENTS];
-	for ( i = MAX_CLIENTS; i < level.num_entities; i++, e++) {
-		if ( e->inuse ) {
-			continue;
-		}
-		// slot available
-		return true;
-	}
-	return false;
+	return entFreeHead >= 0;
 }
 
 #define MAX_G2_KILL_QUEUE 256
@@ -743,10 +1088,17 @@ void G_FreeEntity( gentity_t *ed ) {
 		trap->SendServerCommand(-1, va("kls %i %i", ed->s.trickedentindex, ed->s.number));
 	}
 
+	G_UnindexEntityNames( ed );
 	memset (ed, 0, sizeof(*ed));
 	ed->classname = "freed";
 	ed->freetime = level.time;
 	ed->inuse = false;
+
+	if ( ed - g_entities >= MAX_CLIENTS ) {
+		G_QueueFreeEntity( ed - g_entities );
+	}
+	entStats.frees[entStats.frame]++;
+	entStats.totalFrees++;
 }
 
 // Spawns an event entity that will be auto-removed
@@ -759,7 +1111,7 @@ gentity_t *G_TempEntity( vec3_t origin, int event ) {
 	e = G_Spawn();
 	e->s.eType = ET_EVENTS + event;
 
-	e->classname = "tempEntity";
+	G_SetClassname( e, "tempEntity" );
 	e->eventTime = level.time;
 	e->freeAfterEvent = true;
 
@@ -787,7 +1139,7 @@ gentity_t *G_SoundTempEntity( vec3_t origin, int event, int channel ) {
 	e->s.eType = ET_EVENTS + event;
 	e->inuse = true;
 
-	e->classname = "tempEntity";
+	G_SetClassname( e, "tempEntity" );
 	e->eventTime = level.time;
 	e->freeAfterEvent = true;
 
@@ -218,7 +218,7 @@ static void WP_FireBryarPistol( gentity_t *ent, bool altFire )
 
 	gentity_t	*missile = CreateMissile( muzzle, forward, BRYAR_PISTOL_VEL, 10000, ent, altFire );
 
-	missile->classname = "bryar_proj";
+	G_SetClassname( missile, "bryar_proj" );
 	missile->s.weapon = WP_BRYAR_PISTOL;
 
 	if ( altFire )
@@ -277,7 +277,7 @@ void WP_FireTurretMissile( gentity_t *ent, vec3_t start, vec3_t dir, bool altFir
 
 	missile = CreateMissile( start, dir, velocity, 10000, ent, altFire );
 
-	missile->classname = "generic_proj";
+	G_SetClassname( missile, "generic_proj" );
 	missile->s.weapon = WP_TURRET;
 
 	missile->damage = damage;
@@ -353,7 +353,7 @@ void WP_FireGenericBlasterMissile( gentity_t *ent, vec3_t start, vec3_t dir, boo
 
 	missile = CreateMissile( start, dir, velocity, 10000, ent, altFire );
 
-	missile->classname = "generic_proj";
+	G_SetClassname( missile, "generic_proj" );
 	missile->s.weapon = WP_BRYAR_PISTOL;
 
 	missile->damage = damage;
@@ -375,7 +375,7 @@ void WP_FireBlasterMissile( gentity_t *ent, vec3_t start, vec3_t dir, bool altFi
 
 	missile = CreateMissile( start, dir, velocity, 10000, ent, altFire );
 
-	missile->classname = "blaster_proj";
+	G_SetClassname( missile, "blaster_proj" );
 	missile->s.weapon = WP_BLASTER;
 
 	missile->damage = damage;
@@ -399,7 +399,7 @@ void WP_FireTurboLaserMissile( gentity_t *ent, vec3_t start, vec3_t dir )
 	//use a custom impact effect
 	missile->s.emplacedOwner = ent->genericValue15;
 
-	missile->classname = "turbo_proj";
+	G_SetClassname( missile, "turbo_proj" );
 	missile->s.weapon = WP_TURRET;
 
 	missile->damage = ent->damage;		//FIXME: externalize
@@ -429,7 +429,7 @@ void WP_FireEmplacedMissile( gentity_t *ent, vec3_t start, vec3_t dir, bool altF
 
 	missile = CreateMissile( start, dir, velocity, 10000, ent, altFire );
 
-	missile->classname = "emplaced_gun_proj";
+	G_SetClassname( missile, "emplaced_gun_proj" );
 	missile->s.weapon = WP_TURRET;//WP_EMPLACED_GUN;
 
 	missile->activator = ignore;
@@ -880,7 +880,7 @@ static void WP_BowcasterAltFire( gentity_t *ent )
 
 	gentity_t *missile = CreateMissile( muzzle, forward, BOWCASTER_VELOCITY, 10000, ent, false);
 
-	missile->classname = "bowcaster_proj";
+	G_SetClassname( missile, "bowcaster_proj" );
 	missile->s.weapon = WP_BOWCASTER;
 
 	VectorSet( missile->r.maxs, BOWCASTER_SIZE, BOWCASTER_SIZE, BOWCASTER_SIZE );
@@ -964,7 +964,7 @@ static void WP_BowcasterMainFire( gentity_t *ent )
 
 		missile = CreateMissile( muzzle, dir, vel, 10000, ent, true );
 
-		missile->classname = "bowcaster_alt_proj";
+		G_SetClassname( missile, "bowcaster_alt_proj" );
 		missile->s.weapon = WP_BOWCASTER;
 
 		VectorSet( missile->r.maxs, BOWCASTER_SIZE, BOWCASTER_SIZE, BOWCASTER_SIZE );
@@ -1000,7 +1000,7 @@ static void WP_RepeaterMainFire( gentity_t *ent, vec3_t dir )
 
 	gentity_t *missile = CreateMissile( muzzle, dir, REPEATER_VELOCITY, 10000, ent, false );
 
-	missile->classname = "repeater_proj";
+	G_SetClassname( missile, "repeater_proj" );
 	missile->s.weapon = WP_REPEATER;
 
 	missile->damage = damage;
@@ -1018,7 +1018,7 @@ static void WP_RepeaterAltFire( gentity_t *ent )
 
 	gentity_t *missile = CreateMissile( muzzle, forward, REPEATER_ALT_VELOCITY, 10000, ent, true );
 
-	missile->classname = "repeater_alt_proj";
+	G_SetClassname( missile, "repeater_alt_proj" );
 	missile->s.weapon = WP_REPEATER;
 
 	VectorSet( missile->r.maxs, REPEATER_ALT_SIZE, REPEATER_ALT_SIZE, REPEATER_ALT_SIZE );
@@ -1067,7 +1067,7 @@ static void WP_DEMP2_MainFire( gentity_t *ent )
 
 	gentity_t *missile = CreateMissile( muzzle, forward, DEMP2_VELOCITY, 10000, ent, false);
 
-	missile->classname = "demp2_proj";
+	G_SetClassname( missile, "demp2_proj" );
 	missile->s.weapon = WP_DEMP2;
 
 	VectorSet( missile->r.maxs, DEMP2_SIZE, DEMP2_SIZE, DEMP2_SIZE );
@@ -1292,7 +1292,7 @@ static void WP_DEMP2_AltFire( gentity_t *ent )
 
 	missile->count = count;
 
-	missile->classname = "demp2_alt_proj";
+	G_SetClassname( missile, "demp2_alt_proj" );
 	missile->s.weapon = WP_DEMP2;
 
 	missile->think = DEMP2_AltDetonate;
@@ -1345,7 +1345,7 @@ static void WP_FlechetteMainFire( gentity_t *ent )
 
 		missile = CreateMissile( muzzle, fwd, FLECHETTE_VEL, 10000, ent, false);
 
-		missile->classname = "flech_proj";
+		G_SetClassname( missile, "flech_proj" );
 		missile->s.weapon = WP_FLECHETTE;
 
 		VectorSet( missile->r.maxs, FLECHETTE_SIZE, FLECHETTE_SIZE, FLECHETTE_SIZE );
@@ -1494,7 +1494,7 @@ static void WP_CreateFlechetteBouncyThing( vec3_t start, vec3_t fwd, gentity_t *
 	missile->activator = self;
 
 	missile->s.weapon = WP_FLECHETTE;
-	missile->classname = "flech_alt";
+	G_SetClassname( missile, "flech_alt" );
 	missile->mass = 4;
 
 	// How 'bout we give this thing a size...
@@ -1771,7 +1771,7 @@ static void WP_FireRocket( gentity_t *ent, bool altFire )
 		ent->client->ps.rocketTargetTime = 0;
 	}
 
-	missile->classname = "rocket_proj";
+	G_SetClassname( missile, "rocket_proj" );
 	missile->s.weapon = WP_ROCKET_LAUNCHER;
 
 	// Make it easier to hit things
@@ -1882,7 +1882,7 @@ gentity_t *WP_FireThermalDetonator( gentity_t *ent, bool altFire )
 
 	bolt->physicsObject = true;
 
-	bolt->classname = "thermal_detonator";
+	G_SetClassname( bolt, "thermal_detonator" );
 	bolt->think = thermalThinkStandard;
 	bolt->nextthink = level.time;
 	bolt->touch = touch_NULL;
@@ -2313,7 +2313,7 @@ void TrapThink(gentity_t *ent)
 
 void CreateLaserTrap( gentity_t *laserTrap, vec3_t start, gentity_t *owner )
 { //create a laser trap entity
-	laserTrap->classname = "laserTrap";
+	G_SetClassname( laserTrap, "laserTrap" );
 	laserTrap->flags |= FL_BOUNCE_HALF;
 	laserTrap->s.eFlags |= EF_MISSILE_STICK;
 	laserTrap->splashDamage = LT_SPLASH_DAM;
@@ -2627,7 +2627,7 @@ void drop_charge (gentity_t *self, vec3_t start, vec3_t dir)
 	VectorNormalize (dir);
 
 	bolt = G_Spawn();
-	bolt->classname = "detpack";
+	G_SetClassname( bolt, "detpack" );
 	bolt->nextthink = level.time + FRAMETIME;
 	bolt->think = G_RunObject;
 	bolt->s.eType = ET_GENERAL;
@@ -3086,7 +3086,7 @@ static void WP_FireConcussion( gentity_t *ent )
 
 	missile = CreateMissile( start, forward, vel, 10000, ent, false );
 
-	missile->classname = "conc_proj";
+	G_SetClassname( missile, "conc_proj" );
 	missile->s.weapon = WP_CONCUSSION;
 	missile->mass = 10;
 
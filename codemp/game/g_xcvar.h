@@ -109,6 +109,7 @@ XCVAR_DEF( g_botsFile,                  "",            nullptr, CVAR_INIT | CVAR
 XCVAR_DEF( g_charRestrictRGB,           "1",           nullptr, CVAR_ARCHIVE,                                    false )
 XCVAR_DEF( g_debugAlloc,                "0",           nullptr, CVAR_NONE,                                       false )
 XCVAR_DEF( g_debugDamage,               "0",           nullptr, CVAR_NONE,                                       false )
+XCVAR_DEF( g_debugEntityIndex,          "0",           nullptr, CVAR_NONE,                                       false )
 XCVAR_DEF( g_debugMelee,                "0",           nullptr, CVAR_SERVERINFO,                                 true )
 XCVAR_DEF( g_debugMove,                 "0",           nullptr, CVAR_NONE,                                       false )
 XCVAR_DEF( g_debugSaberLocks,           "0",           nullptr, CVAR_CHEAT,                                      false )
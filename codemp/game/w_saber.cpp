@@ -574,7 +574,7 @@ void WP_SaberInitBladeData( gentity_t *ent )
 		saberent = G_Spawn();
 	}
 	ent->client->ps.saberEntityNum = ent->client->saberStoredIndex = saberent->s.number;
-	saberent->classname = "lightsaber";
+	G_SetClassname( saberent, "lightsaber" );
 
 	saberent->neverFree = true; //the saber being removed would be a terrible thing.
 
@@ -5736,7 +5736,7 @@ void MakeDeadSaber(gentity_t *ent)
 	VectorCopy(ent->r.currentOrigin, startorg);
 	VectorCopy(ent->r.currentAngles, startang);
 
-	saberent->classname = "deadsaber";
+	G_SetClassname( saberent, "deadsaber" );
 
 	saberent->r.svFlags = SVF_USE_CURRENT_ORIGIN;
 	saberent->r.ownerNum = ent->s.number;
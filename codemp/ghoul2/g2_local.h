@@ -244,6 +244,9 @@ void		G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale,
 #else
 void		G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod);
 #endif
+void		G2_TransformModelLazy(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod);
+void		G2_EndLazyTransform(void);
+void		G2_BuildBoneTrees(model_t *mod);
 
 // internal bolt calls. G2_bolts.cpp
 bool G2_Remove_Bolt(boltInfo_v& bltlist, int index);
@@ -34,6 +34,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 struct model_t;
 class CBoneCache;
+class IHeapAllocator;
 class CGhoul2Info_v;
 
 //rww - RAGDOLL_BEGIN
@@ -281,6 +282,13 @@ public:
 	CBoneCache		*mBoneCache;
 	int				mSkin;
 
+	// what mTransformedVertsArray was last built for, see G2_TransformModel
+	int				mMeshLod;
+	vec3_t			mMeshScale;
+	const model_t	*mMeshModel;
+	IHeapAllocator	*mMeshVertSpace;
+	int				mMeshVertGeneration;
+
 	// these occasionally are not valid (like after a vid_restart)
 	// call the questionably efficient G2_SetupModelPointers(this) to insure validity
 	bool				mValid; // all the below are proper and valid
@@ -313,6 +321,10 @@ public:
 	mTransformedVertsArray(0),
 	mBoneCache(0),
 	mSkin(0),
+	mMeshLod(-1),
+	mMeshModel(0),
+	mMeshVertSpace(0),
+	mMeshVertGeneration(0),
 	mValid(false),
 	currentModel(0),
 	currentModelSize(0),
@@ -324,6 +336,7 @@ public:
 #endif
 	{
 		mFileName[0] = 0;
+		VectorClear(mMeshScale);
 	}
 };
 
@@ -40,6 +40,8 @@ public:
 
 	virtual void ResetHeap() = 0;
 	virtual char *MiniHeapAlloc ( int size ) = 0;
+	virtual int MiniHeapRemaining() = 0;
+	virtual int MiniHeapGeneration() = 0;	// changes every time the heap is reset
 };
 
 class CMiniHeap : public IHeapAllocator
@@ -48,12 +50,14 @@ private:
 	char	*mHeap;
 	char	*mCurrentHeap;
 	int		mSize;
+	int		mGeneration;
 public:
 
 	// reset the heap back to the start
 	void ResetHeap()
 	{
 		mCurrentHeap = mHeap;
+		mGeneration++;
 	}
 
 	// initialise the heap
@@ -61,6 +65,7 @@ public:
 	{
 		mHeap = (char *)malloc(size);
 		mSize = size;
+		mGeneration = 0;
 		if (mHeap)
 		{
 			ResetHeap();
@@ -88,6 +93,17 @@ public:
 		return nullptr;
 	}
 
+	// how much is left
+	int MiniHeapRemaining()
+	{
+		return mSize - (int)(mCurrentHeap - mHeap);
+	}
+
+	int MiniHeapGeneration()
+	{
+		return mGeneration;
+	}
+
 };
 
 // ======================================================================
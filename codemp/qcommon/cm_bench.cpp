@@ -0,0 +1,365 @@
+/*
+===========================================================================
+Copyright (C) 2019 - 2020, CleanJoKe contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// cm_bench.cpp -- offline benchmark of the collision queries against a map
+
+#include "qcommon/cm_local.h"
+
+#include <chrono>
+
+#define CMBENCH_IDENT			"CMB1"
+#define CMBENCH_DEFAULT_QUERIES	100000
+#define CMBENCH_MAX_QUERIES		10000000
+#define CMBENCH_MAX_MISMATCHES	10	// how many mismatches are printed in detail
+#define CMBENCH_MAX_LENGTH		1024.0f
+#define CMBENCH_MASK			( CONTENTS_SOLID | CONTENTS_PLAYERCLIP | CONTENTS_BODY | CONTENTS_TERRAIN ) // MASK_PLAYERSOLID
+
+enum cmBenchType_e {
+	CMBENCH_POINT,			// CM_BoxTrace without a size
+	CMBENCH_BOX,			// CM_BoxTrace
+	CMBENCH_CAPSULE,		// CM_BoxTrace with capsule set
+	CMBENCH_TRANSFORMED,	// CM_TransformedBoxTrace against a rotated inline model
+	CMBENCH_CONTENTS,		// CM_PointContents
+	CMBENCH_NUM_TYPES
+};
+
+static const char *cmBenchTypeNames[CMBENCH_NUM_TYPES] = {
+	"point",
+	"box",
+	"capsule",
+	"transformed",
+	"contents",
+};
+
+// The golden file is the header, then the queries, then their results, in native byte order
+struct cmBenchHeader_t {
+	char	ident[4];
+	int		checksum;	// of the map the results were recorded on
+	int		numQueries;
+};
+
+struct cmBenchQuery_t {
+	int		type;
+	int		model;		// inline model for CMBENCH_TRANSFORMED
+	vec3_t	start, end;
+	vec3_t	mins, maxs;
+	vec3_t	angles;
+};
+
+struct cmBenchResult_t {
+	float	fraction;
+	vec3_t	endpos;
+	vec3_t	normal;
+	float	dist;
+	int		startsolid;
+	int		allsolid;
+	int		contents;
+	int		surfaceFlags;
+};
+
+// Fixed generator so the same map and query count always build the same corpus
+static float CM_BenchRandom( uint32_t *seed ) {
+	*seed = *seed * 1664525 + 1013904223;
+	return ( *seed >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+static void CM_BenchGenerate( cmBenchQuery_t *queries, int numQueries ) {
+	uint32_t		seed = 0x1234;
+	int				i, j;
+	float			length, size;
+	vec3_t			mins, maxs, dir;
+	cmBenchQuery_t	*q;
+
+	for ( i = 0, q = queries ; i < numQueries ; i++, q++ ) {
+		memset( q, 0, sizeof( *q ) );
+		q->type = i % CMBENCH_NUM_TYPES;
+
+		if ( q->type == CMBENCH_TRANSFORMED && cmg.numSubModels > 1 ) {
+			q->model = 1 + (int)( CM_BenchRandom( &seed ) * ( cmg.numSubModels - 1 ) ) % ( cmg.numSubModels - 1 );
+			for ( j = 0 ; j < 3 ; j++ ) {
+				q->angles[j] = CM_BenchRandom( &seed ) * 360.0f;
+			}
+		}
+
+		// start anywhere inside the model, pushed out a bit for the small inline models
+		VectorCopy( cmg.cmodels[q->model].mins, mins );
+		VectorCopy( cmg.cmodels[q->model].maxs, maxs );
+		for ( j = 0 ; j < 3 ; j++ ) {
+			if ( q->model ) {
+				mins[j] -= 128.0f;
+				maxs[j] += 128.0f;
+			}
+			q->start[j] = mins[j] + CM_BenchRandom( &seed ) * ( maxs[j] - mins[j] );
+		}
+
+		// mostly short traces, like movement, with the odd long one, like weapons
+		for ( j = 0 ; j < 3 ; j++ ) {
+			dir[j] = CM_BenchRandom( &seed ) * 2.0f - 1.0f;
+		}
+		VectorNormalize( dir );
+		length = CM_BenchRandom( &seed );
+		length = length * length * CMBENCH_MAX_LENGTH;
+		VectorMA( q->start, length, dir, q->end );
+
+		if ( q->type != CMBENCH_POINT && q->type != CMBENCH_CONTENTS ) {
+			size = 8.0f + CM_BenchRandom( &seed ) * 24.0f;
+			VectorSet( q->mins, -size, -size, -8.0f - CM_BenchRandom( &seed ) * 24.0f );
+			VectorSet( q->maxs, size, size, 8.0f + CM_BenchRandom( &seed ) * 56.0f );
+		}
+	}
+}
+
+static void CM_BenchRun( const cmBenchQuery_t *q, cmBenchResult_t *r ) {
+	trace_t		tr;
+
+	memset( r, 0, sizeof( *r ) );
+
+	switch ( q->type ) {
+	case CMBENCH_CONTENTS:
+		r->contents = CM_PointContents( q->start, 0 );
+		return;
+	case CMBENCH_TRANSFORMED:
+		CM_TransformedBoxTrace( &tr, q->start, q->end, q->mins, q->maxs, CM_InlineModel( q->model ), CMBENCH_MASK, vec3_origin, q->angles, false );
+		break;
+	default:
+		CM_BoxTrace( &tr, q->start, q->end, q->mins, q->maxs, 0, CMBENCH_MASK, q->type == CMBENCH_CAPSULE );
+		break;
+	}
+
+	r->fraction = tr.fraction;
+	VectorCopy( tr.endpos, r->endpos );
+	VectorCopy( tr.plane.normal, r->normal );
+	r->dist = tr.plane.dist;
+	r->startsolid = tr.startsolid;
+	r->allsolid = tr.allsolid;
+	r->contents = tr.contents;
+	r->surfaceFlags = tr.surfaceFlags;
+}
+
+// Runs the queries one type at a time so each type gets its own timing and counters
+static void CM_BenchRunAll( const cmBenchQuery_t *queries, cmBenchResult_t *results, int numQueries ) {
+	int			i, type, count;
+	double		ns, totalNs = 0.0;
+
+	Com_Printf( "%-12s %8s %10s %10s %10s\n", "type", "queries", "ns/query", "brushes", "patches" );
+
+	for ( type = 0 ; type < CMBENCH_NUM_TYPES ; type++ ) {
+		c_traces = c_brush_traces = c_patch_traces = c_pointcontents = 0;
+		count = 0;
+
+		const auto start = std::chrono::steady_clock::now();
+		for ( i = 0 ; i < numQueries ; i++ ) {
+			if ( queries[i].type == type ) {
+				CM_BenchRun( &queries[i], &results[i] );
+				count++;
+			}
+		}
+		ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+		totalNs += ns;
+
+		if ( !count ) {
+			continue;
+		}
+		Com_Printf( "%-12s %8i %10.1f %10.2f %10.2f\n", cmBenchTypeNames[type], count, ns / count,
+			(float)c_brush_traces / count, (float)c_patch_traces / count );
+	}
+
+	Com_Printf( "%-12s %8i %10.1f\n", "total", numQueries, totalNs / numQueries );
+}
+
+static void CM_BenchPrintResult( const char *label, const cmBenchResult_t *r ) {
+	Com_Printf( "  %s: fraction %.9g endpos (%.9g %.9g %.9g) plane (%.9g %.9g %.9g) %.9g solid %i/%i contents 0x%x surf 0x%x\n",
+		label, r->fraction, r->endpos[0], r->endpos[1], r->endpos[2], r->normal[0], r->normal[1], r->normal[2], r->dist,
+		r->startsolid, r->allsolid, r->contents, r->surfaceFlags );
+}
+
+// Compares bit for bit, any change in the collision code has to reproduce the recorded results exactly
+static void CM_BenchVerify( const cmBenchQuery_t *queries, const cmBenchResult_t *golden, const cmBenchResult_t *results, int numQueries ) {
+	int		i, mismatches = 0;
+
+	for ( i = 0 ; i < numQueries ; i++ ) {
+		if ( !memcmp( &golden[i], &results[i], sizeof( golden[i] ) ) ) {
+			continue;
+		}
+		if ( mismatches < CMBENCH_MAX_MISMATCHES ) {
+			Com_Printf( "query %i (%s) differs:\n", i, cmBenchTypeNames[queries[i].type] );
+			CM_BenchPrintResult( "expected", &golden[i] );
+			CM_BenchPrintResult( "got     ", &results[i] );
+		}
+		mismatches++;
+	}
+
+	if ( mismatches ) {
+		Com_Printf( S_COLOR_RED "%i of %i results differ from the golden file\n", mismatches, numQueries );
+	} else {
+		Com_Printf( S_COLOR_GREEN "all %i results match the golden file\n", numQueries );
+	}
+}
+
+static void CM_BenchWrite( const char *filename, int checksum, const cmBenchQuery_t *queries, const cmBenchResult_t *results, int numQueries ) {
+	cmBenchHeader_t	header;
+	fileHandle_t	f;
+
+	f = FS_FOpenFileWrite( filename );
+	if ( !f ) {
+		Com_Printf( "cm_bench: couldn't write %s\n", filename );
+		return;
+	}
+
+	memcpy( header.ident, CMBENCH_IDENT, sizeof( header.ident ) );
+	header.checksum = checksum;
+	header.numQueries = numQueries;
+	FS_Write( &header, sizeof( header ), f );
+	FS_Write( queries, numQueries * sizeof( *queries ), f );
+	FS_Write( results, numQueries * sizeof( *results ), f );
+	FS_FCloseFile( f );
+
+	Com_Printf( "wrote %i queries and their results to %s\n", numQueries, filename );
+}
+
+// Usage: cm_bench <map> [queries]
+//        cm_bench <map> write <file> [queries]
+//        cm_bench <map> verify <file>
+static void CM_BenchUnloadMap( void ) {
+	CM_ClearMap();
+	Hunk_ReleaseMark();
+}
+
+// Loads the map's collision data without starting a server and times a corpus of queries against it.
+// The random corpus is the same on every run, write saves it with its results as a golden file
+// and verify replays a golden file and checks the results still match.
+void CM_Bench_f( void ) {
+	const char		*mode;
+	char			filename[MAX_QPATH];
+	int				checksum, numQueries;
+	long			len;
+	void			*buffer = nullptr;
+	cmBenchHeader_t	*header;
+	cmBenchQuery_t	*queries;
+	cmBenchResult_t	*golden = nullptr, *results;
+
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "usage: cm_bench <map> [queries]\n"
+			"       cm_bench <map> write <file> [queries]\n"
+			"       cm_bench <map> verify <file>\n" );
+		return;
+	}
+
+	// the map would replace the collision data of a running server or client
+	if ( cmg.name[0] ) {
+		Com_Printf( "cm_bench: %s is loaded, shut down the server first\n", cmg.name );
+		return;
+	}
+	if ( Hunk_CheckMark() ) {
+		Com_Printf( "cm_bench: the hunk is marked by a server or client, shut it down first\n" );
+		return;
+	}
+
+	mode = Cmd_Argv( 2 );
+	filename[0] = '\0';
+	numQueries = CMBENCH_DEFAULT_QUERIES;
+	if ( !Q_stricmp( mode, "write" ) || !Q_stricmp( mode, "verify" ) ) {
+		if ( Cmd_Argc() < 4 ) {
+			Com_Printf( "cm_bench: %s needs a file name\n", mode );
+			return;
+		}
+		Q_strncpyz( filename, Cmd_Argv( 3 ), sizeof( filename ) );
+		COM_DefaultExtension( filename, sizeof( filename ), ".cmb" );
+		if ( Cmd_Argc() > 4 ) {
+			numQueries = atoi( Cmd_Argv( 4 ) );
+		}
+	} else if ( mode[0] ) {
+		numQueries = atoi( mode );
+		mode = "";
+	}
+	numQueries = Com_Clampi( 1, CMBENCH_MAX_QUERIES, numQueries );
+
+	// CM_LoadMap drops with the mark still set if the map isn't there
+	if ( FS_ReadFile( va( "maps/%s.bsp", Cmd_Argv( 1 ) ), nullptr ) <= 0 ) {
+		Com_Printf( "cm_bench: couldn't find maps/%s.bsp\n", Cmd_Argv( 1 ) );
+		return;
+	}
+
+	// the map goes on the hunk above a mark of its own, so it can be freed again afterwards
+	Hunk_SetMark();
+	CM_LoadMap( va( "maps/%s.bsp", Cmd_Argv( 1 ) ), false, &checksum );
+
+	if ( !Q_stricmp( mode, "verify" ) ) {
+		len = FS_ReadFile( filename, &buffer );
+		if ( !buffer ) {
+			Com_Printf( "cm_bench: couldn't read %s\n", filename );
+			CM_BenchUnloadMap();
+			return;
+		}
+
+		header = (cmBenchHeader_t *)buffer;
+		if ( len < (long)sizeof( *header ) || memcmp( header->ident, CMBENCH_IDENT, sizeof( header->ident ) )
+			|| header->numQueries <= 0 || header->numQueries > CMBENCH_MAX_QUERIES
+			|| len != (long)( sizeof( *header ) + header->numQueries * ( sizeof( *queries ) + sizeof( *golden ) ) ) ) {
+			Com_Printf( "cm_bench: %s is not a golden file\n", filename );
+			FS_FreeFile( buffer );
+			CM_BenchUnloadMap();
+			return;
+		}
+		if ( header->checksum != checksum ) {
+			Com_Printf( "cm_bench: %s was recorded on a different version of %s\n", filename, cmg.name );
+			FS_FreeFile( buffer );
+			CM_BenchUnloadMap();
+			return;
+		}
+
+		numQueries = header->numQueries;
+		queries = (cmBenchQuery_t *)( header + 1 );
+		golden = (cmBenchResult_t *)( queries + numQueries );
+
+		for ( int i = 0 ; i < numQueries ; i++ ) {
+			if ( queries[i].type < 0 || queries[i].type >= CMBENCH_NUM_TYPES
+				|| queries[i].model < 0 || queries[i].model >= cmg.numSubModels ) {
+				Com_Printf( "cm_bench: %s has a bad query %i\n", filename, i );
+				FS_FreeFile( buffer );
+				CM_BenchUnloadMap();
+				return;
+			}
+		}
+	} else {
+		queries = (cmBenchQuery_t *)Z_Malloc( numQueries * sizeof( *queries ), TAG_TEMP_WORKSPACE, false );
+		CM_BenchGenerate( queries, numQueries );
+	}
+
+	results = (cmBenchResult_t *)Z_Malloc( numQueries * sizeof( *results ), TAG_TEMP_WORKSPACE, false );
+
+	Com_Printf( "%s: %i brushes, %i patches, %i inline models\n", cmg.name, cmg.numBrushes, cmg.numSurfaces, cmg.numSubModels );
+	CM_BenchRunAll( queries, results, numQueries );
+
+	if ( golden ) {
+		CM_BenchVerify( queries, golden, results, numQueries );
+	} else if ( filename[0] ) {
+		CM_BenchWrite( filename, checksum, queries, results, numQueries );
+	}
+
+	Z_Free( results );
+	if ( buffer ) {
+		FS_FreeFile( buffer );
+	} else {
+		Z_Free( queries );
+	}
+
+	CM_BenchUnloadMap();
+}
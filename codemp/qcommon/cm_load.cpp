@@ -35,14 +35,12 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #define	BOX_PLANES		12
 
 clipMap_t	cmg; //rwwRMG - changed from cm
-int			c_pointcontents;
-int			c_traces, c_brush_traces, c_patch_traces;
+thread_local int	c_pointcontents;
+thread_local int	c_traces, c_brush_traces, c_patch_traces;
 
 byte		*cmod_base;
 
-cmodel_t	box_model;
-cplane_t	*box_planes;
-cbrush_t	*box_brush;
+thread_local cmTempBox_t	cm_tempBox;
 
 //rwwRMG - added:
 clipMap_t	SubBSP[MAX_SUB_BSP];
@@ -180,7 +178,8 @@ void CM_BoundBrush( cbrush_t *b ) {
 void CMod_LoadBrushes( const lump_t *l, clipMap_t &cm ) {
 	dbrush_t	*in;
 	cbrush_t	*out;
-	int			i, count;
+	cplanePack_t	*packs;
+	int			i, count, numPacks;
 
 	in = (dbrush_t *)(cmod_base + l->fileofs);
 	if (l->filelen % sizeof(*in)) {
@@ -206,6 +205,16 @@ void CMod_LoadBrushes( const lump_t *l, clipMap_t &cm ) {
 		CM_BoundBrush( out );
 	}
 
+	// pack the side planes of every brush for the plane tests
+	numPacks = 0;
+	for ( i=0, out=cm.brushes ; i<count ; i++, out++ ) {
+		numPacks += PLANE_PACK_BLOCKS( out->numsides );
+	}
+	packs = (cplanePack_t *)Hunk_Alloc( numPacks * sizeof( *packs ), h_high );
+	for ( i=0, out=cm.brushes ; i<count ; i++, out++ ) {
+		CM_PackBrushPlanes( out, packs );
+		packs += PLANE_PACK_BLOCKS( out->numsides );
+	}
 }
 
 static void CMod_LoadLeafs (const lump_t *l, clipMap_t &cm)
@@ -680,7 +689,7 @@ cmodel_t	*CM_ClipHandleToModel( clipHandle_t handle, clipMap_t **clipMap ) {
 		{
 			*clipMap = &cmg;
 		}
-		return &box_model;
+		return &cm_tempBox.model;
 	}
 
 	count = cmg.numSubModels;
@@ -715,6 +724,10 @@ clipHandle_t	CM_InlineModel( int index ) {
 	return index;
 }
 
+int		CM_NumClusters( void ) {
+	return cmg.numClusters;
+}
+
 int		CM_NumInlineModels( void ) {
 	return cmg.numSubModels;
 }
@@ -742,44 +755,67 @@ int		CM_LeafArea( int leafnum ) {
 	return cmg.leafs[leafnum].area;
 }
 
-// Set up the planes and nodes so that the six floats of a bounding box can just be stored out and get a proper clipping hull structure.
+// Copies the side planes of a brush into packs, unused lanes of the last block get an empty plane.
+void CM_PackBrushPlanes( cbrush_t *brush, cplanePack_t *packs ) {
+	int				i, lane;
+	cplanePack_t	*pack;
+	const cplane_t	*plane;
+
+	for ( i = 0 ; i < PLANE_PACK_BLOCKS( brush->numsides ) * PLANE_PACK_WIDTH ; i++ ) {
+		pack = &packs[i / PLANE_PACK_WIDTH];
+		lane = i % PLANE_PACK_WIDTH;
+
+		if ( i < brush->numsides ) {
+			plane = brush->sides[i].plane;
+			pack->normal[0][lane] = plane->normal[0];
+			pack->normal[1][lane] = plane->normal[1];
+			pack->normal[2][lane] = plane->normal[2];
+			pack->dist[lane] = plane->dist;
+			pack->signbits[lane] = plane->signbits;
+		} else {
+			pack->normal[0][lane] = pack->normal[1][lane] = pack->normal[2][lane] = 0.0f;
+			pack->dist[lane] = 0.0f;
+			pack->signbits[lane] = 0;
+		}
+	}
+	brush->planes = packs;
+}
+
+// Reserves the leaf brush slot past the map's brushes for the temporary box model.
 void CM_InitBoxHull (void)
 {
+	cmg.leafbrushes[cmg.numLeafBrushes] = cmg.numBrushes;
+}
+
+// Set up the planes so that the six floats of a bounding box can just be stored out and get a proper clipping hull structure.
+static void CM_InitTempBox( cmTempBox_t *box ) {
 	int			i;
 	int			side;
 	cplane_t	*p;
-	cbrushside_t	*s;
 
-	box_planes = &cmg.planes[cmg.numPlanes];
+	box->brush.numsides = 6;
+	box->brush.sides = box->sides;
+	box->brush.planes = box->planePacks;
+	box->brush.contents = CONTENTS_BODY;
 
-	box_brush = &cmg.brushes[cmg.numBrushes];
-	box_brush->numsides = 6;
-	box_brush->sides = cmg.brushsides + cmg.numBrushSides;
-	box_brush->contents = CONTENTS_BODY;
-
-	box_model.firstNode = -1;
-	box_model.leaf.numLeafBrushes = 1;
-//	box_model.leaf.firstLeafBrush = cmg.numBrushes;
-	box_model.leaf.firstLeafBrush = cmg.numLeafBrushes;
-	cmg.leafbrushes[cmg.numLeafBrushes] = cmg.numBrushes;
+	box->model.firstNode = -1;
+	box->model.leaf.numLeafBrushes = 1;
 
 	for (i=0 ; i<6 ; i++)
 	{
 		side = i&1;
 
 		// brush sides
-		s = &cmg.brushsides[cmg.numBrushSides+i];
-		s->plane = 	cmg.planes + (cmg.numPlanes+i*2+side);
-		s->shaderNum = cmg.numShaders;
+		box->sides[i].plane = &box->planes[i*2+side];
 
 		// planes
-		p = &box_planes[i*2];
+		p = &box->planes[i*2];
 		p->type = i>>1;
 		p->signbits = 0;
 		VectorClear (p->normal);
 		p->normal[i>>1] = 1;
 
-		p = &box_planes[i*2+1];
+		p = &box->planes[i*2+1];
 		p->type = 3 + (i>>1);
 		p->signbits = 0;
 		VectorClear (p->normal);
@@ -791,30 +827,44 @@ void CM_InitBoxHull (void)
 
 // To keep everything totally uniform, bounding boxes are turned into small BSP trees instead of being compared directly.
 // Capsules are handled differently though.
+// The box belongs to the calling thread and stays valid until its next call.
 clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule ) {
+	cmTempBox_t	*box = &cm_tempBox;
+	int			i;
+
+	if ( !box->brush.sides ) {
+		CM_InitTempBox( box );
+	}
+
+	// these depend on the loaded map
+	box->model.leaf.firstLeafBrush = cmg.numLeafBrushes;
+	for ( i = 0 ; i < 6 ; i++ ) {
+		box->sides[i].shaderNum = cmg.numShaders;
+	}
 
-	VectorCopy( mins, box_model.mins );
-	VectorCopy( maxs, box_model.maxs );
+	VectorCopy( mins, box->model.mins );
+	VectorCopy( maxs, box->model.maxs );
 
 	if ( capsule ) {
 		return CAPSULE_MODEL_HANDLE;
 	}
 
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = -maxs[0];
-	box_planes[2].dist = mins[0];
-	box_planes[3].dist = -mins[0];
-	box_planes[4].dist = maxs[1];
-	box_planes[5].dist = -maxs[1];
-	box_planes[6].dist = mins[1];
-	box_planes[7].dist = -mins[1];
-	box_planes[8].dist = maxs[2];
-	box_planes[9].dist = -maxs[2];
-	box_planes[10].dist = mins[2];
-	box_planes[11].dist = -mins[2];
+	box->planes[0].dist = maxs[0];
+	box->planes[1].dist = -maxs[0];
+	box->planes[2].dist = mins[0];
+	box->planes[3].dist = -mins[0];
+	box->planes[4].dist = maxs[1];
+	box->planes[5].dist = -maxs[1];
+	box->planes[6].dist = mins[1];
+	box->planes[7].dist = -mins[1];
+	box->planes[8].dist = maxs[2];
+	box->planes[9].dist = -maxs[2];
+	box->planes[10].dist = mins[2];
+	box->planes[11].dist = -mins[2];
+	CM_PackBrushPlanes( &box->brush, box->planePacks );
 
-	VectorCopy( mins, box_brush->bounds[0] );
-	VectorCopy( maxs, box_brush->bounds[1] );
+	VectorCopy( mins, box->brush.bounds[0] );
+	VectorCopy( maxs, box->brush.bounds[1] );
 
 	return BOX_MODEL_HANDLE;
 }
@@ -900,7 +950,7 @@ int CM_ModelContents_Actual( clipHandle_t model, clipMap_t *cm )
 	for ( i = 0; i < cmod->leaf.numLeafBrushes; i++ )
 	{
 		int brushNum = cm->leafbrushes[cmod->leaf.firstLeafBrush + i];
-		contents |= cm->brushes[brushNum].contents;
+		contents |= CM_BrushNum( cm, brushNum )->contents;
 	}
 
 	for ( i = 0; i < cmod->leaf.numLeafSurfaces; i++ )
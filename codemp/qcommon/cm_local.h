@@ -29,11 +29,20 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/cm_public.h"
 #include "qcommon/q_common.h"
 
+#include <algorithm>
+#include <vector>
+
 #define	MAX_SUBMODELS			512
 #define	BOX_MODEL_HANDLE		(MAX_SUBMODELS-1)
 #define CAPSULE_MODEL_HANDLE	(MAX_SUBMODELS-2)
 #define	SURFACE_CLIP_EPSILON (0.125) // keep 1/8 unit away to keep the position valid before network snapping and to avoid various numeric issues
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CM_PLANES_SSE2	1
+#else
+	#define CM_PLANES_SSE2	0
+#endif
+
 struct Point {
 	long x, y;
 };
@@ -63,13 +72,23 @@ struct cbrushside_t {
 	int			shaderNum;
 };
 
+// Side planes of a brush, four to a block so the plane tests can run on all of them at once
+#define PLANE_PACK_WIDTH	4
+#define PLANE_PACK_BLOCKS( numsides ) ( ( (numsides) + PLANE_PACK_WIDTH - 1 ) / PLANE_PACK_WIDTH )
+
+struct cplanePack_t {
+	float		normal[3][PLANE_PACK_WIDTH];
+	float		dist[PLANE_PACK_WIDTH];
+	int			signbits[PLANE_PACK_WIDTH];
+};
+
 struct cbrush_t {
 	int					shaderNum;		// the shader that determined the contents
 	int					contents;
 	vec3_t				bounds[2];
 	cbrushside_t		*sides;
+	cplanePack_t		*planes;		// copy of the side planes, PLANE_PACK_BLOCKS( numsides ) blocks
 	uint16_t      numsides;
-	uint16_t      checkcount; // to avoid repeated testings
 };
 
 class CCMShader {
@@ -122,7 +141,25 @@ struct clipMap_t {
 	int			numSurfaces;
 	cPatch_t	**surfaces;			// non-patches will be nullptr
 	int			floodvalid;
-	int			checkcount;					// incremented on each trace
+};
+
+// The brushes and surfaces of one clip map that the current query has already tested, so entries that appear in
+//	several leafs are only tested once. Marks are stamped with a generation that is bumped for every query.
+// Every thread has its own set per clip map, see CM_BeginVisit.
+struct cmVisited_t {
+	uint32_t              generation;
+	std::vector<uint32_t> brushes;
+	std::vector<uint32_t> surfaces;
+};
+
+// The temporary box model handed out by CM_TempBoxModel. Each thread has its own so entity traces can run concurrently.
+// It takes the leaf brush slot reserved past the map's own brushes, see CM_BrushNum.
+struct cmTempBox_t {
+	cmodel_t     model;
+	cplane_t     planes[12];
+	cbrushside_t sides[6];
+	cplanePack_t planePacks[PLANE_PACK_BLOCKS( 6 )];
+	cbrush_t     brush;
 };
 
 struct sphere_t {
@@ -153,6 +190,9 @@ struct traceWork_t { //rwwRMG - modified
 	cplane_t     *clipplane;
 	bool          startout;
 	bool          getout;
+	uint32_t     *visitedBrushes;  // marks of the clip map being traced, see cmVisited_t
+	uint32_t     *visitedSurfaces;
+	uint32_t      visitGeneration;
 };
 
 struct leafList_t {
@@ -167,14 +207,32 @@ struct leafList_t {
 
 
 
-extern int       c_brush_traces;
-extern int       c_patch_traces;
-extern int       c_pointcontents;
-extern int       c_traces;
-extern clipMap_t cmg; // rwwRMG - changed from cm
+// statistics are counted per thread, com_speeds only shows the main thread
+extern thread_local int         c_brush_traces;
+extern thread_local int         c_patch_traces;
+extern thread_local int         c_pointcontents;
+extern thread_local int         c_traces;
+extern thread_local cmTempBox_t cm_tempBox;
+extern clipMap_t                cmg; // rwwRMG - changed from cm
+extern clipMap_t                SubBSP[MAX_SUB_BSP];
+
+// Returns the brush for a leaf brush number, the slot past the map's brushes is the thread's temporary box
+static inline cbrush_t *CM_BrushNum( clipMap_t *local, int brushnum ) {
+	return brushnum == local->numBrushes ? &cm_tempBox.brush : &local->brushes[brushnum];
+}
+
+// Marks num as tested by the current query, returns false if it already was
+static inline bool CM_Visit( uint32_t *marks, int num, uint32_t generation ) {
+	if ( marks[num] == generation ) {
+		return false;
+	}
+	marks[num] = generation;
+	return true;
+}
 
 
 
+void            CM_BeginVisit                ( traceWork_t *tw, clipMap_t *local );
 void            CM_BoxLeafnums_r             ( leafList_t *ll, int nodenum );
 void CM_ClearLevelPatches( void );
 cmodel_t       *CM_ClipHandleToModel         ( clipHandle_t handle, clipMap_t **clipMap = 0 );
@@ -185,9 +243,9 @@ CCMShader      *CM_GetShaderInfo             ( const char *name );
 CCMShader      *CM_GetShaderInfo             ( int shaderNum );
 void CM_GetWorldBounds ( vec3_t mins, vec3_t maxs );
 void CM_InitBoxHull (void);
+void            CM_PackBrushPlanes           ( cbrush_t *brush, cplanePack_t *packs );
 bool            CM_PositionTestInPatchCollide( traceWork_t *tw, const patchCollide_t *pc );
 void            CM_SetupShaderProperties     ( void );
 void            CM_ShutdownShaderProperties  ( void );
-void            CM_StoreBrushes              ( leafList_t *ll, int nodenum );
 void            CM_StoreLeafs                ( leafList_t *ll, int nodenum );
 void            CM_TraceThroughPatchCollide  ( traceWork_t *tw, trace_t &trace, const patchCollide_t *pc );
@@ -92,7 +92,6 @@ struct patchCollide_t {
 };
 
 struct cPatch_t {
-	int             checkcount; // to avoid repeated testings
 	int             surfaceFlags;
 	int             contents;
 	patchCollide_t *pc;
@@ -29,6 +29,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 void          CM_AdjustAreaPortalState    ( int area1, int area2, bool open );
 bool          CM_AreasConnected           ( int area1, int area2 );
+void          CM_Bench_f                  ( void );
 int           CM_BoxLeafnums              ( const vec3_t mins, const vec3_t maxs, int *boxList, int listsize, int *lastLeaf );
 void          CM_BoxTrace                 ( trace_t *results, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask, int capsule );
 void          CM_CalcExtents              ( const vec3_t start, const vec3_t end, const struct traceWork_s* tw, vec3pair_t bounds );
@@ -49,6 +50,7 @@ int           CM_LoadSubBSP               ( const char *name, bool clientload );
 int           CM_MarkFragments            ( int numPoints, const vec3_t* points, const vec3_t projection, int maxPoints, vec3_t pointBuffer, int maxFragments, markFragment_t *fragmentBuffer );
 void          CM_ModelBounds              ( clipHandle_t model, vec3_t mins, vec3_t maxs );
 int           CM_ModelContents            ( clipHandle_t model, int subBSPIndex );
+int           CM_NumClusters              ( void );
 int           CM_NumInlineModels          ( void );
 int           CM_PointContents            ( const vec3_t p, clipHandle_t model );
 int           CM_PointLeafnum             ( const vec3_t p );
@@ -76,40 +76,6 @@ void CM_StoreLeafs( leafList_t *ll, int nodenum ) {
 	ll->list[ ll->count++ ] = leafNum;
 }
 
-void CM_StoreBrushes( leafList_t *ll, int nodenum ) {
-	int			i, k;
-	int			leafnum;
-	int			brushnum;
-	cLeaf_t		*leaf;
-	cbrush_t	*b;
-
-	leafnum = -1 - nodenum;
-
-	leaf = &cmg.leafs[leafnum];
-
-	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
-		brushnum = cmg.leafbrushes[leaf->firstLeafBrush+k];
-		b = &cmg.brushes[brushnum];
-		if ( b->checkcount == cmg.checkcount ) {
-			continue;	// already checked this brush in another leaf
-		}
-		b->checkcount = cmg.checkcount;
-		for ( i = 0 ; i < 3 ; i++ ) {
-			if ( b->bounds[0][i] >= ll->bounds[1][i] || b->bounds[1][i] <= ll->bounds[0][i] ) {
-				break;
-			}
-		}
-		if ( i != 3 ) {
-			continue;
-		}
-		if ( ll->count >= ll->maxcount) {
-			ll->overflowed = true;
-			return;
-		}
-		((cbrush_t **)ll->list)[ ll->count++ ] = b;
-	}
-}
-
 // Fills in a list of all the leafs touched
 void CM_BoxLeafnums_r( leafList_t *ll, int nodenum ) {
 	cplane_t	*plane;
@@ -145,8 +111,6 @@ int	CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *boxList, int list
 	//rwwRMG - changed to boxList to not conflict with list type
 	leafList_t	ll;
 
-	cmg.checkcount++;
-
 	VectorCopy( mins, ll.bounds[0] );
 	VectorCopy( maxs, ll.bounds[1] );
 	ll.count = 0;
@@ -201,7 +165,7 @@ int CM_PointContents( const vec3_t p, clipHandle_t model ) {
 	contents = 0;
 	for (k=0 ; k<leaf->numLeafBrushes ; k++) {
 		brushnum = local->leafbrushes[leaf->firstLeafBrush+k];
-		b = &local->brushes[brushnum];
+		b = CM_BrushNum( local, brushnum );
 
 		// see if the point is in the brush
 		for ( i = 0 ; i < b->numsides ; i++ ) {
@@ -25,6 +25,10 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/cm_local.h"
 #include "qcommon/com_cvars.h"
 
+#if CM_PLANES_SSE2
+	#include <emmintrin.h>
+#endif
+
 // always use bbox vs. bbox collision and never capsule vs. bbox or vice versa
 //#define ALWAYS_BBOX_VS_BBOX
 // always use capsule vs. capsule collision and never capsule vs. bbox or vice versa
@@ -86,16 +90,123 @@ float CM_DistanceFromLineSquared(vec3_t p, vec3_t lp1, vec3_t lp2, vec3_t dir) {
 	return VectorLengthSquared(t);
 }
 
-// POSITION TESTING
+// BRUSH PLANE TESTS
 
-void CM_TestBoxInBrush( traceWork_t *tw, trace_t &trace, cbrush_t *brush ) {
+// The plane tests work on one block of packed planes at a time.
+// Both versions do the same float operations in the same order as the
+// scalar code they replace, so the results match it to the bit.
+
+#if CM_PLANES_SSE2
+// plane distances pushed out by the corner of the trace box that is closest to each plane
+static inline __m128 CM_PlaneBlockBoxDist( const traceWork_t *tw, const cplanePack_t *pack, __m128 nx, __m128 ny, __m128 nz ) {
+	const __m128i	sb = _mm_loadu_si128( (const __m128i *)pack->signbits );
+	__m128			mask, ox, oy, oz;
+
+	// offsets[signbits][x] is size[1][x] where bit x of signbits is set
+	mask = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( sb, _mm_set1_epi32( 1 ) ), _mm_set1_epi32( 1 ) ) );
+	ox = _mm_or_ps( _mm_and_ps( mask, _mm_set1_ps( tw->size[1][0] ) ), _mm_andnot_ps( mask, _mm_set1_ps( tw->size[0][0] ) ) );
+	mask = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( sb, _mm_set1_epi32( 2 ) ), _mm_set1_epi32( 2 ) ) );
+	oy = _mm_or_ps( _mm_and_ps( mask, _mm_set1_ps( tw->size[1][1] ) ), _mm_andnot_ps( mask, _mm_set1_ps( tw->size[0][1] ) ) );
+	mask = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( sb, _mm_set1_epi32( 4 ) ), _mm_set1_epi32( 4 ) ) );
+	oz = _mm_or_ps( _mm_and_ps( mask, _mm_set1_ps( tw->size[1][2] ) ), _mm_andnot_ps( mask, _mm_set1_ps( tw->size[0][2] ) ) );
+
+	return _mm_sub_ps( _mm_loadu_ps( pack->dist ),
+		_mm_add_ps( _mm_add_ps( _mm_mul_ps( ox, nx ), _mm_mul_ps( oy, ny ) ), _mm_mul_ps( oz, nz ) ) );
+}
+
+static inline __m128 CM_PlaneBlockPointDist( const vec3_t p, __m128 nx, __m128 ny, __m128 nz, __m128 dist ) {
+	return _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( p[0] ), nx ), _mm_mul_ps( _mm_set1_ps( p[1] ), ny ) ),
+		_mm_mul_ps( _mm_set1_ps( p[2] ), nz ) ), dist );
+}
+#endif
+
+// Distances of the trace start and end points to a block of planes, adjusted for mins/maxs
+static void CM_PlaneBlockTraceDists( const traceWork_t *tw, const cplanePack_t *pack, float *d1, float *d2 ) {
+#if CM_PLANES_SSE2
+	const __m128	nx = _mm_loadu_ps( pack->normal[0] );
+	const __m128	ny = _mm_loadu_ps( pack->normal[1] );
+	const __m128	nz = _mm_loadu_ps( pack->normal[2] );
+	const __m128	dist = CM_PlaneBlockBoxDist( tw, pack, nx, ny, nz );
+
+	_mm_storeu_ps( d1, CM_PlaneBlockPointDist( tw->start, nx, ny, nz, dist ) );
+	_mm_storeu_ps( d2, CM_PlaneBlockPointDist( tw->end, nx, ny, nz, dist ) );
+#else
 	int			i;
-	cplane_t	*plane;
 	float		dist;
-	float		d1;
-	cbrushside_t	*side;
-	float		t;
-	vec3_t		startp;
+	vec3_t		normal;
+
+	for ( i = 0 ; i < PLANE_PACK_WIDTH ; i++ ) {
+		VectorSet( normal, pack->normal[0][i], pack->normal[1][i], pack->normal[2][i] );
+		dist = pack->dist[i] - DotProduct( tw->offsets[ pack->signbits[i] ], normal );
+		d1[i] = DotProduct( tw->start, normal ) - dist;
+		d2[i] = DotProduct( tw->end, normal ) - dist;
+	}
+#endif
+}
+
+// Distances of the trace start point to a block of planes, adjusted for mins/maxs
+static void CM_PlaneBlockBoxDists( const traceWork_t *tw, const cplanePack_t *pack, float *d1 ) {
+#if CM_PLANES_SSE2
+	const __m128	nx = _mm_loadu_ps( pack->normal[0] );
+	const __m128	ny = _mm_loadu_ps( pack->normal[1] );
+	const __m128	nz = _mm_loadu_ps( pack->normal[2] );
+
+	_mm_storeu_ps( d1, CM_PlaneBlockPointDist( tw->start, nx, ny, nz, CM_PlaneBlockBoxDist( tw, pack, nx, ny, nz ) ) );
+#else
+	int			i;
+	float		dist;
+	vec3_t		normal;
+
+	for ( i = 0 ; i < PLANE_PACK_WIDTH ; i++ ) {
+		VectorSet( normal, pack->normal[0][i], pack->normal[1][i], pack->normal[2][i] );
+		dist = pack->dist[i] - DotProduct( tw->offsets[ pack->signbits[i] ], normal );
+		d1[i] = DotProduct( tw->start, normal ) - dist;
+	}
+#endif
+}
+
+// Distances of the capsule point closest to each plane of a block, adjusted for the capsule radius
+static void CM_PlaneBlockSphereDists( const traceWork_t *tw, const cplanePack_t *pack, float *d1 ) {
+#if CM_PLANES_SSE2
+	const __m128	nx = _mm_loadu_ps( pack->normal[0] );
+	const __m128	ny = _mm_loadu_ps( pack->normal[1] );
+	const __m128	nz = _mm_loadu_ps( pack->normal[2] );
+	const __m128	dist = _mm_add_ps( _mm_loadu_ps( pack->dist ), _mm_set1_ps( tw->sphere.radius ) );
+	__m128			t, px, py, pz;
+
+	// start - offset where the offset points along the normal, start + offset otherwise
+	t = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, _mm_set1_ps( tw->sphere.offset[0] ) ), _mm_mul_ps( ny, _mm_set1_ps( tw->sphere.offset[1] ) ) ),
+		_mm_mul_ps( nz, _mm_set1_ps( tw->sphere.offset[2] ) ) );
+	t = _mm_cmpgt_ps( t, _mm_setzero_ps() );
+	px = _mm_or_ps( _mm_and_ps( t, _mm_set1_ps( tw->start[0] - tw->sphere.offset[0] ) ), _mm_andnot_ps( t, _mm_set1_ps( tw->start[0] + tw->sphere.offset[0] ) ) );
+	py = _mm_or_ps( _mm_and_ps( t, _mm_set1_ps( tw->start[1] - tw->sphere.offset[1] ) ), _mm_andnot_ps( t, _mm_set1_ps( tw->start[1] + tw->sphere.offset[1] ) ) );
+	pz = _mm_or_ps( _mm_and_ps( t, _mm_set1_ps( tw->start[2] - tw->sphere.offset[2] ) ), _mm_andnot_ps( t, _mm_set1_ps( tw->start[2] + tw->sphere.offset[2] ) ) );
+
+	_mm_storeu_ps( d1, _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( px, nx ), _mm_mul_ps( py, ny ) ), _mm_mul_ps( pz, nz ) ), dist ) );
+#else
+	int			i;
+	float		dist, t;
+	vec3_t		normal, startp;
+
+	for ( i = 0 ; i < PLANE_PACK_WIDTH ; i++ ) {
+		VectorSet( normal, pack->normal[0][i], pack->normal[1][i], pack->normal[2][i] );
+		dist = pack->dist[i] + tw->sphere.radius;
+		t = DotProduct( normal, tw->sphere.offset );
+		if ( t > 0 ) {
+			VectorSubtract( tw->start, tw->sphere.offset, startp );
+		} else {
+			VectorAdd( tw->start, tw->sphere.offset, startp );
+		}
+		d1[i] = DotProduct( startp, normal ) - dist;
+	}
+#endif
+}
+
+// POSITION TESTING
+
+void CM_TestBoxInBrush( traceWork_t *tw, trace_t &trace, cbrush_t *brush ) {
+	int			i, j, end;
+	float		d1[PLANE_PACK_WIDTH];
 
 	if (!brush->numsides) {
 		return;
@@ -112,45 +223,26 @@ void CM_TestBoxInBrush( traceWork_t *tw, trace_t &trace, cbrush_t *brush ) {
 		return;
 	}
 
-   if ( tw->sphere.use ) {
-		// the first six planes are the axial planes, so we only
-		// need to test the remainder
-		for ( i = 6 ; i < brush->numsides ; i++ ) {
-			side = brush->sides + i;
-			plane = side->plane;
+	c_brush_traces++;
 
-			// adjust the plane distance appropriately for radius
-			dist = plane->dist + tw->sphere.radius;
-			// find the closest point on the capsule to the plane
-			t = DotProduct( plane->normal, tw->sphere.offset );
-			if ( t > 0 )
-			{
-				VectorSubtract( tw->start, tw->sphere.offset, startp );
-			}
-			else
-			{
-				VectorAdd( tw->start, tw->sphere.offset, startp );
-			}
-			d1 = DotProduct( startp, plane->normal ) - dist;
-			// if completely in front of face, no intersection
-			if ( d1 > 0 ) {
-				return;
-			}
+	// the first six planes are the axial planes, so we only
+	// need to test the remainder
+	for ( i = 6 ; i < brush->numsides ; i = end ) {
+		end = ( i / PLANE_PACK_WIDTH + 1 ) * PLANE_PACK_WIDTH;
+		if ( end > brush->numsides ) {
+			end = brush->numsides;
 		}
-	} else {
-		// the first six planes are the axial planes, so we only
-		// need to test the remainder
-		for ( i = 6 ; i < brush->numsides ; i++ ) {
-			side = brush->sides + i;
-			plane = side->plane;
 
-			// adjust the plane distance appropriately for mins/maxs
-			dist = plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal );
-
-			d1 = DotProduct( tw->start, plane->normal ) - dist;
+		if ( tw->sphere.use ) {
+			// distance from the closest point on the capsule to each plane
+			CM_PlaneBlockSphereDists( tw, &brush->planes[i / PLANE_PACK_WIDTH], d1 );
+		} else {
+			CM_PlaneBlockBoxDists( tw, &brush->planes[i / PLANE_PACK_WIDTH], d1 );
+		}
 
+		for ( j = i ; j < end ; j++ ) {
 			// if completely in front of face, no intersection
-			if ( d1 > 0 ) {
+			if ( d1[j % PLANE_PACK_WIDTH] > 0 ) {
 				return;
 			}
 		}
@@ -165,18 +257,17 @@ void CM_TestBoxInBrush( traceWork_t *tw, trace_t &trace, cbrush_t *brush ) {
 void CM_TestInLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *local )
 {
 	int			k;
-	int			brushnum;
+	int			brushnum, surfnum;
 	cbrush_t	*b;
 	cPatch_t	*patch;
 
 	// test box position against all brushes in the leaf
 	for (k=0 ; k<leaf->numLeafBrushes ; k++) {
 		brushnum = local->leafbrushes[leaf->firstLeafBrush+k];
-		b = &local->brushes[brushnum];
-		if (b->checkcount == local->checkcount) {
+		if ( !CM_Visit( tw->visitedBrushes, brushnum, tw->visitGeneration ) ) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = local->checkcount;
+		b = CM_BrushNum( local, brushnum );
 
 		if ( !(b->contents & tw->contents)) {
 			continue;
@@ -191,19 +282,20 @@ void CM_TestInLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *l
 	// test against all patches
 	if ( !cm_noCurves->integer ) {
 		for ( k = 0 ; k < leaf->numLeafSurfaces ; k++ ) {
-			patch = local->surfaces[ local->leafsurfaces[ leaf->firstLeafSurface + k ] ];
+			surfnum = local->leafsurfaces[ leaf->firstLeafSurface + k ];
+			patch = local->surfaces[ surfnum ];
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == local->checkcount ) {
+			if ( !CM_Visit( tw->visitedSurfaces, surfnum, tw->visitGeneration ) ) {
 				continue;	// already checked this brush in another leaf
 			}
-			patch->checkcount = local->checkcount;
 
 			if ( !(patch->contents & tw->contents)) {
 				continue;
 			}
 
+			c_patch_traces++;
 			if ( CM_PositionTestInPatchCollide( tw, patch->pc ) ) {
 				trace.startsolid = trace.allsolid = true;
 				trace.fraction = 0;
@@ -331,12 +423,8 @@ void CM_PositionTest( traceWork_t *tw, trace_t &trace ) {
 	ll.lastLeaf = 0;
 	ll.overflowed = false;
 
-	cmg.checkcount++;
-
 	CM_BoxLeafnums_r( &ll, 0 );
 
-	cmg.checkcount++;
-
 	// test the contents of the leafs
 	for (i=0 ; i < ll.count ; i++) {
 		CM_TestInLeaf( tw, trace, &cmg.leafs[leafs[i]], &cmg );
@@ -348,6 +436,36 @@ void CM_PositionTest( traceWork_t *tw, trace_t &trace ) {
 
 // TRACING
 
+// Starts a query against local with none of its brushes or surfaces marked as tested.
+// The marks live in per thread storage, so any number of threads may trace at once.
+void CM_BeginVisit( traceWork_t *tw, clipMap_t *local ) {
+	static thread_local cmVisited_t	visited[1 + MAX_SUB_BSP];
+	cmVisited_t	*v;
+	size_t		numBrushes, numSurfaces;
+
+	v = &visited[local == &cmg ? 0 : 1 + (local - SubBSP)];
+
+	// the extra brush is the slot of the temporary box model
+	numBrushes = local->numBrushes + 1;
+	numSurfaces = local->numSurfaces;
+	if ( v->brushes.size() != numBrushes || v->surfaces.size() != numSurfaces ) {
+		v->brushes.assign( numBrushes, 0 );
+		v->surfaces.assign( numSurfaces, 0 );
+		v->generation = 0;
+	}
+
+	if ( ++v->generation == 0 ) {
+		// wrapped, clear the old marks so none of them can match again
+		std::fill( v->brushes.begin(), v->brushes.end(), 0 );
+		std::fill( v->surfaces.begin(), v->surfaces.end(), 0 );
+		v->generation = 1;
+	}
+
+	tw->visitedBrushes = v->brushes.data();
+	tw->visitedSurfaces = v->surfaces.data();
+	tw->visitGeneration = v->generation;
+}
+
 void CM_TraceThroughPatch( traceWork_t *tw, trace_t &trace, cPatch_t *patch ) {
 	float		oldFrac;
 
@@ -364,19 +482,13 @@ void CM_TraceThroughPatch( traceWork_t *tw, trace_t &trace, cPatch_t *patch ) {
 }
 
 // Returns false for a quick getout
-bool CM_PlaneCollision(traceWork_t *tw, cbrushside_t *side)
+// d1 and d2 are the start and end distances to the side's plane, adjusted for mins/maxs
+static bool CM_PlaneCollision(traceWork_t *tw, cbrushside_t *side, float d1, float d2)
 {
-	float			dist, f;
-	float			d1, d2;
+	float			f;
 
 	cplane_t		*plane = side->plane;
 
-	// adjust the plane distance appropriately for mins/maxs
-	dist = plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal );
-
-	d1 = DotProduct( tw->start, plane->normal ) - dist;
-	d2 = DotProduct( tw->end, plane->normal ) - dist;
-
 	if (d2 > 0.0f)
 	{
 		// endpoint is not in solid
@@ -441,8 +553,8 @@ bool CM_PlaneCollision(traceWork_t *tw, cbrushside_t *side)
 
 void CM_TraceThroughBrush( traceWork_t *tw, trace_t &trace, cbrush_t *brush, bool infoOnly )
 {
-	int				i;
-	cbrushside_t	*side;
+	int				i, j;
+	float			d1[PLANE_PACK_WIDTH], d2[PLANE_PACK_WIDTH];
 
 	tw->enterFrac = -1.0f;
 	tw->leaveFrac = 1.0f;
@@ -466,6 +578,8 @@ void CM_TraceThroughBrush( traceWork_t *tw, trace_t &trace, cbrush_t *brush, boo
 		return;
 	}
 
+	c_brush_traces++;
+
 	tw->getout = false;
 	tw->startout = false;
 	tw->leadside = nullptr;
@@ -474,13 +588,16 @@ void CM_TraceThroughBrush( traceWork_t *tw, trace_t &trace, cbrush_t *brush, boo
 	// find the latest time the trace crosses a plane towards the interior
 	// and the earliest time the trace crosses a plane towards the exterior
 
-	for (i = 0; i < brush->numsides; i++)
+	for (i = 0; i < brush->numsides; i += PLANE_PACK_WIDTH)
 	{
-		side = brush->sides + i;
+		CM_PlaneBlockTraceDists(tw, &brush->planes[i / PLANE_PACK_WIDTH], d1, d2);
 
-		if(!CM_PlaneCollision(tw, side))
+		for (j = 0; j < PLANE_PACK_WIDTH && i + j < brush->numsides; j++)
 		{
-			return;
+			if(!CM_PlaneCollision(tw, brush->sides + i + j, d1[j], d2[j]))
+			{
+				return;
+			}
 		}
 	}
 
@@ -543,7 +660,7 @@ bool CM_GenericBoxCollide(const vec3pair_t abounds, const vec3pair_t bbounds)
 
 void CM_TraceThroughLeaf( traceWork_t *tw, trace_t &trace, clipMap_t *local, cLeaf_t *leaf ) {
 	int			k;
-	int			brushnum;
+	int			brushnum, surfnum;
 	cbrush_t	*b;
 	cPatch_t	*patch;
 
@@ -551,11 +668,10 @@ void CM_TraceThroughLeaf( traceWork_t *tw, trace_t &trace, clipMap_t *local, cLe
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
 		brushnum = local->leafbrushes[leaf->firstLeafBrush+k];
 
-		b = &local->brushes[brushnum];
-		if ( b->checkcount == local->checkcount ) {
+		if ( !CM_Visit( tw->visitedBrushes, brushnum, tw->visitGeneration ) ) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = local->checkcount;
+		b = CM_BrushNum( local, brushnum );
 
 		if ( !(b->contents & tw->contents) ) {
 			continue;
@@ -571,14 +687,14 @@ void CM_TraceThroughLeaf( traceWork_t *tw, trace_t &trace, clipMap_t *local, cLe
 	// trace line against all patches in the leaf
 	if ( !cm_noCurves->integer ) {
 		for ( k = 0 ; k < leaf->numLeafSurfaces ; k++ ) {
-			patch = local->surfaces[ local->leafsurfaces[ leaf->firstLeafSurface + k ] ];
+			surfnum = local->leafsurfaces[ leaf->firstLeafSurface + k ];
+			patch = local->surfaces[ surfnum ];
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == local->checkcount ) {
+			if ( !CM_Visit( tw->visitedSurfaces, surfnum, tw->visitGeneration ) ) {
 				continue;	// already checked this patch in another leaf
 			}
-			patch->checkcount = local->checkcount;
 
 			if ( !(patch->contents & tw->contents) ) {
 				continue;
@@ -863,7 +979,7 @@ void CM_TraceBoundingBoxThroughCapsule( traceWork_t *tw, trace_t &trace, clipHan
 void CM_TraceToLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *local )
 {
 	int			k;
-	int			brushnum;
+	int			brushnum, surfnum;
 	cbrush_t	*b;
 	cPatch_t	*patch;
 
@@ -872,12 +988,11 @@ void CM_TraceToLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *
 	{
 		brushnum = local->leafbrushes[leaf->firstLeafBrush + k];
 
-		b = &local->brushes[brushnum];
-		if ( b->checkcount == local->checkcount )
+		if ( !CM_Visit( tw->visitedBrushes, brushnum, tw->visitGeneration ) )
 		{
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = local->checkcount;
+		b = CM_BrushNum( local, brushnum );
 
 		if ( !(b->contents & tw->contents) )
 		{
@@ -894,14 +1009,14 @@ void CM_TraceToLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *
 	// trace line against all patches in the leaf
 	if ( !cm_noCurves->integer ) {
 		for ( k = 0 ; k < leaf->numLeafSurfaces ; k++ ) {
-			patch = local->surfaces[ local->leafsurfaces[ leaf->firstLeafSurface + k ] ];
+			surfnum = local->leafsurfaces[ leaf->firstLeafSurface + k ];
+			patch = local->surfaces[ surfnum ];
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == local->checkcount ) {
+			if ( !CM_Visit( tw->visitedSurfaces, surfnum, tw->visitGeneration ) ) {
 				continue;	// already checked this patch in another leaf
 			}
-			patch->checkcount = local->checkcount;
 
 			if ( !(patch->contents & tw->contents) ) {
 				continue;
@@ -1050,12 +1165,11 @@ void CM_Trace( trace_t *trace, const vec3_t start, const vec3_t end,
 
 	cmod = CM_ClipHandleToModel( model, &local );
 
-	local->checkcount++;		// for multi-check avoidance
-
 	c_traces++;				// for statistics, may be zeroed
 
 	// fill in a default trace
 	Com_Memset( &tw, 0, sizeof(tw) );
+	CM_BeginVisit( &tw, local );	// for multi-check avoidance
 	memset(trace, 0, sizeof(*trace));
 	trace->fraction = 1;	// assume it goes the entire distance until shown otherwise
 	VectorCopy(origin, tw.modelOrigin);
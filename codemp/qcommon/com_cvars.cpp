@@ -143,6 +143,7 @@ cvar_t *com_affinity;
 cvar_t *com_buildScript;
 cvar_t *com_busyWait;
 cvar_t *com_cameraMode;
+cvar_t *com_jobThreads;
 cvar_t *com_journal;
 cvar_t *com_showtrace;
 cvar_t *com_speeds;
@@ -197,17 +198,22 @@ cvar_t *m_yaw;
 cvar_t *mapname;
 cvar_t *model;
 cvar_t *name;
+cvar_t *net_batch;
 cvar_t *net_dropsim;
 cvar_t *net_enabled;
 cvar_t *net_forcenonlocal;
 cvar_t *net_ip;
+cvar_t *net_ip6;
 cvar_t *net_port;
+cvar_t *net_port6;
 cvar_t *net_qport;
+cvar_t *net_sockets;
 cvar_t *net_socksEnabled;
 cvar_t *net_socksPassword;
 cvar_t *net_socksPort;
 cvar_t *net_socksServer;
 cvar_t *net_socksUsername;
+cvar_t *net_thread;
 cvar_t *nextdemo;
 cvar_t *nextmap;
 cvar_t *password;
@@ -255,8 +261,10 @@ cvar_t *sv_autoDemo;
 cvar_t *sv_autoDemoBots;
 cvar_t *sv_autoDemoMaxMaps;
 cvar_t *sv_banFile;
+cvar_t *sv_broadphase;
 cvar_t *sv_cheats;
 cvar_t *sv_clientRate;
+cvar_t *sv_demoKeyframes;
 cvar_t *sv_filterCommands;
 cvar_t *sv_floodProtect;
 cvar_t *sv_floodProtectSlow;
@@ -434,6 +442,7 @@ void Com_InitCvars( void ) {
 	com_buildScript =           Cvar_Get( "com_buildScript",           "0",                                    CVAR_NONE,                                   "" );
 	com_busyWait =              Cvar_Get( "com_busyWait",              "0",                                    CVAR_ARCHIVE_ND,                             "" );
 	com_cameraMode =            Cvar_Get( "com_cameraMode",            "0",                                    CVAR_CHEAT,                                  "" );
+	com_jobThreads =            Cvar_Get( "com_jobThreads",            "0",                                    CVAR_ARCHIVE_ND,                             "Number of worker threads used to parallelise server work, 0 disables" );
 	com_journal =               Cvar_Get( "com_journal",               "0",                                    CVAR_INIT,                                   "" );
 	com_showtrace =             Cvar_Get( "com_showtrace",             "0",                                    CVAR_CHEAT,                                  "" );
 	com_speeds =                Cvar_Get( "com_speeds",                "0",                                    CVAR_NONE,                                   "" );
@@ -487,18 +496,23 @@ void Com_InitCvars( void ) {
 	mapname =                   Cvar_Get( "mapname",                   "nomap",                                CVAR_SERVERINFO | CVAR_ROM,                  "" );
 	model =                     Cvar_Get( "model",                     DEFAULT_MODEL "/default",               CVAR_USERINFO | CVAR_ARCHIVE,                "Player model" );
 	name =                      Cvar_Get( "name",                      "Padawan",                              CVAR_USERINFO | CVAR_ARCHIVE_ND,             "Player name" );
+	net_batch =                 Cvar_Get( "net_batch",                 "1",                                    CVAR_ARCHIVE_ND,                             "Move packets in batches of system calls where supported (recvmmsg/sendmmsg on Linux)" );
 	net_dropsim =               Cvar_Get( "net_dropsim",               "",                                     CVAR_TEMP,                                   "" );
-	net_enabled =               Cvar_Get( "net_enabled",               "1",                                    CVAR_LATCH | CVAR_ARCHIVE_ND,                "" );
+	net_enabled =               Cvar_Get( "net_enabled",               "3",                                    CVAR_LATCH | CVAR_ARCHIVE_ND,                "1 ipv4, 2 ipv6, 4 prefer ipv6 when resolving names, add together" );
 	net_forcenonlocal =         Cvar_Get( "net_forcenonlocal",         "0",                                    CVAR_LATCH | CVAR_ARCHIVE_ND,                "" );
 	net_forcenonlocal =         Cvar_Get( "net_forcenonlocal",         "0",                                    CVAR_NONE,                                   "" );
 	net_ip =                    Cvar_Get( "net_ip",                    "localhost",                            CVAR_LATCH,                                  "" );
+	net_ip6 =                   Cvar_Get( "net_ip6",                   "::",                                   CVAR_LATCH,                                  "" );
 	net_port =                  Cvar_Get( "net_port",                  XSTRING( PORT_SERVER ),                 CVAR_LATCH,                                  "" );
+	net_port6 =                 Cvar_Get( "net_port6",                 XSTRING( PORT_SERVER ),                 CVAR_LATCH,                                  "" );
 	net_qport =                 Cvar_Get( "net_qport",                 "0",                                    CVAR_INIT,                                   "" );
+	net_sockets =               Cvar_Get( "net_sockets",               "1",                                    CVAR_LATCH | CVAR_ARCHIVE_ND,                "Sockets bound per address family, more than 1 shares the port with SO_REUSEPORT to spread receives" );
 	net_socksEnabled =          Cvar_Get( "net_socksEnabled",          "0",                                    CVAR_LATCH | CVAR_ARCHIVE_ND,                "" );
 	net_socksPassword =         Cvar_Get( "net_socksPassword",         "",                                     CVAR_LATCH | CVAR_ARCHIVE_ND,                "" );
 	net_socksPort =             Cvar_Get( "net_socksPort",             "1080",                                 CVAR_LATCH | CVAR_ARCHIVE_ND,                "" );
 	net_socksServer =           Cvar_Get( "net_socksServer",           "",                                     CVAR_LATCH | CVAR_ARCHIVE_ND,                "" );
 	net_socksUsername =         Cvar_Get( "net_socksUsername",         "",                                     CVAR_LATCH | CVAR_ARCHIVE_ND,                "" );
+	net_thread =                Cvar_Get( "net_thread",                "0",                                    CVAR_LATCH | CVAR_ARCHIVE_ND,                "Read packets on their own thread, which timestamps them as they arrive" );
 	nextdemo =                  Cvar_Get( "nextdemo",                  "",                                     CVAR_INTERNAL,                               "" );
 	nextmap =                   Cvar_Get( "nextmap",                   "",                                     CVAR_TEMP,                                   "" );
 	password =                  Cvar_Get( "password",                  "",                                     CVAR_USERINFO,                               "Password to join server" );
@@ -547,9 +561,11 @@ void Com_InitCvars( void ) {
 	sv_autoDemoBots =           Cvar_Get( "sv_autoDemoBots",           "0",                                    CVAR_ARCHIVE_ND,                             "Record server-side demos for bots" );
 	sv_autoDemoMaxMaps =        Cvar_Get( "sv_autoDemoMaxMaps",        "0",                                    CVAR_ARCHIVE_ND,                             "" );
 	sv_banFile =                Cvar_Get( "sv_banFile",                "serverbans.dat",                       CVAR_ARCHIVE,                                "File to use to store bans and exceptions" );
+	sv_broadphase =             Cvar_Get( "sv_broadphase",             "0",                                    CVAR_ARCHIVE_ND | CVAR_LATCH,                "Entity broadphase used for area queries, 0 world sector tree, 1 loose grid" );
 	sv_cheats =                 Cvar_Get( "sv_cheats",                 "1",                                    CVAR_ROM | CVAR_SYSTEMINFO,                  "Allow cheats on server if set to 1" );
 	sv_cheats =                 Cvar_Get( "sv_cheats",                 "1",                                    CVAR_SYSTEMINFO | CVAR_ROM,                  "Allow cheats on server if set to 1" );
 	sv_clientRate =             Cvar_Get( "sv_clientRate",             "50000",                                CVAR_ARCHIVE_ND,                             "" );
+	sv_demoKeyframes =          Cvar_Get( "sv_demoKeyframes",          "0",                                    CVAR_ARCHIVE_ND,                             "Seconds between seek keyframes in server demos, 0 records classic .dm_ demos" );
 	sv_filterCommands =         Cvar_Get( "sv_filterCommands",         "1",                                    CVAR_ARCHIVE,                                "" );
 	sv_floodProtect =           Cvar_Get( "sv_floodProtect",           "1",                                    CVAR_ARCHIVE | CVAR_SERVERINFO,              "Protect against flooding of server commands" );
 	sv_floodProtectSlow =       Cvar_Get( "sv_floodProtectSlow",       "1",                                    CVAR_ARCHIVE | CVAR_SERVERINFO,              "Use original method of delaying commands with flood protection" );
@@ -597,7 +613,10 @@ void Com_InitCvars( void ) {
 	#ifdef DEDICATED
 		Cvar_CheckRange( dedicated, 1, 2, true );
 	#endif
+	Cvar_CheckRange( com_jobThreads, 0, 16, true );
+	Cvar_CheckRange( net_sockets, 1, MAX_NET_SOCKETS, true );
 	Cvar_CheckRange( scr_conspeed, 1.0f, 100.0f, false );
+	Cvar_CheckRange( sv_broadphase, 0, 1, true );
 	Cvar_CheckRange( sv_privateClients, 0, MAX_CLIENTS, true );
 	Cvar_CheckRange( sv_ratePolicy, 1, 2, true );
 	Cvar_CheckRange( sv_snapsPolicy, 0, 2, true );
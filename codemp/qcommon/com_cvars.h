@@ -145,6 +145,7 @@ extern cvar_t *com_affinity;
 extern cvar_t *com_buildScript;
 extern cvar_t *com_busyWait;
 extern cvar_t *com_cameraMode;
+extern cvar_t *com_jobThreads;
 extern cvar_t *com_journal;
 extern cvar_t *com_showtrace;
 extern cvar_t *com_speeds;
@@ -199,17 +200,22 @@ extern cvar_t *m_yaw;
 extern cvar_t *mapname;
 extern cvar_t *model;
 extern cvar_t *name;
+extern cvar_t *net_batch;
 extern cvar_t *net_dropsim;
 extern cvar_t *net_enabled;
 extern cvar_t *net_forcenonlocal;
 extern cvar_t *net_ip;
+extern cvar_t *net_ip6;
 extern cvar_t *net_port;
+extern cvar_t *net_port6;
 extern cvar_t *net_qport;
+extern cvar_t *net_sockets;
 extern cvar_t *net_socksEnabled;
 extern cvar_t *net_socksPassword;
 extern cvar_t *net_socksPort;
 extern cvar_t *net_socksServer;
 extern cvar_t *net_socksUsername;
+extern cvar_t *net_thread;
 extern cvar_t *nextdemo;
 extern cvar_t *nextmap;
 extern cvar_t *password;
@@ -257,9 +263,11 @@ extern cvar_t *sv_autoDemo;
 extern cvar_t *sv_autoDemoBots;
 extern cvar_t *sv_autoDemoMaxMaps;
 extern cvar_t *sv_banFile;
+extern cvar_t *sv_broadphase;
 extern cvar_t *sv_cheats;
 extern cvar_t *sv_cheats;
 extern cvar_t *sv_clientRate;
+extern cvar_t *sv_demoKeyframes;
 extern cvar_t *sv_filterCommands;
 extern cvar_t *sv_floodProtect;
 extern cvar_t *sv_floodProtectSlow;
@@ -0,0 +1,434 @@
+/*
+===========================================================================
+Copyright (C) 2019 - 2020, CleanJoKe contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// com_demo.cpp -- block compressed demo container with keyframes and a seek index
+
+#include "qcommon/com_demo.h"
+
+#ifdef USE_INTERNAL_ZLIB
+#include "zlib/zlib.h"
+#else
+#include <zlib.h>
+#endif
+
+// file layout, all ints little endian
+//	header		ident, version
+//	blocks		demoBlockHeader_t, then compressedLength bytes of records: type, sequence, length, data
+//	index		demoBlockHeader_t with kind DEMO_BLOCK_INDEX, then rawLength bytes of demoKeyframe_t
+//	trailer		offset of the index block, index ident
+
+#define DEMO_IDENT				(('Z'<<24)+('D'<<16)+('K'<<8)+'J')
+#define DEMO_INDEX_IDENT		(('X'<<24)+('D'<<16)+('K'<<8)+'J')
+#define DEMO_VERSION			1
+#define DEMO_HEADER_SIZE		8
+#define DEMO_TRAILER_SIZE		8
+#define DEMO_RECORD_HEADER		12
+#define DEMO_BLOCK_SIZE			0x10000		// raw bytes gathered before a block is compressed
+#define DEMO_BLOCK_MAX			( DEMO_BLOCK_SIZE + DEMO_RECORD_HEADER + MAX_MSGLEN )
+#define DEMO_MAX_KEYFRAMES		0x100000
+
+enum demoBlockKind_e {
+	DEMO_BLOCK_DATA = 1,
+	DEMO_BLOCK_INDEX
+};
+
+enum demoRecord_e {
+	DEMO_RECORD_MESSAGE = 1,
+	DEMO_RECORD_GAMESTATE		// only read when playback starts here
+};
+
+struct demoBlockHeader_t {
+	int		kind;
+	int		keyframeTime;		// server time of the gamestate the block starts with, -1 if it doesn't
+	int		rawLength;
+	int		compressedLength;	// equal to rawLength if the block is stored
+};
+
+struct demoKeyframe_t {
+	int		serverTime;
+	int		offset;				// of the block header
+};
+
+struct demoWriter_t {
+	fileHandle_t	file;
+	int				offset;			// bytes written so far, demo files are async so FS_FTell can't be used
+	int				keyframeTime;	// of the block being filled
+	int				rawLength;
+	byte			raw[DEMO_BLOCK_MAX];
+	byte			*compressed;
+	uLong			compressedSize;
+	int				numKeyframes;
+	int				maxKeyframes;
+	demoKeyframe_t	*keyframes;
+};
+
+struct demoReader_t {
+	fileHandle_t	file;
+	int				fileLength;
+	int				offset;			// of the next block header
+	bool			wantGamestate;	// set until the gamestate playback starts from has been returned
+	int				rawLength;
+	int				rawPos;
+	byte			raw[DEMO_BLOCK_MAX];
+	byte			*compressed;
+	uLong			compressedSize;
+	int				numKeyframes;
+	int				maxKeyframes;
+	demoKeyframe_t	*keyframes;
+};
+
+static void Demo_AddKeyframe( demoKeyframe_t **keyframes, int *numKeyframes, int *maxKeyframes, int serverTime, int offset ) {
+	demoKeyframe_t *grown;
+
+	if ( *numKeyframes == *maxKeyframes ) {
+		*maxKeyframes = *maxKeyframes ? *maxKeyframes * 2 : 64;
+		grown = (demoKeyframe_t *)Z_Malloc( *maxKeyframes * sizeof( demoKeyframe_t ), TAG_GENERAL );
+		if ( *keyframes ) {
+			memcpy( grown, *keyframes, *numKeyframes * sizeof( demoKeyframe_t ) );
+			Z_Free( *keyframes );
+		}
+		*keyframes = grown;
+	}
+	(*keyframes)[*numKeyframes].serverTime = serverTime;
+	(*keyframes)[*numKeyframes].offset = offset;
+	(*numKeyframes)++;
+}
+
+static void Demo_PutLong( byte *p, int value ) {
+	value = LittleLong( value );
+	memcpy( p, &value, 4 );
+}
+
+static int Demo_GetLong( const byte *p ) {
+	int value;
+
+	memcpy( &value, p, 4 );
+	return LittleLong( value );
+}
+
+// Writing
+
+static void Demo_Write( demoWriter_t *dw, const void *data, int length ) {
+	FS_Write( data, length, dw->file );
+	dw->offset += length;
+}
+
+static void Demo_WriteBlockHeader( demoWriter_t *dw, int kind, int keyframeTime, int rawLength, int compressedLength ) {
+	byte header[sizeof( demoBlockHeader_t )];
+
+	Demo_PutLong( header + 0, kind );
+	Demo_PutLong( header + 4, keyframeTime );
+	Demo_PutLong( header + 8, rawLength );
+	Demo_PutLong( header + 12, compressedLength );
+	Demo_Write( dw, header, sizeof( header ) );
+}
+
+static void Demo_FlushBlock( demoWriter_t *dw ) {
+	uLongf compressedLength;
+
+	if ( !dw->rawLength ) {
+		return;
+	}
+
+	// blocks that don't shrink are stored as they are
+	compressedLength = dw->compressedSize;
+	if ( compress2( dw->compressed, &compressedLength, dw->raw, dw->rawLength, Z_BEST_SPEED ) == Z_OK
+		&& compressedLength < (uLongf)dw->rawLength ) {
+		Demo_WriteBlockHeader( dw, DEMO_BLOCK_DATA, dw->keyframeTime, dw->rawLength, (int)compressedLength );
+		Demo_Write( dw, dw->compressed, (int)compressedLength );
+	} else {
+		Demo_WriteBlockHeader( dw, DEMO_BLOCK_DATA, dw->keyframeTime, dw->rawLength, dw->rawLength );
+		Demo_Write( dw, dw->raw, dw->rawLength );
+	}
+
+	dw->rawLength = 0;
+	dw->keyframeTime = -1;
+}
+
+static void Demo_AddRecord( demoWriter_t *dw, int type, int sequence, const byte *data, int length ) {
+	if ( length < 0 || length > MAX_MSGLEN ) {
+		Com_Error( ERR_DROP, "Demo_AddRecord: bad length %i", length );
+	}
+
+	if ( dw->rawLength + DEMO_RECORD_HEADER + length > DEMO_BLOCK_MAX ) {
+		Demo_FlushBlock( dw );
+	}
+
+	Demo_PutLong( dw->raw + dw->rawLength + 0, type );
+	Demo_PutLong( dw->raw + dw->rawLength + 4, sequence );
+	Demo_PutLong( dw->raw + dw->rawLength + 8, length );
+	memcpy( dw->raw + dw->rawLength + DEMO_RECORD_HEADER, data, length );
+	dw->rawLength += DEMO_RECORD_HEADER + length;
+
+	if ( dw->rawLength >= DEMO_BLOCK_SIZE ) {
+		Demo_FlushBlock( dw );
+	}
+}
+
+demoWriter_t *Demo_BeginWrite( fileHandle_t f ) {
+	demoWriter_t	*dw;
+	byte			header[DEMO_HEADER_SIZE];
+
+	dw = (demoWriter_t *)Z_Malloc( sizeof( *dw ), TAG_DEFLATE, true );
+	dw->file = f;
+	dw->keyframeTime = -1;
+	dw->compressedSize = compressBound( DEMO_BLOCK_MAX );
+	dw->compressed = (byte *)Z_Malloc( dw->compressedSize, TAG_DEFLATE );
+
+	Demo_PutLong( header + 0, DEMO_IDENT );
+	Demo_PutLong( header + 4, DEMO_VERSION );
+	Demo_Write( dw, header, sizeof( header ) );
+
+	return dw;
+}
+
+// Starts a new block with a gamestate. The caller makes sure the next message it writes is a non-delta snapshot.
+void Demo_WriteGamestate( demoWriter_t *dw, int serverTime, int sequence, const byte *data, int length ) {
+	Demo_FlushBlock( dw );
+
+	if ( dw->numKeyframes < DEMO_MAX_KEYFRAMES ) {
+		Demo_AddKeyframe( &dw->keyframes, &dw->numKeyframes, &dw->maxKeyframes, serverTime, dw->offset );
+	}
+	dw->keyframeTime = serverTime;
+	Demo_AddRecord( dw, DEMO_RECORD_GAMESTATE, sequence, data, length );
+}
+
+void Demo_WriteMessage( demoWriter_t *dw, int sequence, const byte *data, int length ) {
+	Demo_AddRecord( dw, DEMO_RECORD_MESSAGE, sequence, data, length );
+}
+
+// Writes out the last block and the seek index, then frees the writer
+void Demo_EndWrite( demoWriter_t *dw ) {
+	byte	entry[sizeof( demoKeyframe_t )];
+	byte	trailer[DEMO_TRAILER_SIZE];
+	int		i, indexOffset;
+
+	Demo_FlushBlock( dw );
+
+	indexOffset = dw->offset;
+	Demo_WriteBlockHeader( dw, DEMO_BLOCK_INDEX, -1, dw->numKeyframes * (int)sizeof( entry ), dw->numKeyframes * (int)sizeof( entry ) );
+	for ( i = 0 ; i < dw->numKeyframes ; i++ ) {
+		Demo_PutLong( entry + 0, dw->keyframes[i].serverTime );
+		Demo_PutLong( entry + 4, dw->keyframes[i].offset );
+		Demo_Write( dw, entry, sizeof( entry ) );
+	}
+
+	Demo_PutLong( trailer + 0, indexOffset );
+	Demo_PutLong( trailer + 4, DEMO_INDEX_IDENT );
+	Demo_Write( dw, trailer, sizeof( trailer ) );
+
+	if ( dw->keyframes ) {
+		Z_Free( dw->keyframes );
+	}
+	Z_Free( dw->compressed );
+	Z_Free( dw );
+}
+
+// Reading
+
+static bool Demo_ReadBlockHeader( demoReader_t *dr, int offset, demoBlockHeader_t *header ) {
+	byte data[sizeof( demoBlockHeader_t )];
+
+	if ( offset < DEMO_HEADER_SIZE || offset + (int)sizeof( data ) > dr->fileLength ) {
+		return false;
+	}
+	FS_Seek( dr->file, offset, FS_SEEK_SET );
+	if ( FS_Read( data, sizeof( data ), dr->file ) != (int)sizeof( data ) ) {
+		return false;
+	}
+
+	header->kind = Demo_GetLong( data + 0 );
+	header->keyframeTime = Demo_GetLong( data + 4 );
+	header->rawLength = Demo_GetLong( data + 8 );
+	header->compressedLength = Demo_GetLong( data + 12 );
+
+	if ( header->kind == DEMO_BLOCK_INDEX ) {
+		return header->rawLength >= 0 && header->rawLength / (int)sizeof( demoKeyframe_t ) <= DEMO_MAX_KEYFRAMES;
+	}
+	return header->kind == DEMO_BLOCK_DATA
+		&& header->rawLength > 0 && header->rawLength <= DEMO_BLOCK_MAX
+		&& header->compressedLength > 0 && (uLong)header->compressedLength <= dr->compressedSize;
+}
+
+// Uses the index at the end of the file, or rebuilds it from the block headers if the recording was cut short
+static void Demo_LoadIndex( demoReader_t *dr ) {
+	demoBlockHeader_t	header;
+	byte				data[DEMO_TRAILER_SIZE];
+	int					i, count, offset;
+
+	if ( dr->fileLength >= DEMO_HEADER_SIZE + DEMO_TRAILER_SIZE ) {
+		FS_Seek( dr->file, dr->fileLength - DEMO_TRAILER_SIZE, FS_SEEK_SET );
+		if ( FS_Read( data, sizeof( data ), dr->file ) == (int)sizeof( data ) && Demo_GetLong( data + 4 ) == DEMO_INDEX_IDENT ) {
+			offset = Demo_GetLong( data + 0 );
+			if ( Demo_ReadBlockHeader( dr, offset, &header ) && header.kind == DEMO_BLOCK_INDEX ) {
+				count = header.rawLength / (int)sizeof( demoKeyframe_t );
+				for ( i = 0 ; i < count ; i++ ) {
+					byte entry[sizeof( demoKeyframe_t )];
+					if ( FS_Read( entry, sizeof( entry ), dr->file ) != (int)sizeof( entry ) ) {
+						break;
+					}
+					Demo_AddKeyframe( &dr->keyframes, &dr->numKeyframes, &dr->maxKeyframes, Demo_GetLong( entry + 0 ), Demo_GetLong( entry + 4 ) );
+				}
+				if ( i == count ) {
+					return;
+				}
+				dr->numKeyframes = 0;
+			}
+		}
+	}
+
+	for ( offset = DEMO_HEADER_SIZE ; Demo_ReadBlockHeader( dr, offset, &header ) && header.kind == DEMO_BLOCK_DATA ; ) {
+		if ( header.keyframeTime != -1 && dr->numKeyframes < DEMO_MAX_KEYFRAMES ) {
+			Demo_AddKeyframe( &dr->keyframes, &dr->numKeyframes, &dr->maxKeyframes, header.keyframeTime, offset );
+		}
+		offset += sizeof( demoBlockHeader_t ) + header.compressedLength;
+	}
+}
+
+// Returns nullptr if the file isn't an indexed demo
+demoReader_t *Demo_BeginRead( fileHandle_t f, int fileLength ) {
+	demoReader_t	*dr;
+	byte			header[DEMO_HEADER_SIZE];
+
+	if ( fileLength < DEMO_HEADER_SIZE ) {
+		return nullptr;
+	}
+	FS_Seek( f, 0, FS_SEEK_SET );
+	if ( FS_Read( header, sizeof( header ), f ) != (int)sizeof( header ) ) {
+		return nullptr;
+	}
+	if ( Demo_GetLong( header + 0 ) != DEMO_IDENT ) {
+		return nullptr;
+	}
+	if ( Demo_GetLong( header + 4 ) != DEMO_VERSION ) {
+		Com_Printf( "Demo_BeginRead: unsupported version %i\n", Demo_GetLong( header + 4 ) );
+		return nullptr;
+	}
+
+	dr = (demoReader_t *)Z_Malloc( sizeof( *dr ), TAG_INFLATE, true );
+	dr->file = f;
+	dr->fileLength = fileLength;
+	dr->offset = DEMO_HEADER_SIZE;
+	dr->wantGamestate = true;
+	dr->compressedSize = compressBound( DEMO_BLOCK_MAX );
+	dr->compressed = (byte *)Z_Malloc( dr->compressedSize, TAG_INFLATE );
+
+	Demo_LoadIndex( dr );
+
+	return dr;
+}
+
+void Demo_EndRead( demoReader_t *dr ) {
+	if ( dr->keyframes ) {
+		Z_Free( dr->keyframes );
+	}
+	Z_Free( dr->compressed );
+	Z_Free( dr );
+}
+
+// Returns false at the end of the demo or if the rest of it is unreadable
+static bool Demo_ReadBlock( demoReader_t *dr ) {
+	demoBlockHeader_t	header;
+	uLongf				rawLength;
+
+	if ( !Demo_ReadBlockHeader( dr, dr->offset, &header ) || header.kind != DEMO_BLOCK_DATA ) {
+		return false;
+	}
+
+	if ( header.compressedLength == header.rawLength ) {
+		if ( FS_Read( dr->raw, header.rawLength, dr->file ) != header.rawLength ) {
+			return false;
+		}
+	} else {
+		if ( FS_Read( dr->compressed, header.compressedLength, dr->file ) != header.compressedLength ) {
+			return false;
+		}
+		rawLength = header.rawLength;
+		if ( uncompress( dr->raw, &rawLength, dr->compressed, header.compressedLength ) != Z_OK || rawLength != (uLongf)header.rawLength ) {
+			Com_Printf( "Demo_ReadBlock: corrupt block at %i\n", dr->offset );
+			return false;
+		}
+	}
+
+	dr->offset += sizeof( header ) + header.compressedLength;
+	dr->rawLength = header.rawLength;
+	dr->rawPos = 0;
+	return true;
+}
+
+// Fills in the next message to play. Keyframe gamestates are only returned when playback starts on them.
+bool Demo_ReadMessage( demoReader_t *dr, int *sequence, msg_t *msg ) {
+	int type, length;
+
+	for ( ;; ) {
+		if ( dr->rawPos >= dr->rawLength && !Demo_ReadBlock( dr ) ) {
+			return false;
+		}
+
+		if ( dr->rawPos + DEMO_RECORD_HEADER > dr->rawLength ) {
+			Com_Error( ERR_DROP, "Demo_ReadMessage: truncated record" );
+		}
+		type = Demo_GetLong( dr->raw + dr->rawPos + 0 );
+		*sequence = Demo_GetLong( dr->raw + dr->rawPos + 4 );
+		length = Demo_GetLong( dr->raw + dr->rawPos + 8 );
+		dr->rawPos += DEMO_RECORD_HEADER;
+
+		if ( length < 0 || length > msg->maxsize || dr->rawPos + length > dr->rawLength ) {
+			Com_Error( ERR_DROP, "Demo_ReadMessage: bad message length %i", length );
+		}
+
+		if ( type == DEMO_RECORD_GAMESTATE && !dr->wantGamestate ) {
+			dr->rawPos += length;
+			continue;
+		}
+		if ( type == DEMO_RECORD_GAMESTATE ) {
+			dr->wantGamestate = false;
+		} else if ( type != DEMO_RECORD_MESSAGE ) {
+			Com_Error( ERR_DROP, "Demo_ReadMessage: bad record type %i", type );
+		}
+
+		memcpy( msg->data, dr->raw + dr->rawPos, length );
+		msg->cursize = length;
+		dr->rawPos += length;
+		return true;
+	}
+}
+
+// Moves playback to the last keyframe at or before msec into the demo. Returns the keyframe's time into the demo,
+// or -1 if the demo has no keyframes.
+int Demo_SeekKeyframe( demoReader_t *dr, int msec ) {
+	int i, target;
+
+	if ( !dr->numKeyframes ) {
+		return -1;
+	}
+
+	target = dr->keyframes[0].serverTime + msec;
+	for ( i = 1 ; i < dr->numKeyframes && dr->keyframes[i].serverTime <= target ; i++ ) {
+	}
+	i--;
+
+	dr->offset = dr->keyframes[i].offset;
+	dr->rawLength = 0;
+	dr->rawPos = 0;
+	dr->wantGamestate = true;
+
+	return dr->keyframes[i].serverTime - dr->keyframes[0].serverTime;
+}
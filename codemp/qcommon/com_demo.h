@@ -0,0 +1,46 @@
+/*
+===========================================================================
+Copyright (C) 2019 - 2020, CleanJoKe contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#pragma once
+
+// Indexed demos (.dmz_<protocol>)
+// The same messages as a .dm_ demo, packed into zlib compressed blocks. Every so often a block starts with a
+// keyframe: a gamestate for that moment, followed in the stream by a non-delta snapshot, so playback can start
+// there as if the demo had been recorded from that point on. A seek index of the keyframes closes the file,
+// and if it is missing (the server went down mid-recording) the block headers are walked instead.
+
+#include "qcommon/q_common.h"
+
+#define DEMO_INDEXED_EXT		"dmz"
+
+struct demoWriter_t;
+struct demoReader_t;
+
+// writing, the file itself is opened and closed by the caller
+demoWriter_t   *Demo_BeginWrite               ( fileHandle_t f );
+void            Demo_EndWrite                 ( demoWriter_t *dw );
+void            Demo_WriteGamestate           ( demoWriter_t *dw, int serverTime, int sequence, const byte *data, int length );
+void            Demo_WriteMessage             ( demoWriter_t *dw, int sequence, const byte *data, int length );
+
+// reading
+demoReader_t   *Demo_BeginRead                ( fileHandle_t f, int fileLength );
+void            Demo_EndRead                  ( demoReader_t *dr );
+bool            Demo_ReadMessage              ( demoReader_t *dr, int *sequence, msg_t *msg );
+int             Demo_SeekKeyframe             ( demoReader_t *dr, int msec );
@@ -0,0 +1,186 @@
+/*
+===========================================================================
+Copyright (C) 2019 - 2020, CleanJoKe contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// com_jobs.cpp -- small worker pool for fanning independent work out across cores
+
+#include "qcommon/q_common.h"
+#include "qcommon/com_cvars.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define MAX_JOB_THREADS 16
+
+struct jobBatch_t {
+	jobFunc_t        func;
+	void            *data;
+	int              count;
+	std::atomic<int> next;
+	std::atomic<int> done;
+	int              errorCode; // first Com_Error code thrown by a job, rethrown on the calling thread
+};
+
+static std::thread             *jobThreads[MAX_JOB_THREADS];
+static int                      numJobThreads;
+static int                      jobThreadsModCount = -1;
+static std::thread::id          jobMainThread;
+static std::mutex               jobMutex;
+static std::condition_variable  jobWake;
+static std::condition_variable  jobFinished;
+static jobBatch_t              *jobCurrent;
+static int                      jobGeneration;
+static int                      jobBusy; // workers currently holding jobCurrent
+static bool                     jobQuit;
+
+static void Com_RunJobBatch( jobBatch_t *batch ) {
+	int index;
+
+	while ( (index = batch->next.fetch_add( 1 )) < batch->count ) {
+		try {
+			batch->func( index, batch->data );
+		}
+		catch ( int code ) {
+			std::lock_guard<std::mutex> lock( jobMutex );
+			if ( !batch->errorCode ) {
+				batch->errorCode = code;
+			}
+		}
+		batch->done.fetch_add( 1 );
+	}
+}
+
+static void Com_JobThread( void ) {
+	int generation = 0;
+
+	for ( ;; ) {
+		jobBatch_t *batch;
+
+		{
+			std::unique_lock<std::mutex> lock( jobMutex );
+			jobWake.wait( lock, [&] { return jobQuit || (jobCurrent && jobGeneration != generation); } );
+			if ( jobQuit ) {
+				return;
+			}
+			generation = jobGeneration;
+			batch = jobCurrent;
+			jobBusy++;
+		}
+
+		Com_RunJobBatch( batch );
+
+		{
+			std::lock_guard<std::mutex> lock( jobMutex );
+			jobBusy--;
+		}
+		jobFinished.notify_all();
+	}
+}
+
+void Com_ShutdownJobs( void ) {
+	int i;
+
+	// a fatal error raised from inside a job must not try to join its own thread
+	if ( !numJobThreads || std::this_thread::get_id() != jobMainThread ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( jobMutex );
+		jobQuit = true;
+	}
+	jobWake.notify_all();
+
+	for ( i = 0; i < numJobThreads; i++ ) {
+		jobThreads[i]->join();
+		delete jobThreads[i];
+		jobThreads[i] = nullptr;
+	}
+	numJobThreads = 0;
+	jobQuit = false;
+}
+
+// Applies any change to com_jobThreads and returns the number of worker threads available.
+// Must only be called from the main thread.
+int Com_JobThreads( void ) {
+	int i, count;
+
+	if ( !com_jobThreads || com_jobThreads->modificationCount == jobThreadsModCount ) {
+		return numJobThreads;
+	}
+	jobThreadsModCount = com_jobThreads->modificationCount;
+
+	Com_ShutdownJobs();
+
+	count = Com_Clampi( 0, MAX_JOB_THREADS, com_jobThreads->integer );
+	jobMainThread = std::this_thread::get_id();
+	for ( i = 0; i < count; i++ ) {
+		jobThreads[i] = new std::thread( Com_JobThread );
+	}
+	numJobThreads = count;
+
+	if ( count ) {
+		Com_Printf( "Started %i job threads\n", count );
+	}
+
+	return numJobThreads;
+}
+
+// Runs func( i, data ) for every i in [0, count) and returns once all of them have finished.
+// The calling thread takes part in the work. Jobs must not touch state shared with other jobs
+// without synchronisation. A Com_Error raised by a job is rethrown here on the calling thread.
+void Com_ParallelFor( int count, jobFunc_t func, void *data ) {
+	jobBatch_t batch;
+	int i;
+
+	if ( count <= 1 || !Com_JobThreads() ) {
+		for ( i = 0; i < count; i++ ) {
+			func( i, data );
+		}
+		return;
+	}
+
+	batch.func = func;
+	batch.data = data;
+	batch.count = count;
+	batch.next = 0;
+	batch.done = 0;
+	batch.errorCode = 0;
+
+	{
+		std::lock_guard<std::mutex> lock( jobMutex );
+		jobCurrent = &batch;
+		jobGeneration++;
+	}
+	jobWake.notify_all();
+
+	Com_RunJobBatch( &batch );
+
+	{
+		std::unique_lock<std::mutex> lock( jobMutex );
+		jobFinished.wait( lock, [&] { return batch.done.load() == count && !jobBusy; } );
+		jobCurrent = nullptr;
+	}
+
+	if ( batch.errorCode ) {
+		throw batch.errorCode;
+	}
+}
@@ -29,7 +29,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/q_common.h"
 #include "qcommon/huffman.h"
 
-static int			bloc = 0;
+static thread_local int	bloc = 0; // per thread so snapshots can be encoded on job threads
 
 void	Huff_putBit( int bit, byte *fout, int *offset) {
 	bloc = *offset;
@@ -50,6 +50,53 @@ int		Huff_getBit( byte *fin, int *offset) {
 	return t;
 }
 
+/* Write the low bits of value a byte at a time, leaving the buffer exactly as
+ * the same number of Huff_putBit calls would */
+void	Huff_putBits( int value, int bits, byte *fout, int *offset ) {
+	int b = *offset;
+	unsigned int v = (unsigned int)value;
+
+	while ( bits > 0 ) {
+		int shift = b&7;
+		int n = 8 - shift;
+		byte out;
+
+		if ( n > bits ) {
+			n = bits;
+		}
+		out = (byte)((v & ((1u<<n)-1)) << shift);
+		if ( shift == 0 ) {
+			fout[b>>3] = out;
+		} else {
+			fout[b>>3] |= out;
+		}
+		v >>= n;
+		bits -= n;
+		b += n;
+	}
+	*offset = b;
+}
+
+int		Huff_getBits( byte *fin, int *offset, int bits ) {
+	int b = *offset;
+	int value = 0;
+	int got = 0;
+
+	while ( got < bits ) {
+		int shift = b&7;
+		int n = 8 - shift;
+
+		if ( n > bits - got ) {
+			n = bits - got;
+		}
+		value |= ((fin[b>>3] >> shift) & ((1<<n)-1)) << got;
+		got += n;
+		b += n;
+	}
+	*offset = b;
+	return value;
+}
+
 /* Add a bit to the output file (buffered) */
 static void add_bit (char bit, byte *fout) {
 	if ((bloc&7) == 0) {
@@ -323,6 +370,113 @@ void Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset) {
 	*offset = bloc;
 }
 
+static void Huff_fillLookup(huffTable_t *table, node_t *node, int depth, int bits) {
+	int i;
+
+	if ( node && node->symbol == INTERNAL_NODE && depth < HUFF_LOOKUP_BITS ) {
+		Huff_fillLookup(table, node->left, depth + 1, bits);
+		Huff_fillLookup(table, node->right, depth + 1, bits | (1<<depth));
+		return;
+	}
+
+	/* every index that starts with these bits resolves here */
+	for ( i = bits; i < (1<<HUFF_LOOKUP_BITS); i += (1<<depth) ) {
+		huffLookup_t *entry = &table->lookup[i];
+		if ( !node ) {
+			entry->node = nullptr;
+			entry->symbol = 0;
+			entry->length = 0;
+		} else if ( node->symbol == INTERNAL_NODE ) {
+			entry->node = node;
+			entry->symbol = 0;
+			entry->length = depth;
+		} else {
+			entry->node = nullptr;
+			entry->symbol = node->symbol;
+			entry->length = depth;
+		}
+	}
+}
+
+/* Flatten trees that have stopped adapting into an encode table and a decode
+ * lookup. The tables produce the same bits as Huff_offsetTransmit and
+ * Huff_offsetReceive, so they must be rebuilt if either tree changes */
+void Huff_BuildTable(huffTable_t *table, huff_t *compressor, huff_t *decompressor) {
+	int i, length;
+	unsigned int code;
+	node_t *node;
+
+	Com_Memset(table, 0, sizeof(*table));
+	table->compressor = compressor;
+
+	for ( i = 0; i <= HMAX; i++ ) {
+		code = 0;
+		length = 0;
+		for ( node = compressor->loc[i]; node && node->parent; node = node->parent ) {
+			/* walking up gives the last bit first */
+			if ( length == HUFF_MAX_CODE ) {
+				length = 0;
+				break;
+			}
+			code = (code<<1) | (node->parent->right == node ? 1 : 0);
+			length++;
+		}
+		table->code[i] = code;
+		table->length[i] = length;
+	}
+
+	Huff_fillLookup(table, decompressor->tree, 0, 0);
+}
+
+void Huff_tableTransmit(const huffTable_t *table, int ch, byte *fout, int *offset) {
+	if ( !table->length[ch] ) {
+		Huff_offsetTransmit(table->compressor, ch, fout, offset);
+		return;
+	}
+	Huff_putBits(table->code[ch], table->length[ch], fout, offset);
+}
+
+/* Bytes at or past size read as zero, they can only fill lookup bits beyond the end of the code */
+void Huff_tableReceive(const huffTable_t *table, int *ch, byte *fin, int *offset, int size) {
+	const huffLookup_t *entry;
+	node_t *node;
+	unsigned int peek;
+	int i, b;
+
+	b = *offset;
+	peek = 0;
+	for ( i = 0; i < 3; i++ ) {
+		if ( (b>>3) + i < size ) {
+			peek |= fin[(b>>3) + i] << (i*8);
+		}
+	}
+	entry = &table->lookup[(peek >> (b&7)) & ((1<<HUFF_LOOKUP_BITS)-1)];
+
+	if ( !entry->node ) {
+		*ch = entry->symbol;
+		*offset = b + entry->length;
+		return;
+	}
+
+	/* longer than the lookup, finish on the tree */
+	node = entry->node;
+	b += entry->length;
+	while (node && node->symbol == INTERNAL_NODE) {
+		if ((fin[(b>>3)] >> (b&7)) & 0x1) {
+			node = node->right;
+		} else {
+			node = node->left;
+		}
+		b++;
+	}
+	if (!node) {
+		*ch = 0;
+		return;
+	}
+	*ch = node->symbol;
+	*offset = b;
+}
+
 void Huff_Decompress(msg_t *mbuf, int offset) {
 	int			ch, cch, i, j, size;
 	byte		seq[65536];
@@ -375,7 +529,7 @@ void Huff_Decompress(msg_t *mbuf, int offset) {
 	Com_Memcpy(mbuf->data + offset, seq, cch);
 }
 
-extern 	int oldsize;
+extern thread_local int oldsize;
 
 void Huff_Compress(msg_t *mbuf, int offset) {
 	int			i, ch, size;
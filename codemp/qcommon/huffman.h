@@ -35,6 +35,9 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #define INTERNAL_NODE (HMAX+1)
 #define HMAX 256 /* Maximum symbol */
 
+#define HUFF_LOOKUP_BITS 11			/* bits resolved by one decode table lookup */
+#define HUFF_MAX_CODE 32			/* longer codes are sent by walking the tree */
+
 // ======================================================================
 // STRUCT
 // ======================================================================
@@ -66,6 +69,20 @@ typedef struct huffman_s {
 	huff_t		decompressor;
 } huffman_t;
 
+/* Flattened form of a tree that no longer adapts, built by Huff_BuildTable */
+typedef struct huffLookup_s {
+	node_t*		node;		/* subtree to continue from when the code is longer than the lookup */
+	short		symbol;
+	byte		length;		/* bits consumed by the lookup */
+} huffLookup_t;
+
+typedef struct huffTable_s {
+	huff_t*			compressor;
+	unsigned int	code[HMAX+1];		/* prefix code, first bit sent in bit 0 */
+	byte			length[HMAX+1];		/* 0 if the code doesn't fit in HUFF_MAX_CODE bits */
+	huffLookup_t	lookup[1<<HUFF_LOOKUP_BITS];
+} huffTable_t;
+
 // ======================================================================
 // EXTERN VARIABLE
 // ======================================================================
@@ -77,11 +94,16 @@ extern huffman_t clientHuffTables;
 // ======================================================================
 
 int	Huff_getBit(byte* fout, int* offset);
+int	Huff_getBits(byte* fin, int* offset, int bits);
 void Huff_addRef(huff_t* huff, byte ch);
+void Huff_BuildTable(huffTable_t* table, huff_t* compressor, huff_t* decompressor);
 void Huff_Compress(msg_t* buf, int offset);
 void Huff_Decompress(msg_t* buf, int offset);
 void Huff_Init(huffman_t* huff);
 void Huff_offsetReceive(node_t* node, int* ch, byte* fin, int* offset);
 void Huff_offsetTransmit(huff_t* huff, int ch, byte* fout, int* offset);
 void Huff_putBit(int bit, byte* fout, int* offset);
+void Huff_putBits(int value, int bits, byte* fout, int* offset);
+void Huff_tableReceive(const huffTable_t* table, int* ch, byte* fin, int* offset, int size);
+void Huff_tableTransmit(const huffTable_t* table, int ch, byte* fout, int* offset);
 void MSG_shutdownHuffman();
\ No newline at end of file
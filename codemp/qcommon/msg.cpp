@@ -29,10 +29,20 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "server/server.h"
 #include "qcommon/com_cvars.h"
 
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MSG_DELTA_SSE2	1
+	#include <emmintrin.h>
+#else
+	#define MSG_DELTA_SSE2	0
+#endif
+
 //#define _NEWHUFFTABLE_		// Build "c:\\netchan.bin"
 //#define _USINGNEWHUFFTABLE_		// Build a new frequency table to cut and paste.
 
 static huffman_t		msgHuff;
+static huffTable_t		msgHuffTable;	// msgHuff never changes after MSG_initHuffman
 
 static bool			msgInit = false;
 #ifdef _NEWHUFFTABLE_
@@ -42,11 +52,12 @@ static FILE				*fp=0;
 // MESSAGE IO FUNCTIONS
 // Handles byte ordering and avoids alignment errors
 
+// both are per thread, snapshots for different clients are encoded on the job threads at the same time
 #ifndef FINAL_BUILD
-	int gLastBitIndex = 0;
+	thread_local int gLastBitIndex = 0;
 #endif
 
-int oldsize = 0;
+thread_local int oldsize = 0;
 
 /*
 // New data gathered to tune Q3 to JK2MP. Takes longer to crunch and gain was minimal.
@@ -588,6 +599,7 @@ void MSG_initHuffman() {
 			Huff_addRef(&msgHuff.decompressor,	(byte)i);			// Do update
 		}
 	}
+	Huff_BuildTable(&msgHuffTable, &msgHuff.compressor, &msgHuff.decompressor);
 }
 
 #else
@@ -622,6 +634,7 @@ void MSG_initHuffman() {
 		Com_Printf("%d,			// %d\n", array[i], i);
 	}
 	Com_Printf("};\n");
+	Huff_BuildTable(&msgHuffTable, &msgHuff.compressor, &msgHuff.decompressor);
 	FS_FreeFile( data );
 	Cbuf_AddText( "condump dump.txt\n" );
 }
@@ -738,10 +751,8 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 		if (bits&7) {
 			int nbits;
 			nbits = bits&7;
-			for(i=0;i<nbits;i++) {
-				Huff_putBit((value&1), msg->data, &msg->bit);
-				value = (value>>1);
-			}
+			Huff_putBits(value, nbits, msg->data, &msg->bit);
+			value = (value>>nbits);
 			bits = bits - nbits;
 		}
 		if (bits) {
@@ -749,7 +760,7 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 #ifdef _NEWHUFFTABLE_
 				fwrite(&value, 1, 1, fp);
 #endif // _NEWHUFFTABLE_
-				Huff_offsetTransmit (&msgHuff.compressor, (value&0xff), msg->data, &msg->bit);
+				Huff_tableTransmit (&msgHuffTable, (value&0xff), msg->data, &msg->bit);
 				value = (value>>8);
 			}
 		}
@@ -794,14 +805,12 @@ int MSG_ReadBits( msg_t *msg, int bits ) {
 		nbits = 0;
 		if (bits&7) {
 			nbits = bits&7;
-			for(i=0;i<nbits;i++) {
-				value |= (Huff_getBit(msg->data, &msg->bit)<<i);
-			}
+			value = Huff_getBits(msg->data, &msg->bit, nbits);
 			bits = bits - nbits;
 		}
 		if (bits) {
 			for(i=0;i<bits;i+=8) {
-				Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data, &msg->bit);
+				Huff_tableReceive (&msgHuffTable, &get, msg->data, &msg->bit, msg->maxsize);
 #ifdef _NEWHUFFTABLE_
 				fwrite(&get, 1, 1, fp);
 #endif // _NEWHUFFTABLE_
@@ -848,6 +857,22 @@ void MSG_WriteData( msg_t *buf, const void *data, int length ) {
 	}
 }
 
+// Appends bits that MSG_WriteBits already encoded into another message. The Huffman codes don't
+// depend on where they start, so this is the same as writing the values again. No overflow check,
+// the caller makes sure the bits fit.
+void MSG_WriteEncodedBits( msg_t *msg, const byte *data, int bits ) {
+	int i;
+
+	if ( !bits ) {
+		return;
+	}
+
+	for ( i = 0 ; i < bits ; i += 8 ) {
+		Huff_putBits( data[i>>3], bits - i < 8 ? bits - i : 8, msg->data, &msg->bit );
+	}
+	msg->cursize = (msg->bit>>3)+1;
+}
+
 void MSG_WriteShort( msg_t *sb, int c ) {
 #ifdef PARANOID
 	if (c < ((signed short)0x8000) || c > 0x7fff) {
@@ -1274,10 +1299,126 @@ struct netField_t {
 	size_t	offset;
 	int		bits;		// 0 = float
 #ifndef FINAL_BUILD
-	unsigned	mCount;
+	std::atomic<unsigned>	mCount;		// counted from every thread encoding snapshots
 #endif
 };
 
+// Change vectors
+// The states are compared as whole runs of 32 bit words into a bitmask, one bit per word.
+// The field tables are in send order rather than struct order, so each word maps back to its field.
+// A few playerState_t fields are bools sent as ints from unaligned offsets, those are compared directly.
+
+#define MAX_DELTA_WORDS		( sizeof( playerState_t ) / 4 )
+#define DELTA_MASK_WORDS	( ( MAX_DELTA_WORDS + 31 ) / 32 )
+
+static_assert( sizeof( entityState_t ) <= sizeof( playerState_t ), "delta masks are sized for playerState_t" );
+
+struct netFieldMap_t {
+	int		numWords;
+	int		fieldForWord[MAX_DELTA_WORDS];	// index + 1 into the field table, 0 if the word isn't a field
+	int		numUnaligned;
+	int		unaligned[MAX_DELTA_WORDS];		// fields that straddle two words
+};
+
+static netFieldMap_t MSG_BuildFieldMap( const netField_t *fields, int numFields, size_t structSize ) {
+	netFieldMap_t	map = {};
+	int				i;
+
+	map.numWords = (int)( structSize / 4 );
+	for ( i = 0 ; i < numFields ; i++ ) {
+		if ( fields[i].offset & 3 ) {
+			map.unaligned[map.numUnaligned++] = i;
+		} else {
+			map.fieldForWord[fields[i].offset / 4] = i + 1;
+		}
+	}
+
+	return map;
+}
+
+static void MSG_ChangedWords( const void *from, const void *to, int numWords, uint32_t *mask ) {
+	const int	*f = (const int *)from;
+	const int	*t = (const int *)to;
+	int			i = 0;
+
+	Com_Memset( mask, 0, ( ( numWords + 31 ) / 32 ) * sizeof( *mask ) );
+
+#if MSG_DELTA_SSE2
+	for ( ; i + 4 <= numWords ; i += 4 ) {
+		__m128i eq = _mm_cmpeq_epi32( _mm_loadu_si128( (const __m128i *)( f + i ) ), _mm_loadu_si128( (const __m128i *)( t + i ) ) );
+		uint32_t diff = (uint32_t)_mm_movemask_ps( _mm_castsi128_ps( eq ) ) ^ 0xF;
+		mask[i >> 5] |= diff << ( i & 31 );
+	}
+#endif
+
+	for ( ; i < numWords ; i++ ) {
+		if ( f[i] != t[i] ) {
+			mask[i >> 5] |= 1u << ( i & 31 );
+		}
+	}
+}
+
+static inline int MSG_WordChanged( const uint32_t *mask, size_t offset ) {
+	return ( mask[offset >> 7] >> ( ( offset >> 2 ) & 31 ) ) & 1;
+}
+
+static inline bool MSG_FieldChanged( const uint32_t *mask, const netField_t *field, const void *from, const void *to ) {
+	if ( field->offset & 3 ) {
+		return *(const int *)( (const byte *)from + field->offset ) != *(const int *)( (const byte *)to + field->offset );
+	}
+	return MSG_WordChanged( mask, field->offset ) != 0;
+}
+
+// Number of fields up to and including the last one that changed
+static int MSG_LastChangedField( const netFieldMap_t *map, const uint32_t *mask, netField_t *fields, const void *from, const void *to ) {
+	int			i, w, b, field, lc;
+	uint32_t	bits;
+
+	lc = 0;
+	for ( i = 0 ; i < map->numUnaligned ; i++ ) {
+		field = map->unaligned[i];
+		if ( MSG_FieldChanged( mask, &fields[field], from, to ) ) {
+			if ( field + 1 > lc ) {
+				lc = field + 1;
+			}
+#ifndef FINAL_BUILD
+			fields[field].mCount.fetch_add( 1, std::memory_order_relaxed );
+#endif
+		}
+	}
+	for ( w = 0 ; w < ( map->numWords + 31 ) / 32 ; w++ ) {
+		for ( b = 0, bits = mask[w] ; bits ; b++, bits >>= 1 ) {
+			if ( !( bits & 1 ) ) {
+				continue;
+			}
+			field = map->fieldForWord[w * 32 + b];
+			if ( !field ) {
+				continue;
+			}
+			if ( field > lc ) {
+				lc = field;
+			}
+#ifndef FINAL_BUILD
+			fields[field - 1].mCount.fetch_add( 1, std::memory_order_relaxed );
+#endif
+		}
+	}
+
+	return lc;
+}
+
+// Changed flags for an array that isn't in a field table, one bit per element
+static int MSG_ChangedArrayBits( const uint32_t *mask, size_t offset, int count ) {
+	int i, bits;
+
+	bits = 0;
+	for ( i = 0 ; i < count ; i++ ) {
+		bits |= MSG_WordChanged( mask, offset + i * 4 ) << i;
+	}
+
+	return bits;
+}
+
 // using the stringizing operator to save typing...
 #define	NETF(x) #x,offsetof(entityState_t, x)
 
@@ -1468,6 +1609,8 @@ netField_t	entityStateFields[] =
 { NETF(userVec2[2]), 1 },
 };
 
+static const netFieldMap_t entityStateMap = MSG_BuildFieldMap( entityStateFields, (int)ARRAY_LEN( entityStateFields ), sizeof( entityState_t ) );
+
 // if (int)f == f and (int)f + ( 1<<(FLOAT_INT_BITS-1) ) < ( 1 << FLOAT_INT_BITS )
 // the float will be sent with FLOAT_INT_BITS, otherwise all 32 bits will be sent
 #define	FLOAT_INT_BITS	13
@@ -1484,7 +1627,8 @@ void MSG_WriteDeltaEntity( msg_t *msg, entityState_t *from, entityState_t *to,
 	netField_t	*field;
 	int			trunc;
 	float		fullFloat;
-	int			*fromF, *toF;
+	int			*toF;
+	uint32_t	changed[DELTA_MASK_WORDS];
 
 	numFields = (int)ARRAY_LEN( entityStateFields );
 
@@ -1508,18 +1652,9 @@ void MSG_WriteDeltaEntity( msg_t *msg, entityState_t *from, entityState_t *to,
 		Com_Error (ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number: %i", to->number );
 	}
 
-	lc = 0;
 	// build the change vector as bytes so it is endian independent
-	for ( i = 0, field = entityStateFields ; i < numFields ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-		if ( *fromF != *toF ) {
-			lc = i+1;
-#ifndef FINAL_BUILD
-			field->mCount++;
-#endif
-		}
-	}
+	MSG_ChangedWords( from, to, entityStateMap.numWords, changed );
+	lc = MSG_LastChangedField( &entityStateMap, changed, entityStateFields, from, to );
 
 	if ( lc == 0 ) {
 		// nothing at all changed
@@ -1542,10 +1677,9 @@ void MSG_WriteDeltaEntity( msg_t *msg, entityState_t *from, entityState_t *to,
 	oldsize += numFields;
 
 	for ( i = 0, field = entityStateFields ; i < lc ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
 		toF = (int *)( (byte *)to + field->offset );
 
-		if ( *fromF == *toF ) {
+		if ( !MSG_FieldChanged( changed, field, from, to ) ) {
 			MSG_WriteBits( msg, 0, 1 );	// no change
 			continue;
 		}
@@ -1879,6 +2013,8 @@ netField_t	playerStateFields[] =
 { PSF(userVec2[2]), 1 },
 };
 
+static const netFieldMap_t playerStateMap = MSG_BuildFieldMap( playerStateFields, (int)ARRAY_LEN( playerStateFields ), sizeof( playerState_t ) );
+
 //MAKE SURE THIS MATCHES THE ENUM IN BG_PUBLIC.H!!!
 //This is in caps, because it is important.
 #define STAT_WEAPONS 4
@@ -1897,9 +2033,10 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, playerState_t *from, playerState_t *
 	int				numFields;
 	netField_t		*field;
 	netField_t		*PSFields = playerStateFields;
-	int				*fromF, *toF;
+	int				*toF;
 	float			fullFloat;
 	int				trunc, lc;
+	uint32_t		changed[DELTA_MASK_WORDS];
 #ifdef _ONEBIT_COMBO
 	int				bitComboMask = 0;
 	int				numBitsInMask = 0;
@@ -1912,17 +2049,8 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, playerState_t *from, playerState_t *
 
 	numFields = (int)ARRAY_LEN( playerStateFields );
 
-	lc = 0;
-	for ( i = 0, field = PSFields ; i < numFields ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-		if ( *fromF != *toF ) {
-			lc = i+1;
-#ifndef FINAL_BUILD
-			field->mCount++;
-#endif
-		}
-	}
+	MSG_ChangedWords( from, to, playerStateMap.numWords, changed );
+	lc = MSG_LastChangedField( &playerStateMap, changed, PSFields, from, to );
 
 	MSG_WriteByte( msg, lc );	// # of changes
 
@@ -1933,7 +2061,6 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, playerState_t *from, playerState_t *
 	oldsize += numFields - lc;
 
 	for ( i = 0, field = PSFields ; i < lc ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
 		toF = (int *)( (byte *)to + field->offset );
 
 #ifdef _ONEBIT_COMBO
@@ -1946,7 +2073,7 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, playerState_t *from, playerState_t *
 		}
 #endif
 
-		if ( *fromF == *toF ) {
+		if ( !MSG_FieldChanged( changed, field, from, to ) ) {
 			MSG_WriteBits( msg, 0, 1 );	// no change
 			continue;
 		}
@@ -1976,30 +2103,10 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, playerState_t *from, playerState_t *
 
 	// send the arrays
 
-	statsbits = 0;
-	for (i=0 ; i<MAX_STATS ; i++) {
-		if (to->stats[i] != from->stats[i]) {
-			statsbits |= 1<<i;
-		}
-	}
-	persistantbits = 0;
-	for (i=0 ; i<MAX_PERSISTANT ; i++) {
-		if (to->persistant[i] != from->persistant[i]) {
-			persistantbits |= 1<<i;
-		}
-	}
-	ammobits = 0;
-	for (i=0 ; i<MAX_AMMO_TRANSMIT ; i++) {
-		if (to->ammo[i] != from->ammo[i]) {
-			ammobits |= 1<<i;
-		}
-	}
-	powerupbits = 0;
-	for (i=0 ; i<MAX_POWERUPS ; i++) {
-		if (to->powerups[i] != from->powerups[i]) {
-			powerupbits |= 1<<i;
-		}
-	}
+	statsbits = MSG_ChangedArrayBits( changed, offsetof( playerState_t, stats ), MAX_STATS );
+	persistantbits = MSG_ChangedArrayBits( changed, offsetof( playerState_t, persistant ), MAX_PERSISTANT );
+	ammobits = MSG_ChangedArrayBits( changed, offsetof( playerState_t, ammo ), MAX_AMMO_TRANSMIT );
+	powerupbits = MSG_ChangedArrayBits( changed, offsetof( playerState_t, powerups ), MAX_POWERUPS );
 
 	if (!statsbits && !persistantbits && !ammobits && !powerupbits) {
 		MSG_WriteBits( msg, 0, 1 );	// no change
@@ -2289,7 +2396,7 @@ void MSG_ReportChangeVectors_f( void ) {
 	Com_Printf("Entity State Fields:\n");
 	for ( i = 0, field = entityStateFields ; i < numFields ; i++, field++ )
 	{
-		Com_Printf("%s\t\t%d\n", field->name, field->mCount);
+		Com_Printf("%s\t\t%d\n", field->name, field->mCount.load());
 		field->mCount = 0;
 	}
 
@@ -2297,7 +2404,7 @@ void MSG_ReportChangeVectors_f( void ) {
 	numFields = (int)ARRAY_LEN( playerStateFields );
 	for ( i = 0, field = playerStateFields ; i < numFields ; i++, field++ )
 	{
-		Com_Printf("%s\t\t%d\n", field->name, field->mCount);
+		Com_Printf("%s\t\t%d\n", field->name, field->mCount.load());
 		field->mCount = 0;
 	}
 
@@ -348,6 +348,14 @@ bool NET_CompareBaseAdrMask( netadr_t a, netadr_t b, int netmask )
 		if ( netmask < 0 || netmask > 32 )
 			netmask = 32;
 	}
+	else if ( a.type == NA_IP6 )
+	{
+		addra = (byte *)&a.ip6;
+		addrb = (byte *)&b.ip6;
+
+		if ( netmask < 0 || netmask > 128 )
+			netmask = 128;
+	}
 	else
 	{
 		Com_Printf( "NET_CompareBaseAdr: bad address type\n" );
@@ -380,9 +388,40 @@ bool NET_CompareBaseAdr( netadr_t a, netadr_t b )
 	return NET_CompareBaseAdrMask( a, b, -1 );
 }
 
+// RFC 5952 form: lowercase hex, the longest run of two or more zero groups folded to ::
+static void NET_Ip6ToString( const byte *ip6, char *out, int size )
+{
+	int		groups[8];
+	int		best = -1, bestLen = 1;
+	int		i, j, len = 0;
+
+	for ( i = 0 ; i < 8 ; i++ )
+		groups[i] = ( ip6[i * 2] << 8 ) | ip6[i * 2 + 1];
+
+	for ( i = 0 ; i < 8 ; i = j + 1 ) {
+		for ( j = i ; j < 8 && !groups[j] ; j++ )
+			;
+		if ( j - i > bestLen ) {
+			best = i;
+			bestLen = j - i;
+		}
+	}
+
+	out[0] = '\0';
+	for ( i = 0 ; i < 8 ; i++ ) {
+		if ( i == best ) {
+			len += Com_sprintf( out + len, size - len, "::" );
+			i += bestLen - 1;
+			continue;
+		}
+		len += Com_sprintf( out + len, size - len, ( i && i != best + bestLen ) ? ":%x" : "%x", groups[i] );
+	}
+}
+
 const char	*NET_AdrToString (netadr_t a)
 {
 	static	char	s[64];
+	char			ip6[48];
 
 	if (a.type == NA_LOOPBACK) {
 		Com_sprintf (s, sizeof(s), "loopback");
@@ -391,6 +430,9 @@ const char	*NET_AdrToString (netadr_t a)
 	} else if (a.type == NA_IP) {
 		Com_sprintf (s, sizeof(s), "%i.%i.%i.%i:%hu",
 			a.ip[0], a.ip[1], a.ip[2], a.ip[3], BigShort(a.port));
+	} else if (a.type == NA_IP6) {
+		NET_Ip6ToString(a.ip6, ip6, sizeof(ip6));
+		Com_sprintf (s, sizeof(s), "[%s]:%hu", ip6, BigShort(a.port));
 	} else if (a.type == NA_BAD) {
 		Com_sprintf (s, sizeof(s), "BAD");
 	}
@@ -413,6 +455,13 @@ bool	NET_CompareAdr (netadr_t a, netadr_t b)
 		return false;
 	}
 
+	if (a.type == NA_IP6)
+	{
+		if ((memcmp(a.ip6, b.ip6, 16) == 0) && a.port == b.port && a.scope_id == b.scope_id)
+			return true;
+		return false;
+	}
+
 	Com_Printf ("NET_CompareAdr: bad address type\n");
 	return false;
 }
@@ -456,6 +505,7 @@ bool	NET_GetLoopPacket (netsrc_e sock, netadr_t *net_from, msg_t *net_message)
 
 	Com_Memcpy (net_message->data, loop->msgs[i].data, loop->msgs[i].datalen);
 	net_message->cursize = loop->msgs[i].datalen;
+	net_message->time = Sys_Milliseconds();
 	Com_Memset (net_from, 0, sizeof(*net_from));
 	net_from->type = NA_LOOPBACK;
 	return true;
@@ -550,12 +600,28 @@ bool	NET_StringToAdr( const char *s, netadr_t *a ) {
 		return true;
 	}
 
-	// look for a port number
-	Q_strncpyz( base, s, sizeof( base ) );
-	port = strchr( base, ':' );
-	if ( port ) {
-		*port = '\0';
-		port++;
+	// look for a port number, an ipv6 address only has one when it is written as [addr]:port
+	if ( s[0] == '[' ) {
+		Q_strncpyz( base, s + 1, sizeof( base ) );
+		port = strchr( base, ']' );
+		if ( !port ) {
+			a->type = NA_BAD;
+			return false;
+		}
+		*port++ = '\0';
+		if ( *port == ':' )
+			port++;
+		else
+			port = nullptr;
+	} else {
+		Q_strncpyz( base, s, sizeof( base ) );
+		port = strchr( base, ':' );
+		if ( port && strchr( port + 1, ':' ) ) {
+			port = nullptr;
+		} else if ( port ) {
+			*port = '\0';
+			port++;
+		}
 	}
 
 	if ( !Sys_StringToAdr( base, a ) ) {
@@ -564,7 +630,7 @@ bool	NET_StringToAdr( const char *s, netadr_t *a ) {
 	}
 
 	// inet_addr returns this if out of range
-	if ( a->ip[0] == 255 && a->ip[1] == 255 && a->ip[2] == 255 && a->ip[3] == 255 ) {
+	if ( a->type == NA_IP && a->ip[0] == 255 && a->ip[1] == 255 && a->ip[2] == 255 && a->ip[3] == 255 ) {
 		a->type = NA_BAD;
 		return false;
 	}
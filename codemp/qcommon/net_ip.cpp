@@ -28,10 +28,14 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/com_cvars.h"
 #include "sys/sys_public.h"
 
-#ifdef _WIN32
-	#include <winsock.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
-	typedef int socklen_t;
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
 
 	#undef EAGAIN
 	#undef EADDRNOTAVAIL
@@ -75,6 +79,12 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include <sys/filio.h>
 #endif
 
+#ifdef __linux__
+	#define NET_BATCH_IO	1
+#else
+	#define NET_BATCH_IO	0
+#endif
+
 typedef int SOCKET;
 #define INVALID_SOCKET                -1
 #define SOCKET_ERROR                        -1
@@ -89,7 +99,17 @@ static bool networkingEnabled = false;
 
 static struct sockaddr_in	socksRelayAddr;
 
+// every bound socket is polled, packets go out through the first one of their family
+struct netSocket_t {
+	SOCKET			fd;
+	netadrtype_e	type;	// NA_IP or NA_IP6
+};
+
+static netSocket_t	netSockets[MAX_NET_SOCKETS * 2];
+static int			numNetSockets;
+
 static SOCKET	ip_socket = INVALID_SOCKET;
+static SOCKET	ip6_socket = INVALID_SOCKET;
 static SOCKET	socks_socket = INVALID_SOCKET;
 
 #define	MAX_IPS		16
@@ -151,60 +171,132 @@ char *NET_ErrorString( void ) {
 #endif
 }
 
-static void NetadrToSockadr( netadr_t *a, struct sockaddr_in *s ) {
-	memset( s, 0, sizeof(*s) );
-
+static void NetadrToSockadr( netadr_t *a, struct sockaddr *s ) {
 	if( a->type == NA_BROADCAST ) {
-		s->sin_family = AF_INET;
-		s->sin_port = a->port;
-		s->sin_addr.s_addr = INADDR_BROADCAST;
+		struct sockaddr_in *s4 = (struct sockaddr_in *)s;
+		memset( s4, 0, sizeof(*s4) );
+		s4->sin_family = AF_INET;
+		s4->sin_port = a->port;
+		s4->sin_addr.s_addr = INADDR_BROADCAST;
 	}
 	else if( a->type == NA_IP ) {
-		s->sin_family = AF_INET;
-		memcpy( &s->sin_addr, a->ip, sizeof(s->sin_addr) );
-		s->sin_port = a->port;
+		struct sockaddr_in *s4 = (struct sockaddr_in *)s;
+		memset( s4, 0, sizeof(*s4) );
+		s4->sin_family = AF_INET;
+		memcpy( &s4->sin_addr, a->ip, sizeof(s4->sin_addr) );
+		s4->sin_port = a->port;
+	}
+	else if( a->type == NA_IP6 ) {
+		struct sockaddr_in6 *s6 = (struct sockaddr_in6 *)s;
+		memset( s6, 0, sizeof(*s6) );
+		s6->sin6_family = AF_INET6;
+		memcpy( &s6->sin6_addr, a->ip6, sizeof(s6->sin6_addr) );
+		s6->sin6_port = a->port;
+		s6->sin6_scope_id = a->scope_id;
 	}
 }
 
-static void SockadrToNetadr( struct sockaddr_in *s, netadr_t *a ) {
-	assert(s->sin_family == AF_INET);
-	a->type = NA_IP;
-	memcpy( a->ip, &s->sin_addr, sizeof(a->ip) );
-	a->port = s->sin_port;
+static void SockadrToNetadr( struct sockaddr *s, netadr_t *a ) {
+	if( s->sa_family == AF_INET ) {
+		a->type = NA_IP;
+		memcpy( a->ip, &((struct sockaddr_in *)s)->sin_addr, sizeof(a->ip) );
+		a->port = ((struct sockaddr_in *)s)->sin_port;
+	}
+	else if( s->sa_family == AF_INET6 ) {
+		a->type = NA_IP6;
+		memcpy( a->ip6, &((struct sockaddr_in6 *)s)->sin6_addr, sizeof(a->ip6) );
+		a->port = ((struct sockaddr_in6 *)s)->sin6_port;
+		a->scope_id = ((struct sockaddr_in6 *)s)->sin6_scope_id;
+	}
+	else {
+		a->type = NA_BAD;
+	}
 }
 
-static bool Sys_StringToSockaddr( const char *s, struct sockaddr_in *sadr )
-{
-	struct hostent	*h;
+static socklen_t SockadrLength( const struct sockaddr *s ) {
+	return s->sa_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+}
 
-	memset( sadr, 0, sizeof( *sadr ) );
+static struct addrinfo *SearchAddrInfo( struct addrinfo *hints, int family ) {
+	for ( ; hints ; hints = hints->ai_next ) {
+		if ( hints->ai_family == family ) {
+			return hints;
+		}
+	}
+	return nullptr;
+}
 
-	sadr->sin_family = AF_INET;
-	sadr->sin_port = 0;
+// family is AF_INET, AF_INET6, or AF_UNSPEC to pick one by the enabled protocols and NET_PRIOV6
+static bool Sys_StringToSockaddr( const char *s, struct sockaddr *sadr, int sadr_len, int family )
+{
+	struct addrinfo	hints;
+	struct addrinfo	*res = nullptr;
+	struct addrinfo	*search = nullptr;
+	int				retval;
+
+	memset( sadr, 0, sadr_len );
+	memset( &hints, 0, sizeof( hints ) );
+	hints.ai_family = family;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	retval = getaddrinfo( s, nullptr, &hints, &res );
+	if( retval )
+	{
+		Com_Printf( "Sys_StringToSockaddr: Error resolving %s: %s\n", s, gai_strerror( retval ) );
+		return false;
+	}
 
-	if( s[0] >= '0' && s[0] <= '9' )
+	if( family == AF_UNSPEC )
 	{
-		sadr->sin_addr.s_addr = inet_addr(s);
+		if( net_enabled->integer & NET_PRIOV6 )
+		{
+			if( net_enabled->integer & NET_ENABLEV6 )
+				search = SearchAddrInfo( res, AF_INET6 );
+			if( !search && ( net_enabled->integer & NET_ENABLEV4 ) )
+				search = SearchAddrInfo( res, AF_INET );
+		}
+		else
+		{
+			if( net_enabled->integer & NET_ENABLEV4 )
+				search = SearchAddrInfo( res, AF_INET );
+			if( !search && ( net_enabled->integer & NET_ENABLEV6 ) )
+				search = SearchAddrInfo( res, AF_INET6 );
+		}
 	}
 	else
 	{
-		if( ( h = gethostbyname( s ) ) == 0 )
-			return false;
-		sadr->sin_addr.s_addr = *(uint32_t *)h->h_addr_list[0];
+		search = SearchAddrInfo( res, family );
+	}
+
+	if( !search || (int)search->ai_addrlen > sadr_len )
+	{
+		Com_Printf( "Sys_StringToSockaddr: Error resolving %s: No address of required type found.\n", s );
+		freeaddrinfo( res );
+		return false;
 	}
 
+	memcpy( sadr, search->ai_addr, search->ai_addrlen );
+	freeaddrinfo( res );
 	return true;
 }
 
 //Does NOT parse port numbers, only base addresses.
-bool Sys_StringToAdr( const char *s, netadr_t *a ) {
-	struct sockaddr_in sadr;
+bool Sys_StringToAdr( const char *s, netadr_t *a, netadrtype_e family ) {
+	struct sockaddr_storage sadr;
+	int fam;
 
-	if ( !Sys_StringToSockaddr( s, &sadr ) ) {
+	switch( family ) {
+	case NA_IP:		fam = AF_INET;		break;
+	case NA_IP6:	fam = AF_INET6;		break;
+	default:		fam = AF_UNSPEC;	break;
+	}
+
+	if ( !Sys_StringToSockaddr( s, (struct sockaddr *)&sadr, sizeof( sadr ), fam ) ) {
 		return false;
 	}
 
-	SockadrToNetadr( &sadr, a );
+	memset( a, 0, sizeof( *a ) );
+	SockadrToNetadr( (struct sockaddr *)&sadr, a );
 	return true;
 }
 
@@ -213,34 +305,11 @@ bool Sys_StringToAdr( const char *s, netadr_t *a ) {
 int	recvfromCount;
 #endif
 
-bool NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
-	int ret, err;
-	socklen_t fromlen;
-	struct sockaddr_in from;
-
-	if ( ip_socket == INVALID_SOCKET || !FD_ISSET(ip_socket, fdr) ) {
-		return false;
-	}
-
-	fromlen = sizeof( from );
-#ifdef _DEBUG
-	recvfromCount++;		// performance check
-#endif
-	ret = recvfrom( ip_socket, (char *)net_message->data, net_message->maxsize, 0, (struct sockaddr *)&from, &fromlen );
-
-	if ( ret == SOCKET_ERROR ) {
-		err = socketError;
-
-		if( err == EAGAIN || err == ECONNRESET )
-			return false;
-
-		Com_Printf( "NET_GetPacket: %s\n", NET_ErrorString() );
-		return false;
-	}
-
-	memset( from.sin_zero, 0, 8 );
-
-	if ( usingSocks && memcmp( &from, &socksRelayAddr, fromlen ) == 0 ) {
+// Fills in the sender of a packet of ret bytes that was received into net_message
+static bool NET_AcceptPacket( struct sockaddr_storage &from, socklen_t fromlen, int ret, netadr_t *net_from, msg_t *net_message ) {
+	if ( usingSocks && from.ss_family == AF_INET && fromlen == sizeof( socksRelayAddr )
+		&& ((struct sockaddr_in *)&from)->sin_port == socksRelayAddr.sin_port
+		&& !memcmp( &((struct sockaddr_in *)&from)->sin_addr, &socksRelayAddr.sin_addr, sizeof( socksRelayAddr.sin_addr ) ) ) {
 		if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
 			return false;
 		}
@@ -253,7 +322,7 @@ bool NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 		net_message->readcount = 10;
 	}
 	else {
-		SockadrToNetadr( &from, net_from );
+		SockadrToNetadr( (struct sockaddr *)&from, net_from );
 		net_message->readcount = 0;
 	}
 
@@ -266,50 +335,174 @@ bool NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 	return true;
 }
 
+// Sockets are cleared from fdr as they run dry
+bool NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
+	int ret, err, i;
+	socklen_t fromlen;
+	struct sockaddr_storage from;
+
+	for ( i = 0 ; i < numNetSockets ; i++ ) {
+		SOCKET s = netSockets[i].fd;
+
+		if ( !FD_ISSET(s, fdr) ) {
+			continue;
+		}
+
+		fromlen = sizeof( from );
+#ifdef _DEBUG
+		recvfromCount++;		// performance check
+#endif
+		ret = recvfrom( s, (char *)net_message->data, net_message->maxsize, 0, (struct sockaddr *)&from, &fromlen );
+
+		if ( ret == SOCKET_ERROR ) {
+			err = socketError;
+			FD_CLR( s, fdr );
+
+			if( err != EAGAIN && err != ECONNRESET )
+				Com_Printf( "NET_GetPacket: %s\n", NET_ErrorString() );
+			continue;
+		}
+
+		return NET_AcceptPacket( from, fromlen, ret, net_from, net_message );
+	}
+
+	return false;
+}
+
+#if NET_BATCH_IO
+// Packets move through recvmmsg/sendmmsg this many at a time
+#define NET_BATCH_PACKETS	32
+#define NET_BATCH_SENDLEN	1400	// MAX_PACKETLEN, bigger packets are sent on their own
+
+struct netRecvBatch_t {
+	byte				data[NET_BATCH_PACKETS][MAX_MSGLEN + 1];
+	struct sockaddr_storage	from[NET_BATCH_PACKETS];
+	struct iovec		iov[NET_BATCH_PACKETS];
+	struct mmsghdr		hdrs[NET_BATCH_PACKETS];
+};
+
+// one for each address family, as a batch goes out through a single socket
+struct netSendBatch_t {
+	bool				open;
+	int					count;
+	byte				data[NET_BATCH_PACKETS][NET_BATCH_SENDLEN];
+	struct sockaddr_storage	to[NET_BATCH_PACKETS];
+	netadrtype_e		type[NET_BATCH_PACKETS];
+	struct iovec		iov[NET_BATCH_PACKETS];
+	struct mmsghdr		hdrs[NET_BATCH_PACKETS];
+};
+
+static netRecvBatch_t	netRecv;
+static netSendBatch_t	netSend[2];
+#endif
+
 static char socksBuf[4096];
 
+static void NET_SendError( netadrtype_e type ) {
+	int err = socketError;
+
+	// wouldblock is silent
+	if( err == EAGAIN ) {
+		return;
+	}
+
+	// some PPP links do not allow broadcasts and return an error
+	if( err == EADDRNOTAVAIL && type == NA_BROADCAST ) {
+		return;
+	}
+
+	Com_Printf( "NET_SendPacket: %s\n", NET_ErrorString() );
+}
+
+#if NET_BATCH_IO
+static void NET_FlushPacketBatch( netSendBatch_t *batch, SOCKET s ) {
+	int i, ret, sent;
+
+	for ( i = 0 ; i < batch->count ; i++ ) {
+		batch->iov[i].iov_base = batch->data[i];
+		batch->hdrs[i].msg_hdr.msg_name = &batch->to[i];
+		batch->hdrs[i].msg_hdr.msg_namelen = SockadrLength( (struct sockaddr *)&batch->to[i] );
+		batch->hdrs[i].msg_hdr.msg_iov = &batch->iov[i];
+		batch->hdrs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	// sendmmsg stops at the first packet that fails, report it and carry on with the rest
+	for ( sent = 0 ; sent < batch->count && s != INVALID_SOCKET ; ) {
+		ret = sendmmsg( s, &batch->hdrs[sent], batch->count - sent, 0 );
+		if ( ret == SOCKET_ERROR ) {
+			NET_SendError( batch->type[sent] );
+			sent++;
+		} else {
+			sent += ret;
+		}
+	}
+
+	batch->count = 0;
+}
+#endif
+
+// Packets sent until NET_EndPacketBatch are queued and go out together
+void NET_BeginPacketBatch( void ) {
+#if NET_BATCH_IO
+	netSend[0].open = netSend[1].open = net_batch->integer != 0;
+#endif
+}
+
+void NET_EndPacketBatch( void ) {
+#if NET_BATCH_IO
+	NET_FlushPacketBatch( &netSend[0], ip_socket );
+	NET_FlushPacketBatch( &netSend[1], ip6_socket );
+	netSend[0].open = netSend[1].open = false;
+#endif
+}
+
 void Sys_SendPacket( int length, const void *data, netadr_t to ) {
-	int					ret;
-	struct sockaddr_in	addr;
+	int						ret;
+	SOCKET					s;
+	struct sockaddr_storage	addr;
 
-	if ( to.type != NA_BROADCAST && to.type != NA_IP ) {
+	if ( to.type != NA_BROADCAST && to.type != NA_IP && to.type != NA_IP6 ) {
 		Com_Error( ERR_FATAL, "Sys_SendPacket: bad address type" );
 		return;
 	}
 
-	if ( ip_socket == INVALID_SOCKET ) {
+	s = ( to.type == NA_IP6 ) ? ip6_socket : ip_socket;
+	if ( s == INVALID_SOCKET ) {
 		return;
 	}
 
-	NetadrToSockadr( &to, &addr );
+	NetadrToSockadr( &to, (struct sockaddr *)&addr );
+
+#if NET_BATCH_IO
+	netSendBatch_t *batch = &netSend[to.type == NA_IP6];
+	if ( batch->open && !usingSocks && length <= NET_BATCH_SENDLEN ) {
+		if ( batch->count == NET_BATCH_PACKETS ) {
+			NET_FlushPacketBatch( batch, s );
+		}
+		memcpy( batch->data[batch->count], data, length );
+		batch->iov[batch->count].iov_len = length;
+		batch->to[batch->count] = addr;
+		batch->type[batch->count] = to.type;
+		batch->count++;
+		return;
+	}
+#endif
 
 	if( usingSocks && to.type == NA_IP ) {
 		socksBuf[0] = 0;	// reserved
 		socksBuf[1] = 0;
 		socksBuf[2] = 0;	// fragment (not fragmented)
 		socksBuf[3] = 1;	// address type: IPV4
-		memcpy( &socksBuf[4], &addr.sin_addr, 4 );
-		memcpy( &socksBuf[8], &addr.sin_port, 2 );
+		memcpy( &socksBuf[4], &((struct sockaddr_in *)&addr)->sin_addr, 4 );
+		memcpy( &socksBuf[8], &((struct sockaddr_in *)&addr)->sin_port, 2 );
 		memcpy( &socksBuf[10], data, length );
-		ret = sendto( ip_socket, socksBuf, length+10, 0, (sockaddr *)&socksRelayAddr, sizeof(socksRelayAddr) );
+		ret = sendto( s, socksBuf, length+10, 0, (sockaddr *)&socksRelayAddr, sizeof(socksRelayAddr) );
 	}
 	else {
-		ret = sendto( ip_socket, (const char *)data, length, 0, (sockaddr *)&addr, sizeof(addr) );
+		ret = sendto( s, (const char *)data, length, 0, (sockaddr *)&addr, SockadrLength( (struct sockaddr *)&addr ) );
 	}
 	if( ret == SOCKET_ERROR ) {
-		int err = socketError;
-
-		// wouldblock is silent
-		if( err == EAGAIN ) {
-			return;
-		}
-
-		// some PPP links do not allow broadcasts and return an error
-		if( err == EADDRNOTAVAIL && to.type == NA_BROADCAST ) {
-			return;
-		}
-
-		Com_Printf( "NET_SendPacket: %s\n", NET_ErrorString() );
+		NET_SendError( to.type );
 	}
 }
 
@@ -321,6 +514,19 @@ bool Sys_IsLANAddress( netadr_t adr ) {
 	if( adr.type == NA_LOOPBACK )
 		return true;
 
+	if( adr.type == NA_IP6 ) {
+		static const byte loopback6[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+
+		// loopback, link-local (fe80::/10) and unique local (fc00::/7)
+		if ( !memcmp( adr.ip6, loopback6, sizeof( loopback6 ) ) )
+			return true;
+		if ( adr.ip6[0] == 0xfe && (adr.ip6[1]&0xc0) == 0x80 )
+			return true;
+		if ( (adr.ip6[0]&0xfe) == 0xfc )
+			return true;
+		return false;
+	}
+
 	if( adr.type != NA_IP )
 		return false;
 
@@ -354,22 +560,24 @@ void Sys_ShowIP(void) {
 		Com_Printf( "IP: %i.%i.%i.%i\n", localIP[i][0], localIP[i][1], localIP[i][2], localIP[i][3] );
 }
 
-SOCKET NET_IPSocket( char *net_interface, int port, int *err ) {
-	SOCKET				newsocket;
-	struct sockaddr_in	address;
-	u_long				_true = 1;
-	int					i = 1;
+// family is AF_INET or AF_INET6, reusePort lets several sockets share the port and the kernel spread packets between them
+static SOCKET NET_IPSocket( int family, const char *net_interface, int port, bool reusePort, int *err ) {
+	SOCKET					newsocket;
+	struct sockaddr_storage	address;
+	u_long					_true = 1;
+	int						i = 1;
+	const char				*name = ( family == AF_INET6 ) ? "IPv6" : "IP";
 
 	*err = 0;
 
 	if( net_interface ) {
-		Com_Printf( "Opening IP socket: %s:%i\n", net_interface, port );
+		Com_Printf( "Opening %s socket: %s:%i\n", name, net_interface, port );
 	}
 	else {
-		Com_Printf( "Opening IP socket: localhost:%i\n", port );
+		Com_Printf( "Opening %s socket: localhost:%i\n", name, port );
 	}
 
-	if( ( newsocket = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP ) ) == INVALID_SOCKET ) {
+	if( ( newsocket = socket( family, SOCK_DGRAM, IPPROTO_UDP ) ) == INVALID_SOCKET ) {
 		*err = socketError;
 		Com_Printf( "WARNING: NET_IPSocket: socket: %s\n", NET_ErrorString() );
 		return newsocket;
@@ -383,31 +591,54 @@ SOCKET NET_IPSocket( char *net_interface, int port, int *err ) {
 		return INVALID_SOCKET;
 	}
 
-	// make it broadcast capable
-	if( setsockopt( newsocket, SOL_SOCKET, SO_BROADCAST, (char *)&i, sizeof(i) ) == SOCKET_ERROR ) {
-		Com_Printf( "WARNING: NET_IPSocket: setsockopt SO_BROADCAST: %s\n", NET_ErrorString() );
+	if( family == AF_INET ) {
+		// make it broadcast capable
+		if( setsockopt( newsocket, SOL_SOCKET, SO_BROADCAST, (char *)&i, sizeof(i) ) == SOCKET_ERROR ) {
+			Com_Printf( "WARNING: NET_IPSocket: setsockopt SO_BROADCAST: %s\n", NET_ErrorString() );
+		}
+	}
+	else {
+		// ipv4 has its own socket on the same port
+		if( setsockopt( newsocket, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&i, sizeof(i) ) == SOCKET_ERROR ) {
+			Com_Printf( "WARNING: NET_IPSocket: setsockopt IPV6_V6ONLY: %s\n", NET_ErrorString() );
+		}
+	}
+
+	if( reusePort ) {
+#ifdef SO_REUSEPORT
+		if( setsockopt( newsocket, SOL_SOCKET, SO_REUSEPORT, (char *)&i, sizeof(i) ) == SOCKET_ERROR ) {
+			Com_Printf( "WARNING: NET_IPSocket: setsockopt SO_REUSEPORT: %s\n", NET_ErrorString() );
+		}
+#else
+		Com_Printf( "WARNING: NET_IPSocket: SO_REUSEPORT is not supported on this platform\n" );
+#endif
 	}
 
 	if( !net_interface || !net_interface[0] || !Q_stricmp(net_interface, "localhost") ) {
 		memset( &address, 0, sizeof( address ) );
-		address.sin_family = AF_INET;
-		address.sin_addr.s_addr = INADDR_ANY;
+		address.ss_family = family;
+		if( family == AF_INET ) {
+			((struct sockaddr_in *)&address)->sin_addr.s_addr = INADDR_ANY;
+		}
+		else {
+			((struct sockaddr_in6 *)&address)->sin6_addr = in6addr_any;
+		}
 	}
 	else {
-		if ( !Sys_StringToSockaddr( net_interface, &address ) ) {
+		if ( !Sys_StringToSockaddr( net_interface, (struct sockaddr *)&address, sizeof( address ), family ) ) {
 			closesocket( newsocket );
 			return INVALID_SOCKET;
 		}
 	}
 
-	if( port == PORT_ANY ) {
-		address.sin_port = 0;
+	if( family == AF_INET ) {
+		((struct sockaddr_in *)&address)->sin_port = ( port == PORT_ANY ) ? 0 : htons( port );
 	}
 	else {
-		address.sin_port = htons( port );
+		((struct sockaddr_in6 *)&address)->sin6_port = ( port == PORT_ANY ) ? 0 : htons( port );
 	}
 
-	if( bind( newsocket, (const struct sockaddr *)&address, sizeof(address) ) == SOCKET_ERROR ) {
+	if( bind( newsocket, (const struct sockaddr *)&address, SockadrLength( (struct sockaddr *)&address ) ) == SOCKET_ERROR ) {
 		Com_Printf( "WARNING: NET_IPSocket: bind: %s\n", NET_ErrorString() );
 		*err = socketError;
 		closesocket( newsocket );
@@ -734,34 +965,75 @@ void NET_GetLocalAddress( void )
 }
 #endif
 
-void NET_OpenIP( void )
-{
-	int port = net_port->integer;
-	int err;
-
-	NET_GetLocalAddress();
+// Binds net_sockets sockets of one family and returns the first, which packets are sent from.
+// offset is where in the port scan to start, and comes back as the offset that was taken.
+static SOCKET NET_OpenSockets( netadrtype_e type, const char *net_interface, cvar_t *portCvar, int *offset ) {
+	const int	family = ( type == NA_IP6 ) ? AF_INET6 : AF_INET;
+	SOCKET		first = INVALID_SOCKET, s;
+	int			port = portCvar->integer;
+	int			err, i = 0, j;
 
 	// automatically scan for a valid port, so multiple
 	// dedicated servers can be started without requiring
 	// a different net_port for each one
+	for ( j = 0 ; j < 10 ; j++ ) {
+		i = ( *offset + j ) % 10;
+		first = NET_IPSocket( family, net_interface, port + i, false, &err );
+		if ( first != INVALID_SOCKET ) {
+			break;
+		}
+		if ( err == EAFNOSUPPORT )
+			break;
+	}
+	if ( first == INVALID_SOCKET ) {
+		Com_Printf( "WARNING: Couldn't bind to a %s ip address.\n", ( type == NA_IP6 ) ? "v6" : "v4" );
+		return INVALID_SOCKET;
+	}
+	port += i;
+	*offset = i;
+	Cvar_SetValue( portCvar->name, port );
+
+	// another server binding a shared port would silently join it, so the port is only
+	// opened up for sharing once the plain bind above has shown nobody else is on it
+	if ( net_sockets->integer > 1 ) {
+		closesocket( first );
+		first = NET_IPSocket( family, net_interface, port, true, &err );
+		if ( first == INVALID_SOCKET ) {
+			Com_Printf( "WARNING: Couldn't bind to a %s ip address.\n", ( type == NA_IP6 ) ? "v6" : "v4" );
+			return INVALID_SOCKET;
+		}
+	}
+
+	netSockets[numNetSockets].fd = first;
+	netSockets[numNetSockets].type = type;
+	numNetSockets++;
+
+	for ( i = 1 ; i < net_sockets->integer ; i++ ) {
+		s = NET_IPSocket( family, net_interface, port, true, &err );
+		if ( s == INVALID_SOCKET )
+			break;
+		netSockets[numNetSockets].fd = s;
+		netSockets[numNetSockets].type = type;
+		numNetSockets++;
+	}
+
+	return first;
+}
+
+void NET_OpenIP( void )
+{
+	int	offset = 0;	// v6 tries the port offset v4 ended up with first, so the two stay in step
+
+	NET_GetLocalAddress();
 
 	if ( net_enabled->integer & NET_ENABLEV4 ) {
-		for ( int i=0 ; i < 10 ; i++ ) {
-			ip_socket = NET_IPSocket( net_ip->string, port + i, &err );
-			if ( ip_socket != INVALID_SOCKET ) {
-				Cvar_SetValue( "net_port", port + i );
+		ip_socket = NET_OpenSockets( NA_IP, net_ip->string, net_port, &offset );
+		if ( ip_socket != INVALID_SOCKET && net_socksEnabled->integer )
+			NET_OpenSocks( net_port->integer );
+	}
 
-				if ( net_socksEnabled->integer )
-					NET_OpenSocks( port + i );
-				break;
-			}
-			else {
-				if ( err == EAFNOSUPPORT )
-					break;
-			}
-		}
-		if ( ip_socket == INVALID_SOCKET )
-			Com_Printf( "WARNING: Couldn't bind to a v4 ip address.\n");
+	if ( net_enabled->integer & NET_ENABLEV6 ) {
+		ip6_socket = NET_OpenSockets( NA_IP6, net_ip6->string, net_port6, &offset );
 	}
 }
 
@@ -770,26 +1042,196 @@ static bool NET_GetCvars( void ) {
 		net_enabled->modified +
 		net_forcenonlocal->modified +
 		net_ip->modified +
+		net_ip6->modified +
 		net_port->modified +
+		net_port6->modified +
+		net_sockets->modified +
 		net_socksEnabled->modified +
 		net_socksServer->modified +
 		net_socksPort->modified +
 		net_socksUsername->modified +
-		net_socksPassword->modified;
+		net_socksPassword->modified +
+		net_thread->modified;
 
 	net_enabled->modified =
 		net_forcenonlocal->modified =
 		net_ip->modified =
+		net_ip6->modified =
 		net_port->modified =
+		net_port6->modified =
+		net_sockets->modified =
 		net_socksEnabled->modified =
 		net_socksServer->modified =
 		net_socksPort->modified =
 		net_socksUsername->modified =
-		net_socksPassword->modified = false;
+		net_socksPassword->modified =
+		net_thread->modified = false;
 
 	return modified ? true : false;
 }
 
+// Receive thread
+// With net_thread set, one thread waits on the sockets and copies each datagram into a ring the moment it
+// arrives, stamped with its arrival time. The main thread only reads the ring, from NET_Sleep, so a long frame
+// no longer leaves packets queueing in the socket buffer. One producer and one consumer, so the ring needs no lock.
+
+#define NET_QUEUE_SIZE			(1<<20)		// bytes of packets the thread can get ahead of the frame
+#define NET_QUEUE_INTERVAL		50			// msec the thread waits on the sockets before checking for shutdown
+
+// Records never wrap. One that doesn't fit before the end of the ring leaves a skip marker, or nothing if
+// there's no room for a header, and starts over at the front.
+struct netQueuedPacket_t {
+	int						time;		// Sys_Milliseconds when it was read off the socket
+	int						length;		// bytes of data following the header, -1 skips to the front
+	socklen_t				fromlen;
+	struct sockaddr_storage	from;
+};
+
+static std::thread				*netThread;
+static std::atomic<bool>		netThreadQuit;
+static byte						*netQueue;
+static std::atomic<unsigned>	netQueueHead;		// bytes queued by the thread
+static std::atomic<unsigned>	netQueueTail;		// bytes dispatched by the main thread
+static std::atomic<int>			netQueueDropped;
+static std::atomic<bool>		netQueueSleeping;	// the main thread is waiting in NET_Sleep
+static std::mutex				netQueueMutex;
+static std::condition_variable	netQueueWake;
+
+static unsigned NET_QueueRecordSize( int length ) {
+	return ( sizeof( netQueuedPacket_t ) + length + 7 ) & ~7u;
+}
+
+// Returns false when the ring is full, the caller drops the packet
+static bool NET_QueuePacket( const byte *data, int length, const struct sockaddr_storage *from, socklen_t fromlen ) {
+	unsigned			head, tail, start, size, skip = 0;
+	netQueuedPacket_t	*rec;
+
+	head = netQueueHead.load( std::memory_order_relaxed );
+	tail = netQueueTail.load( std::memory_order_acquire );
+	start = head & ( NET_QUEUE_SIZE - 1 );
+	size = NET_QueueRecordSize( length );
+
+	if ( start + size > NET_QUEUE_SIZE ) {
+		skip = NET_QUEUE_SIZE - start;
+	}
+	if ( NET_QUEUE_SIZE - ( head - tail ) < skip + size ) {
+		return false;
+	}
+
+	if ( skip ) {
+		if ( skip >= sizeof( netQueuedPacket_t ) ) {
+			( (netQueuedPacket_t *)( netQueue + start ) )->length = -1;
+		}
+		head += skip;
+		start = 0;
+	}
+
+	rec = (netQueuedPacket_t *)( netQueue + start );
+	rec->time = Sys_Milliseconds();
+	rec->length = length;
+	rec->fromlen = fromlen;
+	rec->from = *from;
+	memcpy( rec + 1, data, length );
+
+	// sequentially consistent so either NET_WaitForQueue sees the packet or we see it sleeping
+	netQueueHead.store( head + size );
+	return true;
+}
+
+static void NET_ReceiveThread( void ) {
+	static byte				data[MAX_MSGLEN + 1];
+	struct sockaddr_storage	from;
+	socklen_t				fromlen;
+	struct timeval			timeout;
+	fd_set					fdr;
+	SOCKET					highestfd;
+	bool					queued;
+	int						i, ret, len;
+
+	// the sockets stay open for as long as the thread runs, NET_Config stops it first
+	while ( !netThreadQuit ) {
+		FD_ZERO( &fdr );
+		highestfd = INVALID_SOCKET;
+		for ( i = 0 ; i < numNetSockets ; i++ ) {
+			FD_SET( netSockets[i].fd, &fdr );
+			if ( highestfd == INVALID_SOCKET || netSockets[i].fd > highestfd )
+				highestfd = netSockets[i].fd;
+		}
+
+		timeout.tv_sec = 0;
+		timeout.tv_usec = NET_QUEUE_INTERVAL * 1000;
+
+		ret = select( highestfd + 1, &fdr, nullptr, nullptr, &timeout );
+		if ( ret == SOCKET_ERROR ) {
+			// nothing to report to from here, just don't spin
+			Sys_Sleep( NET_QUEUE_INTERVAL );
+			continue;
+		}
+
+		queued = false;
+		for ( i = 0 ; i < numNetSockets && ret > 0 ; i++ ) {
+			if ( !FD_ISSET( netSockets[i].fd, &fdr ) ) {
+				continue;
+			}
+
+			// read until it would block, errors are left for the next select
+			for ( ;; ) {
+				fromlen = sizeof( from );
+				len = recvfrom( netSockets[i].fd, (char *)data, sizeof( data ), 0, (struct sockaddr *)&from, &fromlen );
+				if ( len == SOCKET_ERROR ) {
+					break;
+				}
+				if ( NET_QueuePacket( data, len, &from, fromlen ) ) {
+					queued = true;
+				} else {
+					netQueueDropped++;
+				}
+			}
+		}
+
+		if ( queued && netQueueSleeping ) {
+			std::lock_guard<std::mutex> lock( netQueueMutex );
+			netQueueWake.notify_one();
+		}
+	}
+}
+
+static void NET_StartThread( void ) {
+	if ( netThread || !numNetSockets ) {
+		return;
+	}
+
+	netQueue = new byte[NET_QUEUE_SIZE];
+	netQueueHead = 0;
+	netQueueTail = 0;
+	netQueueDropped = 0;
+	netThreadQuit = false;
+	netThread = new std::thread( NET_ReceiveThread );
+}
+
+// Whatever is still queued is thrown away, as it would be with the sockets closed
+static void NET_StopThread( void ) {
+	if ( !netThread ) {
+		return;
+	}
+
+	netThreadQuit = true;
+	netThread->join();
+	delete netThread;
+	netThread = nullptr;
+	delete[] netQueue;
+	netQueue = nullptr;
+}
+
+// Sleeps msec or until the thread queues a packet
+static void NET_WaitForQueue( int msec ) {
+	std::unique_lock<std::mutex> lock( netQueueMutex );
+
+	netQueueSleeping = true;
+	netQueueWake.wait_for( lock, std::chrono::milliseconds( msec ), [] { return netQueueHead.load() != netQueueTail.load( std::memory_order_relaxed ); } );
+	netQueueSleeping = false;
+}
+
 void NET_Config( bool enableNetworking ) {
 	bool	modified;
 	bool	stop;
@@ -828,10 +1270,14 @@ void NET_Config( bool enableNetworking ) {
 	}
 
 	if ( stop ) {
-		if ( ip_socket != INVALID_SOCKET ) {
-			closesocket( ip_socket );
-			ip_socket = INVALID_SOCKET;
+		NET_StopThread();
+
+		for ( int i = 0 ; i < numNetSockets ; i++ ) {
+			closesocket( netSockets[i].fd );
 		}
+		numNetSockets = 0;
+		ip_socket = INVALID_SOCKET;
+		ip6_socket = INVALID_SOCKET;
 
 		if ( socks_socket != INVALID_SOCKET ) {
 			closesocket( socks_socket );
@@ -842,12 +1288,14 @@ void NET_Config( bool enableNetworking ) {
 	if ( start ) {
 		if ( net_enabled->integer )
 			NET_OpenIP();
+		if ( net_thread->integer )
+			NET_StartThread();
 	}
 }
 
 void NET_Init( void ) {
 #ifdef _WIN32
-	int r = WSAStartup( MAKEWORD( 1, 1 ), &winsockdata );
+	int r = WSAStartup( MAKEWORD( 2, 2 ), &winsockdata );
 	if( r ) {
 		Com_Printf( "WARNING: Winsock initialization failed, returned %d\n", r );
 		return;
@@ -874,6 +1322,113 @@ void NET_Shutdown( void ) {
 #endif
 }
 
+static void NET_DispatchPacket(netadr_t *from, msg_t *netmsg)
+{
+	if(net_dropsim->value > 0.0f && net_dropsim->value <= 100.0f)
+	{
+		// com_dropsim->value percent of incoming packets get dropped.
+		if(rand() < (int) (((double) RAND_MAX) / 100.0 * (double) net_dropsim->value))
+			return;          // drop this packet
+	}
+
+	if(sv_running->integer)
+		Com_RunAndTimeServerPacket(from, netmsg);
+	else
+		CL_PacketEvent(*from, netmsg);
+}
+
+// Hands everything the receive thread has queued to the game, in arrival order
+static void NET_DrainQueue( void ) {
+	byte				bufData[MAX_MSGLEN + 1];
+	netQueuedPacket_t	rec;
+	unsigned			head, tail, start;
+	netadr_t			from;
+	msg_t				netmsg;
+	int					dropped;
+
+	while ( netThread ) {
+		tail = netQueueTail.load( std::memory_order_relaxed );
+		head = netQueueHead.load( std::memory_order_acquire );
+		if ( head == tail ) {
+			break;
+		}
+
+		start = tail & ( NET_QUEUE_SIZE - 1 );
+		if ( NET_QUEUE_SIZE - start < sizeof( netQueuedPacket_t ) || ( (netQueuedPacket_t *)( netQueue + start ) )->length < 0 ) {
+			netQueueTail.store( tail + NET_QUEUE_SIZE - start, std::memory_order_release );
+			continue;
+		}
+
+		// copy it out and free the space first, the packet is decompressed in place and may restart networking
+		rec = *(netQueuedPacket_t *)( netQueue + start );
+		MSG_Init( &netmsg, bufData, sizeof( bufData ) );
+		memcpy( bufData, netQueue + start + sizeof( rec ), rec.length );
+		netQueueTail.store( tail + NET_QueueRecordSize( rec.length ), std::memory_order_release );
+
+		if ( NET_AcceptPacket( rec.from, rec.fromlen, rec.length, &from, &netmsg ) ) {
+			netmsg.time = rec.time;
+			NET_DispatchPacket( &from, &netmsg );
+		}
+	}
+
+	if ( ( dropped = netQueueDropped.exchange( 0 ) ) != 0 ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: network queue full, dropped %i packets\n", dropped );
+	}
+}
+
+#if NET_BATCH_IO
+// Drains each ready socket with recvmmsg, a batch at a time
+static void NET_EventBatch(fd_set *fdr)
+{
+	int i, n, ret, now;
+	netadr_t from;
+	msg_t netmsg;
+
+	for ( n = 0 ; n < numNetSockets ; n++ )
+	{
+		SOCKET s = netSockets[n].fd;
+
+		if ( !FD_ISSET(s, fdr) ) {
+			continue;
+		}
+
+		do
+		{
+			for ( i = 0 ; i < NET_BATCH_PACKETS ; i++ ) {
+				netRecv.iov[i].iov_base = netRecv.data[i];
+				netRecv.iov[i].iov_len = sizeof( netRecv.data[i] );
+				netRecv.hdrs[i].msg_hdr.msg_name = &netRecv.from[i];
+				netRecv.hdrs[i].msg_hdr.msg_namelen = sizeof( netRecv.from[i] );
+				netRecv.hdrs[i].msg_hdr.msg_iov = &netRecv.iov[i];
+				netRecv.hdrs[i].msg_hdr.msg_iovlen = 1;
+				netRecv.hdrs[i].msg_hdr.msg_control = nullptr;
+				netRecv.hdrs[i].msg_hdr.msg_controllen = 0;
+				netRecv.hdrs[i].msg_hdr.msg_flags = 0;
+			}
+
+			ret = recvmmsg( s, netRecv.hdrs, NET_BATCH_PACKETS, MSG_DONTWAIT, nullptr );
+			if ( ret == SOCKET_ERROR ) {
+				int err = socketError;
+				if( err != EAGAIN && err != ECONNRESET )
+					Com_Printf( "NET_GetPacket: %s\n", NET_ErrorString() );
+				break;
+			}
+
+			now = Sys_Milliseconds();
+			for ( i = 0 ; i < ret ; i++ ) {
+				MSG_Init( &netmsg, netRecv.data[i], sizeof( netRecv.data[i] ) );
+				netmsg.time = now;
+				if ( NET_AcceptPacket( netRecv.from[i], netRecv.hdrs[i].msg_hdr.msg_namelen, netRecv.hdrs[i].msg_len, &from, &netmsg ) ) {
+					NET_DispatchPacket( &from, &netmsg );
+				}
+			}
+
+		// a packet can restart networking and close the sockets under us
+		} while ( ret == NET_BATCH_PACKETS && n < numNetSockets && netSockets[n].fd == s );
+	}
+}
+#endif
+
 // Called from NET_Sleep which uses select() to determine which sockets have seen action.
 void NET_Event(fd_set *fdr)
 {
@@ -881,23 +1436,21 @@ void NET_Event(fd_set *fdr)
 	netadr_t from;
 	msg_t netmsg;
 
+#if NET_BATCH_IO
+	if ( net_batch->integer ) {
+		NET_EventBatch(fdr);
+		return;
+	}
+#endif
+
 	while(1)
 	{
 		MSG_Init(&netmsg, bufData, sizeof(bufData));
 
 		if(NET_GetPacket(&from, &netmsg, fdr))
 		{
-			if(net_dropsim->value > 0.0f && net_dropsim->value <= 100.0f)
-			{
-				// com_dropsim->value percent of incoming packets get dropped.
-				if(rand() < (int) (((double) RAND_MAX) / 100.0 * (double) net_dropsim->value))
-					continue;          // drop this packet
-			}
-
-			if(sv_running->integer)
-				Com_RunAndTimeServerPacket(&from, &netmsg);
-			else
-				CL_PacketEvent(from, &netmsg);
+			netmsg.time = Sys_Milliseconds();
+			NET_DispatchPacket(&from, &netmsg);
 		}
 		else
 			break;
@@ -914,10 +1467,21 @@ void NET_Sleep( int msec ) {
 	if (msec < 0)
 		msec = 0;
 
+	// don't hold packets back over the sleep if a batch was left open by an error
+	NET_EndPacketBatch();
+
+	// the receive thread is already watching the sockets
+	if ( netThread ) {
+		NET_WaitForQueue( msec );
+		NET_DrainQueue();
+		return;
+	}
+
 	FD_ZERO(&fdset);
-	if (ip_socket != INVALID_SOCKET) {
-		FD_SET(ip_socket, &fdset); // network socket
-		highestfd = ip_socket;
+	for ( int i = 0 ; i < numNetSockets ; i++ ) {
+		FD_SET(netSockets[i].fd, &fdset); // network sockets
+		if ( highestfd == INVALID_SOCKET || netSockets[i].fd > highestfd )
+			highestfd = netSockets[i].fd;
 	}
 
 #ifdef _WIN32
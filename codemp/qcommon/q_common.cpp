@@ -38,6 +38,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include <windows.h>
 #endif
 
+#include <mutex>
+
 FILE *debuglogfile;
 fileHandle_t com_logfile;
 fileHandle_t	com_journalFile;			// events are written here
@@ -88,11 +90,14 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 	va_list		argptr;
 	char		msg[MAXPRINTMSG];
 	static bool opening_qconsole = false;
+	static std::recursive_mutex printMutex; // job threads may print while the main thread works alongside them
 
 	va_start (argptr,fmt);
 	Q_vsnprintf (msg, sizeof(msg), fmt, argptr);
 	va_end (argptr);
 
+	std::lock_guard<std::recursive_mutex> lock( printMutex );
+
 	if ( rd_buffer ) {
 		if ((strlen (msg) + strlen(rd_buffer)) > (size_t)(rd_buffersize - 1)) {
 			rd_flush(rd_buffer);
@@ -982,6 +987,7 @@ void Com_Init( char *commandLine ) {
 #endif
 		Cmd_AddCommand ("writeconfig", Com_WriteConfig_f, "Write the configuration to file" );
 		Cmd_SetCommandCompletionFunc( "writeconfig", Cmd_CompleteCfgName );
+		Cmd_AddCommand ("cm_bench", CM_Bench_f, "Time collision queries against a map and check them against a golden file" );
 
 		Com_ExecuteCfg();
 
@@ -1272,8 +1278,9 @@ void Com_Frame( void ) {
 
 		if ( com_showtrace->integer ) {
 
-			extern	int c_traces, c_brush_traces, c_patch_traces;
-			extern	int	c_pointcontents;
+			// counted per thread, traces run on job threads are not included
+			extern	thread_local int c_traces, c_brush_traces, c_patch_traces;
+			extern	thread_local int c_pointcontents;
 
 			Com_Printf ("%4i traces  (%ib %ip) %4i points\n", c_traces,
 				c_brush_traces, c_patch_traces, c_pointcontents);
@@ -1311,6 +1318,8 @@ void Com_Frame( void ) {
 
 void Com_Shutdown (void)
 {
+	Com_ShutdownJobs();
+
 	CM_ClearMap();
 
 	if (com_logfile) {
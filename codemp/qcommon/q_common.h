@@ -114,7 +114,10 @@ handles packet fragmentation and out of order / duplicate suppression
 #define MASTER_SERVER_NAME       "masterjk3.ravensoft.com"
 #define MAX_DOWNLOAD_BLKSIZE     2048 // 2048 byte block chunks
 #define MAX_DOWNLOAD_WINDOW      8 // max of eight download frames
+#define MAX_NET_SOCKETS          8 // per address family
 #define NET_ENABLEV4             0x01
+#define NET_ENABLEV6             0x02
+#define NET_PRIOV6               0x04 // resolve names to ipv6 addresses before ipv4 ones
 #define NUM_ID_PAKS              9
 #define SV_DECODE_START          12
 
@@ -123,6 +126,7 @@ handles packet fragmentation and out of order / duplicate suppression
 typedef void (*xcommand_t)( void );
 typedef void (*completionCallback_t)( const char *s );
 typedef void (*completionFunc_t)( char *args, int argNum );
+typedef void (*jobFunc_t)( int index, void *data );
 
 
 
@@ -183,6 +187,7 @@ struct msg_t {
 	int   cursize;
 	int   readcount;
 	int   bit; // for bitwise reads and writes
+	int   time; // Sys_Milliseconds when the packet arrived, 0 if it didn't come off the network
 };
 
 struct netchan_t {
@@ -346,14 +351,17 @@ void            Com_Init                      ( char *commandLine );
 void            Com_InitHunkMemory            ( void );
 void            Com_InitZoneMemory            ( void );
 void            Com_InitZoneMemoryVars        ( void );
+int             Com_JobThreads                ( void );
 char           *Com_MD5File                   ( const char *filename, int length, const char *prefix, int prefix_len );
 int             Com_Milliseconds              ( void );	// will be journaled properly
 void QDECL      Com_OPrintf                   ( const char *fmt, ... ); // Outputs to the VC / Windows Debug window ( only in debug compile)
+void            Com_ParallelFor               ( int count, jobFunc_t func, void *data );
 void NORETURN   Com_Quit_f                    ( void );
 int             Com_RealTime                  ( qtime_t *qtime );
 void            Com_RunAndTimeServerPacket    ( netadr_t *evFrom, msg_t *buf );
 bool            Com_SafeMode                  ( void );
 void            Com_Shutdown                  ( void );
+void            Com_ShutdownJobs              ( void );
 void            Com_ShutdownHunkMemory        ( void );
 void            Com_ShutdownZoneMemory        ( void );
 void            Com_StartupVariable           ( const char *match );
@@ -383,6 +391,7 @@ void            FS_Flush                      ( fileHandle_t f );
 int             FS_FOpenFileByMode            ( const char *qpath, fileHandle_t *f, fsMode_e mode );
 long            FS_FOpenFileRead              ( const char *qpath, fileHandle_t *file, bool uniqueFILE );
 fileHandle_t    FS_FOpenFileWrite             ( const char *qpath, bool safe = true );
+fileHandle_t    FS_FOpenFileWriteAsync        ( const char *qpath );
 void            FS_ForceFlush                 ( fileHandle_t f );
 void            FS_FreeFile                   ( void *buffer );
 void            FS_FreeFileList               ( char **fileList );
@@ -415,6 +424,7 @@ int             FS_Seek                       ( fileHandle_t f, long offset, int
 void            FS_Shutdown                   ( bool closemfp );
 fileHandle_t    FS_SV_FOpenFileWrite          ( const char *filename );
 int             FS_SV_FOpenFileRead           ( const char *filename, fileHandle_t *fp );
+sysSharedFile_t *FS_SV_OpenSharedFile         ( const char *filename, int *length );
 void            FS_SV_Rename                  ( const char *from, const char *to, bool safe );
 void            FS_UpdateGamedir              ( void );
 int             FS_Write                      ( const void *buffer, int len, fileHandle_t f );
@@ -428,6 +438,7 @@ void            Hunk_ClearToMark              ( void );
 void            Hunk_FreeTempMemory           ( void *buf );
 void            Hunk_Log                      ( void );
 int             Hunk_MemoryRemaining          ( void );
+void            Hunk_ReleaseMark              ( void );
 void            Hunk_SetMark                  ( void );
 void            Hunk_Trash                    ( void );
 void            Info_Print                    ( const char *s );
@@ -461,15 +472,18 @@ void            MSG_WriteChar                 ( msg_t *sb, int c );
 void            MSG_WriteData                 ( msg_t *buf, const void *data, int length );
 void            MSG_WriteDeltaEntity          ( msg_t *msg, entityState_t *from, entityState_t *to, bool force );
 void            MSG_WriteDeltaUsercmdKey      ( msg_t *msg, int key, usercmd_t *from, usercmd_t *to );
+void            MSG_WriteEncodedBits          ( msg_t *msg, const byte *data, int bits );
 void            MSG_WriteFloat                ( msg_t *sb, float f );
 void            MSG_WriteLong                 ( msg_t *sb, int c );
 void            MSG_WriteShort                ( msg_t *sb, int c );
 void            MSG_WriteString               ( msg_t *sb, const char *s );
 const char     *NET_AdrToString               ( netadr_t a );
+void            NET_BeginPacketBatch          ( void );
 bool            NET_CompareAdr                ( netadr_t a, netadr_t b );
 bool            NET_CompareBaseAdr            ( netadr_t a, netadr_t b );
 bool            NET_CompareBaseAdrMask        ( netadr_t a, netadr_t b, int netmask );
 void            NET_Config                    ( bool enableNetworking );
+void            NET_EndPacketBatch            ( void );
 bool            NET_GetLoopPacket             ( netsrc_e sock, netadr_t *net_from, msg_t *net_message );
 void            NET_Init                      ( void );
 bool            NET_IsLocalAddress            ( netadr_t adr );
@@ -47,6 +47,12 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 	#include <unistd.h>
 #endif
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 /*
 QUAKE3 FILESYSTEM
 
@@ -230,8 +236,11 @@ struct qfile_ut {
 	bool	unique;
 };
 
+struct fsAsyncFile_t;
+
 struct fileHandleData_t {
 	qfile_ut	handleFiles;
+	fsAsyncFile_t	*handleAsync;	// writes are queued for the writer thread, which owns the FILE
 	bool	handleSync;
 	int			fileSize;
 	int			zipFilePos;
@@ -242,6 +251,8 @@ struct fileHandleData_t {
 
 static fileHandleData_t	fsh[MAX_FILE_HANDLES];
 
+static void FS_WaitAsyncWrites( const char *ospath );
+
 // TTimo - https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=540
 // wether we did a reorder on the current search path when joining the server
 static bool fs_reordered = false;
@@ -350,6 +361,9 @@ static FILE	*FS_FileForHandle( fileHandle_t f ) {
 	if (fsh[f].zipFile == true) {
 		Com_Error( ERR_DROP, "FS_FileForHandle: can't get FILE on zip file" );
 	}
+	if ( fsh[f].handleAsync ) {
+		Com_Error( ERR_DROP, "FS_FileForHandle: can't get FILE on async file" );
+	}
 	if ( ! fsh[f].handleFiles.file.o ) {
 		Com_Error( ERR_DROP, "FS_FileForHandle: nullptr" );
 	}
@@ -668,6 +682,7 @@ fileHandle_t FS_SV_FOpenFileWrite( const char *filename ) {
 	}
 
 	Com_DPrintf( "writing to: %s\n", ospath );
+	FS_WaitAsyncWrites( ospath );
 	fsh[f].handleFiles.file.o = fopen( ospath, "wb" );
 
 	Q_strncpyz( fsh[f].name, filename, sizeof( fsh[f].name ) );
@@ -757,6 +772,35 @@ int FS_SV_FOpenFileRead( const char *filename, fileHandle_t *fp ) {
 	return 0;
 }
 
+// Opens a file outside the search path for reading in blocks, looking in the same places as FS_SV_FOpenFileRead
+// Returns nullptr if it isn't found
+sysSharedFile_t *FS_SV_OpenSharedFile( const char *filename, int *length ) {
+	const char		*paths[] = { fs_homepath->string, fs_basepath->string, fs_cdpath->string };
+	char			*ospath;
+	sysSharedFile_t	*file;
+	int				i;
+
+	FS_AssertInitialised();
+
+	for ( i = 0 ; i < (int)ARRAY_LEN( paths ) ; i++ ) {
+		if ( !paths[i][0] ) {
+			continue;
+		}
+		ospath = FS_BuildOSPath( paths[i], filename, "" );
+		ospath[strlen(ospath)-1] = '\0';
+
+		if ( fs_debug->integer ) {
+			Com_Printf( "FS_SV_OpenSharedFile: %s\n", ospath );
+		}
+
+		file = Sys_OpenSharedFile( ospath, length );
+		if ( file ) {
+			return file;
+		}
+	}
+	return nullptr;
+}
+
 void FS_SV_Rename( const char *from, const char *to, bool safe ) {
 	char			*from_ospath, *to_ospath;
 
@@ -816,9 +860,18 @@ void FS_Rename( const char *from, const char *to ) {
 //	* file in pak3 archive, opened with "unique" flag: This file did not use the system minizip handle to the pak3 file, but its own dedicated one.
 //		The dedicated handle is closed with unzClose.
 // note: you can't just fclose from another DLL, due to MS libc issues
+static void FS_CloseAsyncFile( fsAsyncFile_t *af );
+
 void FS_FCloseFile( fileHandle_t f ) {
 	FS_AssertInitialised();
 
+	if ( fsh[f].handleAsync ) {
+		// the writer thread closes the file once everything queued is on disk
+		FS_CloseAsyncFile( fsh[f].handleAsync );
+		Com_Memset( &fsh[f], 0, sizeof( fsh[f] ) );
+		return;
+	}
+
 	if (fsh[f].zipFile == true) {
 		unzCloseCurrentFile( fsh[f].handleFiles.file.z );
 		if ( fsh[f].handleFiles.unique ) {
@@ -862,6 +915,7 @@ fileHandle_t FS_FOpenFileWrite( const char *filename, bool safe ) {
 	// enabling the following line causes a recursive function call loop
 	// when running with +set logfile 1 +set developer 1
 	//Com_DPrintf( "writing to: %s\n", ospath );
+	FS_WaitAsyncWrites( ospath );
 	fsh[f].handleFiles.file.o = fopen( ospath, "wb" );
 
 	Q_strncpyz( fsh[f].name, filename, sizeof( fsh[f].name ) );
@@ -899,6 +953,7 @@ fileHandle_t FS_FOpenFileAppend( const char *filename ) {
 		return 0;
 	}
 
+	FS_WaitAsyncWrites( ospath );
 	fsh[f].handleFiles.file.o = fopen( ospath, "ab" );
 	fsh[f].handleSync = false;
 	if (!fsh[f].handleFiles.file.o) {
@@ -1436,6 +1491,249 @@ int FS_Read( void *buffer, int len, fileHandle_t f ) {
 	}
 }
 
+// Async writes
+// Files opened with FS_FOpenFileWriteAsync only copy into a ring buffer on the calling thread. One writer
+// thread drains every ring with large fwrites, so a slow disk can't stall the frame. Each ring has a
+// single producer and a single consumer, so the ring itself needs no lock.
+
+#define FS_ASYNC_RING			(1<<20)			// bytes queued per file
+#define FS_ASYNC_WAKE			(FS_ASYNC_RING/4)	// wake the writer early once this much is queued
+#define FS_ASYNC_INTERVAL		100				// msec between writer passes otherwise
+
+struct fsAsyncFile_t {
+	FILE					*file;
+	char					name[MAX_ZPATH];
+	char					ospath[MAX_OSPATH];	// to hold back anyone opening the same file again
+	byte					*ring;
+	std::atomic<unsigned>	head;		// bytes queued by the owner
+	std::atomic<unsigned>	tail;		// bytes written by the writer thread
+	std::atomic<bool>		closed;
+	std::atomic<bool>		failed;
+	bool					warnedStall;	// owner side only
+	bool					warnedFailed;
+	fsAsyncFile_t			*next;
+};
+
+static std::thread				*fs_asyncThread;
+static std::mutex				fs_asyncMutex;		// guards the file list
+static std::condition_variable	fs_asyncWake;
+static std::condition_variable	fs_asyncDrained;
+static std::atomic<bool>		fs_asyncPending;
+static bool						fs_asyncStop;		// the thread quits once every file is closed
+static fsAsyncFile_t			*fs_asyncFiles;
+
+// Writes out everything queued, a wrapped ring takes two fwrites. Returns false if nothing was queued.
+static bool FS_DrainAsyncFile( fsAsyncFile_t *af ) {
+	unsigned	head, tail, start, count;
+
+	tail = af->tail.load( std::memory_order_relaxed );
+	head = af->head.load( std::memory_order_acquire );
+	if ( head == tail ) {
+		return false;
+	}
+
+	while ( tail != head ) {
+		start = tail & ( FS_ASYNC_RING - 1 );
+		count = head - tail;
+		if ( count > FS_ASYNC_RING - start ) {
+			count = FS_ASYNC_RING - start;
+		}
+		// keep consuming after a failure so the owner never waits on a dead disk
+		if ( !af->failed && fwrite( af->ring + start, 1, count, af->file ) != count ) {
+			af->failed = true;
+		}
+		tail += count;
+		af->tail.store( tail, std::memory_order_release );
+	}
+
+	return true;
+}
+
+static void FS_AsyncWriterThread( void ) {
+	fsAsyncFile_t	*af, *first, **prev;
+	bool			wrote;
+
+	for ( ;; ) {
+		{
+			std::unique_lock<std::mutex> lock( fs_asyncMutex );
+			fs_asyncWake.wait_for( lock, std::chrono::milliseconds( FS_ASYNC_INTERVAL ), [] { return fs_asyncPending.load() || fs_asyncStop; } );
+			fs_asyncPending = false;
+			first = fs_asyncFiles;
+		}
+
+		// new files are only pushed on the front and only this thread unlinks, so the rest of the list holds still
+		do {
+			wrote = false;
+			for ( af = first ; af ; af = af->next ) {
+				wrote |= FS_DrainAsyncFile( af );
+			}
+		} while ( wrote );
+
+		{
+			std::lock_guard<std::mutex> lock( fs_asyncMutex );
+			for ( prev = &fs_asyncFiles ; ( af = *prev ) != nullptr ; ) {
+				if ( !af->closed ) {
+					fflush( af->file );
+					prev = &af->next;
+					continue;
+				}
+				// closed is set after the last write, so this drain empties it for good
+				FS_DrainAsyncFile( af );
+				fclose( af->file );
+				*prev = af->next;
+				delete[] af->ring;
+				delete af;
+			}
+			if ( fs_asyncStop && !fs_asyncFiles ) {
+				break;
+			}
+		}
+		fs_asyncDrained.notify_all();
+	}
+	fs_asyncDrained.notify_all();
+}
+
+static void FS_QueueAsyncWrite( fsAsyncFile_t *af, const byte *buf, int len ) {
+	unsigned	head, tail, start, count;
+
+	while ( len > 0 ) {
+		head = af->head.load( std::memory_order_relaxed );
+		tail = af->tail.load( std::memory_order_acquire );
+
+		if ( head - tail == FS_ASYNC_RING ) {
+			// the disk is more than a whole ring behind, nothing left to do but wait for it
+			if ( !af->warnedStall ) {
+				Com_Printf( S_COLOR_YELLOW "WARNING: writes to %s are waiting on the disk\n", af->name );
+				af->warnedStall = true;
+			}
+			fs_asyncPending = true;
+			fs_asyncWake.notify_one();
+			Sys_Sleep( 1 );
+			continue;
+		}
+
+		start = head & ( FS_ASYNC_RING - 1 );
+		count = FS_ASYNC_RING - ( head - tail );
+		if ( count > FS_ASYNC_RING - start ) {
+			count = FS_ASYNC_RING - start;
+		}
+		if ( count > (unsigned)len ) {
+			count = len;
+		}
+		memcpy( af->ring + start, buf, count );
+		af->head.store( head + count, std::memory_order_release );
+		buf += count;
+		len -= count;
+	}
+
+	if ( af->head.load( std::memory_order_relaxed ) - af->tail.load( std::memory_order_relaxed ) >= FS_ASYNC_WAKE ) {
+		fs_asyncPending = true;
+		fs_asyncWake.notify_one();
+	}
+}
+
+static void FS_CloseAsyncFile( fsAsyncFile_t *af ) {
+	af->closed = true;
+	fs_asyncPending = true;
+	fs_asyncWake.notify_one();
+}
+
+// Waits until everything queued so far for ospath, or for every file if it's nullptr, is on disk
+// and the closed files are closed for real
+static void FS_WaitAsyncWrites( const char *ospath ) {
+	fsAsyncFile_t *af;
+
+	if ( !fs_asyncThread ) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock( fs_asyncMutex );
+	for ( ;; ) {
+		for ( af = fs_asyncFiles ; af ; af = af->next ) {
+			if ( ospath && Q_stricmp( af->ospath, ospath ) ) {
+				continue;
+			}
+			if ( af->closed || af->head != af->tail ) {
+				break;
+			}
+		}
+		if ( !af ) {
+			return;
+		}
+		fs_asyncPending = true;
+		fs_asyncWake.notify_one();
+		fs_asyncDrained.wait_for( lock, std::chrono::milliseconds( FS_ASYNC_INTERVAL ) );
+	}
+}
+
+// Used when the filesystem goes down. Everything queued goes to disk, and the thread is stopped once no file
+// is left open; with quit set the files still open are closed first.
+static void FS_ShutdownAsyncWrites( bool quit ) {
+	int i;
+
+	if ( !fs_asyncThread ) {
+		return;
+	}
+
+	if ( quit ) {
+		for ( i = 1 ; i < MAX_FILE_HANDLES ; i++ ) {
+			if ( fsh[i].handleAsync ) {
+				FS_FCloseFile( i );
+			}
+		}
+	}
+
+	FS_WaitAsyncWrites( nullptr );
+
+	{
+		std::lock_guard<std::mutex> lock( fs_asyncMutex );
+		if ( fs_asyncFiles ) {
+			return;
+		}
+		fs_asyncStop = true;
+	}
+	fs_asyncWake.notify_one();
+	fs_asyncThread->join();
+	delete fs_asyncThread;
+	fs_asyncThread = nullptr;
+	fs_asyncStop = false;
+}
+
+// Same as FS_FOpenFileWrite, for files that are only ever written to and closed
+fileHandle_t FS_FOpenFileWriteAsync( const char *filename ) {
+	fileHandle_t	f;
+	fsAsyncFile_t	*af;
+
+	f = FS_FOpenFileWrite( filename );
+	if ( !f ) {
+		return 0;
+	}
+
+	af = new fsAsyncFile_t;
+	af->file = fsh[f].handleFiles.file.o;
+	Q_strncpyz( af->name, filename, sizeof( af->name ) );
+	Q_strncpyz( af->ospath, FS_BuildOSPath( fs_homepath->string, fs_gamedir, filename ), sizeof( af->ospath ) );
+	af->ring = new byte[FS_ASYNC_RING];
+	af->head = 0;
+	af->tail = 0;
+	af->closed = false;
+	af->failed = false;
+	af->warnedStall = false;
+	af->warnedFailed = false;
+
+	{
+		std::lock_guard<std::mutex> lock( fs_asyncMutex );
+		af->next = fs_asyncFiles;
+		fs_asyncFiles = af;
+		if ( !fs_asyncThread ) {
+			fs_asyncThread = new std::thread( FS_AsyncWriterThread );
+		}
+	}
+
+	fsh[f].handleAsync = af;
+	return f;
+}
+
 // Properly handles partial writes
 int FS_Write( const void *buffer, int len, fileHandle_t h ) {
 	int		block, remaining;
@@ -1450,6 +1748,16 @@ int FS_Write( const void *buffer, int len, fileHandle_t h ) {
 		return 0;
 	}
 
+	if ( fsh[h].handleAsync ) {
+		fsAsyncFile_t *af = fsh[h].handleAsync;
+		if ( af->failed && !af->warnedFailed ) {
+			Com_Printf( "FS_Write: writing %s failed\n", af->name );
+			af->warnedFailed = true;
+		}
+		FS_QueueAsyncWrite( af, (const byte *)buffer, len );
+		return len;
+	}
+
 	f = FS_FileForHandle(h);
 	buf = (byte *)buffer;
 
@@ -2827,6 +3135,9 @@ void FS_Shutdown( bool closemfp ) {
 		}
 	}
 
+	// anything still queued for the writer thread goes to disk before the paths are gone
+	FS_ShutdownAsyncWrites( closemfp );
+
 	// free everything
 	for ( p = fs_searchpaths ; p ; p = next ) {
 		next = p->next;
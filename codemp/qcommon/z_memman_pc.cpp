@@ -40,16 +40,26 @@ const static char *psTagStrings[TAG_COUNT+1]=	// +1 because TAG_COUNT will itsel
 static void Z_Details_f(void);
 
 // This handles zone memory allocation.
-// It is a wrapper around malloc with a tag id and a magic number at the start
+// Every block gets a tag id and a magic number at the start.
+// Small blocks are carved out of slabs that belong to their tag, so freeing a tag drops its slabs whole,
+// bigger ones are a malloc each and are linked into the list of their tag.
 
 #define ZONE_MAGIC			0x21436587
+#define ZONE_FREE_MAGIC		0x78563412	// a slab cell that holds no block
+
+#define ZONE_SLAB_SIZE		(64*1024)
+#define ZONE_NUM_CLASSES	6
+#define ZONE_MAX_SLAB_BLOCK	512			// bigger blocks are malloc'd on their own
+
+static const int zoneClassSizes[ZONE_NUM_CLASSES] = { 16, 32, 64, 128, 256, 512 };
 
 struct zoneHeader_t {
 	int           iMagic;
 	memtag_t      eTag;
 	int           iSize;
-	zoneHeader_t *pNext;
-	zoneHeader_t *pPrev;
+	int           iSlab;	// index of the slab holding the block, 0 if it was malloc'd on its own
+	zoneHeader_t *pNext;	// in the list of its tag, or the free cells of its slab
+	zoneHeader_t *pPrev;	// nullptr for a block in one of its own tag's slabs
 };
 
 struct zoneTail_t {
@@ -78,47 +88,111 @@ struct zoneStats_t {
 
 };
 
+struct zoneSlab_t {
+	zoneSlab_t   *pNext;		// in a list of its arena, or the orphan list
+	zoneSlab_t   *pPrev;
+	memtag_t      eTag;			// the arena the slab belongs to
+	int           iClass;
+	int           iIndex;		// in TheZone.ppSlabs
+	int           iCellSize;
+	int           iCapacity;
+	int           iNumCells;	// cells handed out so far, the ones past this have never been used
+	int           iUsed;
+	int           iForeign;		// blocks in here that were morphed to another tag
+	bool          bOrphan;		// the arena was freed while foreign blocks were still in here
+	zoneHeader_t *pFree;
+};
+
+#define ZONE_SLAB_DATA	((int)((sizeof(zoneSlab_t) + 15) & ~15))
+
+struct zoneArena_t {
+	zoneHeader_t	Header;							// blocks not in the arena's own slabs
+	zoneSlab_t		*pPartial[ZONE_NUM_CLASSES];	// slabs with free cells
+	zoneSlab_t		*pFull[ZONE_NUM_CLASSES];
+};
+
 struct zone_t {
 	zoneStats_t				Stats;
-	zoneHeader_t			Header;
+	zoneArena_t				Arenas[TAG_COUNT];
+	zoneSlab_t				*pOrphans;
+	zoneSlab_t				**ppSlabs;	// slot 0 is never used
+	int						iSlabSlots;
+	int						iNumSlabs;
+	int						iSlabSearch;
 };
 
 zone_t	TheZone = {};
 
-// Scans through the linked list of mallocs and makes sure no data has been overwritten
-void Z_Validate(void)
+static inline zoneHeader_t *Zone_SlabCell(zoneSlab_t *pSlab, int iCell)
 {
-	if(!com_validateZone || !com_validateZone->integer)
+	return (zoneHeader_t *) ( (byte *)pSlab + ZONE_SLAB_DATA + iCell * pSlab->iCellSize );
+}
+
+static void Zone_ValidateBlock(zoneHeader_t *pMemory)
+{
+	#ifdef DETAILED_ZONE_DEBUG_CODE
+	// this won't happen here, but wtf?
+	int& iAllocCount = mapAllocatedZones[pMemory];
+	if (iAllocCount <= 0)
 	{
+		Com_Error(ERR_FATAL, "Z_Validate(): Bad block allocation count!");
 		return;
 	}
+	#endif
 
-	zoneHeader_t *pMemory = TheZone.Header.pNext;
-	while (pMemory)
+	if(pMemory->iMagic != ZONE_MAGIC)
 	{
-		#ifdef DETAILED_ZONE_DEBUG_CODE
-		// this won't happen here, but wtf?
-		int& iAllocCount = mapAllocatedZones[pMemory];
-		if (iAllocCount <= 0)
+		Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone header!");
+		return;
+	}
+
+	if (ZoneTailFromHeader(pMemory)->iMagic != ZONE_MAGIC)
+	{
+		Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone tail!");
+		return;
+	}
+}
+
+static void Zone_ValidateSlab(zoneSlab_t *pSlab)
+{
+	for (int i = 0; i < pSlab->iNumCells; i++)
+	{
+		zoneHeader_t *pCell = Zone_SlabCell(pSlab, i);
+		if (pCell->iMagic != ZONE_FREE_MAGIC)
 		{
-			Com_Error(ERR_FATAL, "Z_Validate(): Bad block allocation count!");
-			return;
+			Zone_ValidateBlock(pCell);
 		}
-		#endif
+	}
+}
 
-		if(pMemory->iMagic != ZONE_MAGIC)
+// Scans through all the blocks and makes sure no data has been overwritten
+void Z_Validate(void)
+{
+	if(!com_validateZone || !com_validateZone->integer)
+	{
+		return;
+	}
+
+	for (int i = 0; i < TAG_COUNT; i++)
+	{
+		zoneArena_t *pArena = &TheZone.Arenas[i];
+
+		for (zoneHeader_t *pMemory = pArena->Header.pNext; pMemory; pMemory = pMemory->pNext)
 		{
-			Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone header!");
-			return;
+			Zone_ValidateBlock(pMemory);
 		}
 
-		if (ZoneTailFromHeader(pMemory)->iMagic != ZONE_MAGIC)
+		for (int iClass = 0; iClass < ZONE_NUM_CLASSES; iClass++)
 		{
-			Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone tail!");
-			return;
+			for (zoneSlab_t *pSlab = pArena->pPartial[iClass]; pSlab; pSlab = pSlab->pNext)
+			{
+				Zone_ValidateSlab(pSlab);
+			}
+			for (zoneSlab_t *pSlab = pArena->pFull[iClass]; pSlab; pSlab = pSlab->pNext)
+			{
+				Zone_ValidateSlab(pSlab);
+			}
 		}
-
-		pMemory = pMemory->pNext;
 	}
 }
 
@@ -139,40 +213,31 @@ struct StaticMem_t {
 #pragma pack(pop)
 
 constexpr StaticZeroMem_t gZeroMalloc  =
-	{ {ZONE_MAGIC, TAG_STATIC,0,nullptr,nullptr},{ZONE_MAGIC}};
+	{ {ZONE_MAGIC, TAG_STATIC,0,0,nullptr,nullptr},{ZONE_MAGIC}};
 constexpr StaticMem_t gEmptyString =
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'\0','\0'},{ZONE_MAGIC}};
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'\0','\0'},{ZONE_MAGIC}};
 constexpr StaticMem_t gNumberString[] = {
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'0','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'1','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'2','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'3','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'4','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'5','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'6','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'7','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'8','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,nullptr,nullptr},{'9','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'0','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'1','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'2','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'3','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'4','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'5','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'6','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'7','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'8','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,0,nullptr,nullptr},{'9','\0'},{ZONE_MAGIC}},
 };
 
 bool gbMemFreeupOccured = false;
-void *Z_Malloc(int iSize, memtag_t eTag, bool bZeroit /* = false */, int iUnusedAlign /* = 4 */)
-{
-	gbMemFreeupOccured = false;
-
-	if (iSize == 0)
-	{
-		zoneHeader_t *pMemory = (zoneHeader_t *) &gZeroMalloc;
-		return &pMemory[1];
-	}
-
-	// Add in tracking info
-
-	int iRealSize = (iSize + sizeof(zoneHeader_t) + sizeof(zoneTail_t));
 
+// Gets memory from the system, dumping caches until it fits if need be.
+// iSize and eTag are only used to report a failure.
+static void *Zone_SysAlloc(int iRealSize, bool bZeroit, int iSize, memtag_t eTag)
+{
 	// Allocate a chunk...
 
-	zoneHeader_t *pMemory = nullptr;
+	void *pMemory = nullptr;
 	while (pMemory == nullptr)
 	{
 		if (gbMemFreeupOccured)
@@ -181,9 +246,9 @@ void *Z_Malloc(int iSize, memtag_t eTag, bool bZeroit /* = false */, int iUnused
 		}
 
 		if (bZeroit) {
-			pMemory = (zoneHeader_t *) calloc ( iRealSize, 1 );
+			pMemory = calloc ( iRealSize, 1 );
 		} else {
-			pMemory = (zoneHeader_t *) malloc ( iRealSize );
+			pMemory = malloc ( iRealSize );
 		}
 		if (!pMemory)
 		{
@@ -261,17 +326,238 @@ void *Z_Malloc(int iSize, memtag_t eTag, bool bZeroit /* = false */, int iUnused
 		}
 	}
 
-	// Link in
-	pMemory->iMagic	= ZONE_MAGIC;
-	pMemory->eTag	= eTag;
-	pMemory->iSize	= iSize;
-	pMemory->pNext  = TheZone.Header.pNext;
-	TheZone.Header.pNext = pMemory;
+	return pMemory;
+}
+
+static int Zone_SizeClass(int iSize)
+{
+	if (iSize > ZONE_MAX_SLAB_BLOCK)
+	{
+		return -1;
+	}
+
+	int iClass = 0;
+	while (zoneClassSizes[iClass] < iSize)
+	{
+		iClass++;
+	}
+	return iClass;
+}
+
+static void Zone_LinkSlab(zoneSlab_t **ppHead, zoneSlab_t *pSlab)
+{
+	pSlab->pPrev = nullptr;
+	pSlab->pNext = *ppHead;
+	if (pSlab->pNext)
+	{
+		pSlab->pNext->pPrev = pSlab;
+	}
+	*ppHead = pSlab;
+}
+
+static void Zone_UnlinkSlab(zoneSlab_t **ppHead, zoneSlab_t *pSlab)
+{
+	if (pSlab->pPrev)
+	{
+		pSlab->pPrev->pNext = pSlab->pNext;
+	}
+	else
+	{
+		*ppHead = pSlab->pNext;
+	}
+	if (pSlab->pNext)
+	{
+		pSlab->pNext->pPrev = pSlab->pPrev;
+	}
+}
+
+static void Zone_LinkBlock(zoneHeader_t *pHeader, zoneHeader_t *pMemory)
+{
+	pMemory->pNext = pHeader->pNext;
+	pHeader->pNext = pMemory;
 	if (pMemory->pNext)
 	{
 		pMemory->pNext->pPrev = pMemory;
 	}
-	pMemory->pPrev = &TheZone.Header;
+	pMemory->pPrev = pHeader;
+}
+
+static void Zone_UnlinkBlock(zoneHeader_t *pMemory)
+{
+	// Sanity checks...
+
+	assert(pMemory->pPrev->pNext == pMemory);
+	assert(!pMemory->pNext || (pMemory->pNext->pPrev == pMemory));
+
+	pMemory->pPrev->pNext = pMemory->pNext;
+	if(pMemory->pNext)
+	{
+		pMemory->pNext->pPrev = pMemory->pPrev;
+	}
+	pMemory->pNext = pMemory->pPrev = nullptr;
+}
+
+static zoneSlab_t *Zone_NewSlab(memtag_t eTag, int iClass)
+{
+	zoneSlab_t *pSlab = (zoneSlab_t *) Zone_SysAlloc(ZONE_SLAB_SIZE, false, zoneClassSizes[iClass], eTag);
+
+	// find it a slot, growing the table when it's full
+	if (TheZone.iNumSlabs + 1 >= TheZone.iSlabSlots)
+	{
+		int iSlots = TheZone.iSlabSlots ? TheZone.iSlabSlots * 2 : 256;
+		zoneSlab_t **ppSlabs = (zoneSlab_t **) realloc(TheZone.ppSlabs, iSlots * sizeof(*ppSlabs));
+		if (!ppSlabs)
+		{
+			Com_Error(ERR_FATAL, "Zone_NewSlab(): Failed to grow the slab table to %d slots", iSlots);
+		}
+		memset(ppSlabs + TheZone.iSlabSlots, 0, (iSlots - TheZone.iSlabSlots) * sizeof(*ppSlabs));
+		TheZone.ppSlabs = ppSlabs;
+		TheZone.iSlabSlots = iSlots;
+	}
+	while (TheZone.iSlabSearch == 0 || TheZone.ppSlabs[TheZone.iSlabSearch])
+	{
+		TheZone.iSlabSearch = (TheZone.iSlabSearch + 1) % TheZone.iSlabSlots;
+	}
+
+	pSlab->eTag			= eTag;
+	pSlab->iClass		= iClass;
+	pSlab->iIndex		= TheZone.iSlabSearch;
+	pSlab->iCellSize	= (sizeof(zoneHeader_t) + zoneClassSizes[iClass] + sizeof(zoneTail_t) + 15) & ~15;
+	pSlab->iCapacity	= (ZONE_SLAB_SIZE - ZONE_SLAB_DATA) / pSlab->iCellSize;
+	pSlab->iNumCells	= 0;
+	pSlab->iUsed		= 0;
+	pSlab->iForeign		= 0;
+	pSlab->bOrphan		= false;
+	pSlab->pFree		= nullptr;
+
+	TheZone.ppSlabs[pSlab->iIndex] = pSlab;
+	TheZone.iNumSlabs++;
+
+	Zone_LinkSlab(&TheZone.Arenas[eTag].pPartial[iClass], pSlab);
+
+	return pSlab;
+}
+
+static void Zone_ReleaseSlab(zoneSlab_t *pSlab)
+{
+	#ifdef DETAILED_ZONE_DEBUG_CODE
+	for (int i = 0; i < pSlab->iNumCells; i++)
+	{
+		zoneHeader_t *pCell = Zone_SlabCell(pSlab, i);
+		if (pCell->iMagic == ZONE_MAGIC)
+		{
+			mapAllocatedZones[pCell]--;
+		}
+	}
+	#endif
+
+	TheZone.ppSlabs[pSlab->iIndex] = nullptr;
+	TheZone.iNumSlabs--;
+	free(pSlab);
+}
+
+static zoneHeader_t *Zone_SlabAlloc(memtag_t eTag, int iClass)
+{
+	zoneArena_t *pArena = &TheZone.Arenas[eTag];
+	zoneSlab_t *pSlab = pArena->pPartial[iClass];
+	zoneHeader_t *pCell;
+
+	if (!pSlab)
+	{
+		pSlab = Zone_NewSlab(eTag, iClass);
+	}
+
+	if (pSlab->pFree)
+	{
+		pCell = pSlab->pFree;
+		pSlab->pFree = pCell->pNext;
+	}
+	else
+	{
+		pCell = Zone_SlabCell(pSlab, pSlab->iNumCells++);
+	}
+	pCell->iSlab = pSlab->iIndex;
+	pCell->pNext = pCell->pPrev = nullptr;
+
+	if (++pSlab->iUsed == pSlab->iCapacity)
+	{
+		Zone_UnlinkSlab(&pArena->pPartial[iClass], pSlab);
+		Zone_LinkSlab(&pArena->pFull[iClass], pSlab);
+	}
+
+	return pCell;
+}
+
+static void Zone_SlabFree(zoneSlab_t *pSlab, zoneHeader_t *pCell)
+{
+	pCell->iMagic = ZONE_FREE_MAGIC;
+
+	if (pSlab->bOrphan)
+	{
+		// only foreign blocks are left in here
+		if (!pSlab->iForeign)
+		{
+			Zone_UnlinkSlab(&TheZone.pOrphans, pSlab);
+			Zone_ReleaseSlab(pSlab);
+		}
+		return;
+	}
+
+	zoneArena_t *pArena = &TheZone.Arenas[pSlab->eTag];
+
+	pCell->pNext = pSlab->pFree;
+	pSlab->pFree = pCell;
+
+	if (pSlab->iUsed-- == pSlab->iCapacity)
+	{
+		Zone_UnlinkSlab(&pArena->pFull[pSlab->iClass], pSlab);
+		Zone_LinkSlab(&pArena->pPartial[pSlab->iClass], pSlab);
+	}
+	else if (!pSlab->iUsed && (pArena->pPartial[pSlab->iClass] != pSlab || pSlab->pNext))
+	{
+		// keep one empty slab around so a tag that allocates and frees a lot doesn't thrash
+		Zone_UnlinkSlab(&pArena->pPartial[pSlab->iClass], pSlab);
+		Zone_ReleaseSlab(pSlab);
+	}
+}
+
+void *Z_Malloc(int iSize, memtag_t eTag, bool bZeroit /* = false */, int iUnusedAlign /* = 4 */)
+{
+	gbMemFreeupOccured = false;
+
+	if (iSize == 0)
+	{
+		zoneHeader_t *pMemory = (zoneHeader_t *) &gZeroMalloc;
+		return &pMemory[1];
+	}
+
+	zoneHeader_t *pMemory;
+	const int iClass = Zone_SizeClass(iSize);
+
+	if (iClass >= 0)
+	{
+		pMemory = Zone_SlabAlloc(eTag, iClass);
+		if (bZeroit)
+		{
+			memset(&pMemory[1], 0, iSize);
+		}
+	}
+	else
+	{
+		// Add in tracking info
+
+		int iRealSize = (iSize + sizeof(zoneHeader_t) + sizeof(zoneTail_t));
+
+		pMemory = (zoneHeader_t *) Zone_SysAlloc(iRealSize, bZeroit, iSize, eTag);
+		pMemory->iSlab = 0;
+
+		// Link in
+		Zone_LinkBlock(&TheZone.Arenas[eTag].Header, pMemory);
+	}
+
+	pMemory->iMagic	= ZONE_MAGIC;
+	pMemory->eTag	= eTag;
+	pMemory->iSize	= iSize;
 
 	// add tail...
 
@@ -332,6 +618,28 @@ void Z_MorphMallocTag( void *pvAddress, memtag_t eDesiredTag )
 
 	// morph...
 
+	if (pMemory->iSlab)
+	{
+		// a block can't leave its slab, it goes on the list of its new tag instead so freeing that tag finds it
+		zoneSlab_t *pSlab = TheZone.ppSlabs[pMemory->iSlab];
+
+		if (pMemory->pPrev)
+		{
+			Zone_UnlinkBlock(pMemory);
+			pSlab->iForeign--;
+		}
+		if (pSlab->bOrphan || pSlab->eTag != eDesiredTag)
+		{
+			Zone_LinkBlock(&TheZone.Arenas[eDesiredTag].Header, pMemory);
+			pSlab->iForeign++;
+		}
+	}
+	else
+	{
+		Zone_UnlinkBlock(pMemory);
+		Zone_LinkBlock(&TheZone.Arenas[eDesiredTag].Header, pMemory);
+	}
+
 	pMemory->eTag = eDesiredTag;
 
 	// INC new tag stats...
@@ -352,20 +660,6 @@ static void Zone_FreeBlock(zoneHeader_t *pMemory)
 		TheZone.Stats.iSizesPerTag	[pMemory->eTag] -= pMemory->iSize;
 		TheZone.Stats.iCountsPerTag	[pMemory->eTag]--;
 
-		// Sanity checks...
-
-		assert(pMemory->pPrev->pNext == pMemory);
-		assert(!pMemory->pNext || (pMemory->pNext->pPrev == pMemory));
-
-		// Unlink and free...
-
-		pMemory->pPrev->pNext = pMemory->pNext;
-		if(pMemory->pNext)
-		{
-			pMemory->pNext->pPrev = pMemory->pPrev;
-		}
-		free (pMemory);
-
 		#ifdef DETAILED_ZONE_DEBUG_CODE
 		// this has already been checked for in execution order, but wtf?
 		int& iAllocCount = mapAllocatedZones[pMemory];
@@ -376,6 +670,26 @@ static void Zone_FreeBlock(zoneHeader_t *pMemory)
 		}
 		iAllocCount--;
 		#endif
+
+		// Unlink and free...
+
+		if (pMemory->iSlab)
+		{
+			zoneSlab_t *pSlab = TheZone.ppSlabs[pMemory->iSlab];
+
+			if (pMemory->pPrev)
+			{
+				// it was morphed to another tag
+				Zone_UnlinkBlock(pMemory);
+				pSlab->iForeign--;
+			}
+			Zone_SlabFree(pSlab, pMemory);
+		}
+		else
+		{
+			Zone_UnlinkBlock(pMemory);
+			free (pMemory);
+		}
 	}
 }
 
@@ -445,30 +759,62 @@ int Z_MemSize(memtag_t eTag)
 	return TheZone.Stats.iSizesPerTag[eTag];
 }
 
+// Frees all blocks of a tag, the arena's own slabs go without looking at the blocks in them
+static void Zone_FreeArena(memtag_t eTag)
+{
+	zoneArena_t *pArena = &TheZone.Arenas[eTag];
+
+	// the malloc'd blocks, and the ones morphed here from other tags
+	while (pArena->Header.pNext)
+	{
+		Zone_FreeBlock(pArena->Header.pNext);
+	}
+
+	// everything the tag still counts is in its own slabs now
+	TheZone.Stats.iCount -= TheZone.Stats.iCountsPerTag[eTag];
+	TheZone.Stats.iCurrent -= TheZone.Stats.iSizesPerTag[eTag];
+	TheZone.Stats.iCountsPerTag[eTag] = 0;
+	TheZone.Stats.iSizesPerTag[eTag] = 0;
+
+	for (int iClass = 0; iClass < ZONE_NUM_CLASSES; iClass++)
+	{
+		zoneSlab_t **ppLists[2] = { &pArena->pPartial[iClass], &pArena->pFull[iClass] };
+
+		for (zoneSlab_t **ppList : ppLists)
+		{
+			while (*ppList)
+			{
+				zoneSlab_t *pSlab = *ppList;
+				Zone_UnlinkSlab(ppList, pSlab);
+
+				if (pSlab->iForeign)
+				{
+					// blocks morphed to other tags still live in here, it goes when they do
+					pSlab->bOrphan = true;
+					Zone_LinkSlab(&TheZone.pOrphans, pSlab);
+				}
+				else
+				{
+					Zone_ReleaseSlab(pSlab);
+				}
+			}
+		}
+	}
+}
+
 // Frees all blocks with the specified tag...
 void Z_TagFree(memtag_t eTag)
 {
-//#ifdef _DEBUG
-//	int iZoneBlocks = TheZone.Stats.iCount;
-//#endif
-
-	zoneHeader_t *pMemory = TheZone.Header.pNext;
-	while (pMemory)
+	if (eTag == TAG_ALL)
 	{
-		zoneHeader_t *pNext = pMemory->pNext;
-		if ( (eTag == TAG_ALL) || (pMemory->eTag == eTag))
+		for (int i = 0; i < TAG_COUNT; i++)
 		{
-			Zone_FreeBlock(pMemory);
+			Zone_FreeArena((memtag_t)i);
 		}
-		pMemory = pNext;
+		return;
 	}
 
-// these stupid pragmas don't work here???!?!?!
-//#ifdef _DEBUG
-//#pragma warning( disable : 4189)
-//	int iBlocksFreed = iZoneBlocks - TheZone.Stats.iCount;
-//#pragma warning( default : 4189)
-//#endif
+	Zone_FreeArena(eTag);
 }
 
 void *S_Malloc( int iSize ) {
@@ -509,6 +855,12 @@ static void Z_Stats_f(void)
 									TheZone.Stats.iPeak,
 									         (float)TheZone.Stats.iPeak / 1024.0f / 1024.0f
 				);
+
+	Com_Printf("Blocks of up to %d bytes live in %d slabs (%.2fMB)\n",
+									ZONE_MAX_SLAB_BLOCK,
+									TheZone.iNumSlabs,
+									         (float)TheZone.iNumSlabs * ZONE_SLAB_SIZE / 1024.0f / 1024.0f
+				);
 }
 
 // Gives a detailed breakdown of the memory blocks in the zone
@@ -559,13 +911,21 @@ void Com_ShutdownZoneMemory(void)
 		assert(!TheZone.Stats.iCount);
 		assert(!TheZone.Stats.iCurrent);
 	}
+
+	assert(!TheZone.iNumSlabs);
+	free(TheZone.ppSlabs);
+	TheZone.ppSlabs = nullptr;
+	TheZone.iSlabSlots = 0;
 }
 
 // Initialises the zone memory system
 void Com_InitZoneMemory( void )
 {
 	memset(&TheZone, 0, sizeof(TheZone));
-	TheZone.Header.iMagic = ZONE_MAGIC;
+	for (int i = 0; i < TAG_COUNT; i++)
+	{
+		TheZone.Arenas[i].Header.iMagic = ZONE_MAGIC;
+	}
 }
 
 void Com_InitZoneMemoryVars( void ) {
@@ -608,16 +968,31 @@ void Com_TouchMemory( void ) {
 
 	sum = 0;
 
-	zoneHeader_t *pMemory = TheZone.Header.pNext;
-	while (pMemory)
+	for (int iTag = 0; iTag < TAG_COUNT; iTag++)
 	{
-		byte *pMem = (byte *) &pMemory[1];
-		j = pMemory->iSize >> 2;
-		for (i=0; i<j; i+=64){
-			sum += ((int*)pMem)[i];
+		zoneHeader_t *pMemory = TheZone.Arenas[iTag].Header.pNext;
+		while (pMemory)
+		{
+			byte *pMem = (byte *) &pMemory[1];
+			j = pMemory->iSize >> 2;
+			for (i=0; i<j; i+=64){
+				sum += ((int*)pMem)[i];
+			}
+
+			pMemory = pMemory->pNext;
 		}
+	}
 
-		pMemory = pMemory->pNext;
+	// small blocks are packed together, so touching every page of the slabs is enough
+	for (i = 1; i < TheZone.iSlabSlots; i++)
+	{
+		if (TheZone.ppSlabs[i])
+		{
+			int *pMem = (int *) TheZone.ppSlabs[i];
+			for (j = 0; j < ZONE_SLAB_SIZE >> 2; j += 1024){
+				sum += pMem[j];
+			}
+		}
 	}
 
 //	end = Sys_Milliseconds();
@@ -660,6 +1035,12 @@ void Hunk_ClearToMark( void ) {
 	Z_TagFree(TAG_HUNK_MARK2);
 }
 
+// Undoes Hunk_SetMark for something that only borrowed the hunk, like cm_bench
+void Hunk_ReleaseMark( void ) {
+	Hunk_ClearToMark();
+	hunk_tag = TAG_HUNK_MARK1;
+}
+
 bool Hunk_CheckMark( void ) {
 	//if( hunk_low.mark || hunk_high.mark ) {
 	if (hunk_tag != TAG_HUNK_MARK1)
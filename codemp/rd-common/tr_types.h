@@ -333,6 +333,7 @@ struct model_t {
 	mdxaHeader_t *mdxa;				// only if type == MOD_GL2A which is a GHOUL II Animation file
 	int			 numLods;
 	bool	bspInstance;
+	struct g2ModelTrees_t *g2Trees;	// only on the server, per bone triangle trees for Ghoul2 traces
 };
 
 struct refdef_t {
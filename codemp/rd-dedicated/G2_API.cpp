@@ -151,6 +151,15 @@ void G2_DEBUG_RemovePtrFromTracker(CGhoul2Info_v *g2)
 }
 #endif
 
+// the bones moved without going through a setter, traces have to skin the models again
+static inline void G2_FlushMesh(CGhoul2Info_v &ghoul2)
+{
+	if (ghoul2.size())
+	{
+		ghoul2[0].mMeshFrameNum = 0;
+	}
+}
+
 //rww - RAGDOLL_BEGIN
 #define NUM_G2T_TIME (2)
 static int G2TimeBases[NUM_G2T_TIME];
@@ -161,6 +170,11 @@ void G2API_SetTime(int currentTime,int clock)
 #if G2_DEBUG_TIME
 	ri.Printf( PRINT_ALL, "Set Time: before c%6d  s%6d",G2TimeBases[1],G2TimeBases[0]);
 #endif
+	// the server moved on, so the skinned vertices traces kept around are no good anymore
+	if (!clock && G2TimeBases[0] != currentTime && ri.GetG2VertSpaceServer)
+	{
+		ri.GetG2VertSpaceServer()->ResetHeap();
+	}
 	G2TimeBases[clock]=currentTime;
 	if (G2TimeBases[1]>G2TimeBases[0]+200)
 	{
@@ -984,6 +998,7 @@ bool G2API_SetBoneAnimIndex(CGhoul2Info *ghlInfo, const int index, const int Ast
 	{
 		// ensure we flush the cache
 		ghlInfo->mSkelFrameNum = 0;
+		ghlInfo->mMeshFrameNum = 0;
  		return G2_Set_Bone_Anim_Index(ghlInfo->mBlist, index, startFrame, endFrame, flags, animSpeed, currentTime, setFrame, blendTime, ghlInfo->aHeader->numFrames);
 	}
 	return false;
@@ -1059,6 +1074,7 @@ bool G2API_SetBoneAnim(CGhoul2Info_v &ghoul2, const int modelIndex, const char *
 		{
 			// ensure we flush the cache
 			ghlInfo->mSkelFrameNum = 0;
+			ghlInfo->mMeshFrameNum = 0;
  			return G2_Set_Bone_Anim(ghlInfo, ghlInfo->mBlist, boneName, startFrame, endFrame, flags, animSpeed, currentTime, setFrame, blendTime);
 		}
 	}
@@ -1156,6 +1172,8 @@ bool G2API_PauseBoneAnim(CGhoul2Info *ghlInfo, const char *boneName, const int c
 {
 	if (G2_SetupModelPointers(ghlInfo))
 	{
+		// ensure we flush the cache
+		ghlInfo->mMeshFrameNum = 0;
  		return G2_Pause_Bone_Anim(ghlInfo, ghlInfo->mBlist, boneName, currentTime);
 	}
 	return false;
@@ -1174,6 +1192,8 @@ bool G2API_StopBoneAnimIndex(CGhoul2Info *ghlInfo, const int index)
 {
 	if (G2_SetupModelPointers(ghlInfo))
 	{
+		// ensure we flush the cache
+		ghlInfo->mMeshFrameNum = 0;
  		return G2_Stop_Bone_Anim_Index(ghlInfo->mBlist, index);
 	}
 	return false;
@@ -1183,6 +1203,8 @@ bool G2API_StopBoneAnim(CGhoul2Info *ghlInfo, const char *boneName)
 {
 	if (G2_SetupModelPointers(ghlInfo))
 	{
+		// ensure we flush the cache
+		ghlInfo->mMeshFrameNum = 0;
  		return G2_Stop_Bone_Anim(ghlInfo->mFileName, ghlInfo->mBlist, boneName);
 	}
 	return false;
@@ -1220,6 +1242,7 @@ bool G2API_SetBoneAnglesIndex(CGhoul2Info *ghlInfo, const int index, const vec3_
 	{
 		// ensure we flush the cache
 		ghlInfo->mSkelFrameNum = 0;
+		ghlInfo->mMeshFrameNum = 0;
 		return G2_Set_Bone_Angles_Index( ghlInfo->mBlist, index, angles, flags, yaw, pitch, roll, modelList, ghlInfo->mModelindex, blendTime, currentTime);
 	}
 	return false;
@@ -1260,6 +1283,7 @@ bool G2API_SetBoneAngles(CGhoul2Info_v &ghoul2, const int modelIndex, const char
 		{
 				// ensure we flush the cache
 			ghlInfo->mSkelFrameNum = 0;
+			ghlInfo->mMeshFrameNum = 0;
 			return G2_Set_Bone_Angles(ghlInfo, ghlInfo->mBlist, boneName, angles, flags, up, left, forward, modelList, ghlInfo->mModelindex, blendTime, currentTime);
 		}
 	}
@@ -1273,6 +1297,7 @@ bool G2API_SetBoneAnglesMatrixIndex(CGhoul2Info *ghlInfo, const int index, const
 	{
 		// ensure we flush the cache
 		ghlInfo->mSkelFrameNum = 0;
+		ghlInfo->mMeshFrameNum = 0;
 		return G2_Set_Bone_Angles_Matrix_Index(ghlInfo->mBlist, index, matrix, flags, modelList, ghlInfo->mModelindex, blendTime, currentTime);
 	}
 	return false;
@@ -1285,6 +1310,7 @@ bool G2API_SetBoneAnglesMatrix(CGhoul2Info *ghlInfo, const char *boneName, const
 	{
 		// ensure we flush the cache
 		ghlInfo->mSkelFrameNum = 0;
+		ghlInfo->mMeshFrameNum = 0;
 		return G2_Set_Bone_Angles_Matrix(ghlInfo->mFileName, ghlInfo->mBlist, boneName, matrix, flags, modelList, ghlInfo->mModelindex, blendTime, currentTime);
 	}
 	return false;
@@ -1296,6 +1322,7 @@ bool G2API_StopBoneAnglesIndex(CGhoul2Info *ghlInfo, const int index)
 	{
 		// ensure we flush the cache
 		ghlInfo->mSkelFrameNum = 0;
+		ghlInfo->mMeshFrameNum = 0;
  		return G2_Stop_Bone_Angles_Index(ghlInfo->mBlist, index);
 	}
 	return false;
@@ -1307,6 +1334,7 @@ bool G2API_StopBoneAngles(CGhoul2Info *ghlInfo, const char *boneName)
 	{
 		// ensure we flush the cache
 		ghlInfo->mSkelFrameNum = 0;
+		ghlInfo->mMeshFrameNum = 0;
  		return G2_Stop_Bone_Angles(ghlInfo->mFileName, ghlInfo->mBlist, boneName);
 	}
 	return false;
@@ -1331,11 +1359,13 @@ void G2API_AbsurdSmoothing(CGhoul2Info_v &ghoul2, bool status)
 class CRagDollParams;
 void G2API_SetRagDoll(CGhoul2Info_v &ghoul2,CRagDollParams *parms)
 {
+	G2_FlushMesh(ghoul2);
 	G2_SetRagDoll(ghoul2,parms);
 }
 
 void G2API_ResetRagDoll(CGhoul2Info_v &ghoul2)
 {
+	G2_FlushMesh(ghoul2);
 	G2_ResetRagDoll(ghoul2);
 }
 //rww - RAGDOLL_END
@@ -1348,6 +1378,7 @@ bool G2API_RemoveBone(CGhoul2Info_v& ghoul2, int modelIndex, const char *boneNam
 	{
 		// ensure we flush the cache
 		ghlInfo->mSkelFrameNum = 0;
+		ghlInfo->mMeshFrameNum = 0;
  		return G2_Remove_Bone(ghlInfo, ghlInfo->mBlist, boneName);
 	}
 	return false;
@@ -1371,6 +1402,9 @@ void G2API_AnimateG2ModelsRag(CGhoul2Info_v &ghoul2, int AcurrentTime,CRagDollUp
 	ragTraceCount = 0;
 #endif
 
+	// the ragdoll moves the bones without going through the setters
+	G2_FlushMesh(ghoul2);
+
 	// Walk the list and find all models that are active
 	for (model = 0; model < ghoul2.size(); model++)
 	{
@@ -1539,11 +1573,13 @@ bool G2API_RagForceSolve(CGhoul2Info_v &ghoul2, bool force)
 
 bool G2API_SetBoneIKState(CGhoul2Info_v &ghoul2, int time, const char *boneName, int ikState, sharedSetBoneIKStateParams_t *params)
 {
+	G2_FlushMesh(ghoul2);
 	return G2_SetBoneIKState(ghoul2, time, boneName, ikState, params);
 }
 
 bool G2API_IKMove(CGhoul2Info_v &ghoul2, int time, sharedIKMoveParams_t *params)
 {
+	G2_FlushMesh(ghoul2);
 	return G2_IKMove(ghoul2, time, params);
 }
 
@@ -1608,6 +1644,7 @@ void G2API_SetBoltInfo(CGhoul2Info_v &ghoul2, int modelIndex, int boltInfo)
 {
 	if (ghoul2.size() > modelIndex)
 	{
+		ghoul2[modelIndex].mMeshFrameNum = 0;
 		ghoul2[modelIndex].mModelBoltLink = boltInfo;
 	}
 }
@@ -1616,6 +1653,7 @@ bool G2API_DetachG2Model(CGhoul2Info *ghlInfo)
 {
 	if (G2_SetupModelPointers(ghlInfo))
 	{
+	   ghlInfo->mMeshFrameNum = 0;
 	   ghlInfo->mModelBoltLink = -1;
 	   return true;
 	}
@@ -1910,8 +1948,10 @@ void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &gh
 		vec3_t	transRayStart, transRayEnd;
 
 		int tframeNum=G2API_GetTime(frameNumber);
-		// make sure we have transformed the whole skeletons for each model
-		if (G2_NeedRetransform(&ghoul2[0], tframeNum) || !ghoul2[0].mTransformedVertsArray)
+		// make sure we have transformed the whole skeletons for each model, and that the vertex space they went into
+		// hasn't been reset since
+		if (G2_NeedRetransform(&ghoul2[0], tframeNum) || !ghoul2[0].mTransformedVertsArray
+			|| ghoul2[0].mMeshVertSpace != G2VertSpace || ghoul2[0].mMeshVertGeneration != G2VertSpace->MiniHeapGeneration())
 		{ //optimization, only create new transform space if we need to, otherwise
 			//store it off!
 			int i = 0;
@@ -1932,6 +1972,7 @@ void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &gh
 					//it is a miniheap pointer. Just stomp over it.
 					int iSize = g2.currentModel->mdxm->numSurfaces * 4;
 					g2.mTransformedVertsArray = (size_t *)Z_Malloc(iSize, TAG_GHOUL2, true);
+					g2.mMeshFrameNum = 0;
 				}
 
 				g2.mFlags |= GHOUL2_ZONETRANSALLOC;
@@ -1939,7 +1980,6 @@ void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &gh
 				i++;
 			}
 			G2_ConstructGhoulSkeleton(ghoul2, frameNumber, true, scale);
-			G2VertSpace->ResetHeap();
 
 			// now having done that, time to build the model
 #ifdef _G2_GORE
@@ -2010,14 +2050,23 @@ void G2API_CollisionDetect(CollisionRecord_t *collRecMap, CGhoul2Info_v &ghoul2,
 		// pre generate the world matrix - used to transform the incoming ray
 		G2_GenerateWorldMatrix(angles, position);
 
-		G2VertSpace->ResetHeap();
+		// point traces only skin the triangles the bone trees can't rule out. models kept around by
+		// G2API_CollisionDetectCache need all of their vertices
+		const bool lazy = fabs(fRadius) < 0.1 && !(ghoul2[0].mFlags & GHOUL2_ZONETRANSALLOC);
 
 		// now having done that, time to build the model
+		if (lazy)
+		{
+			G2_TransformModelLazy(ghoul2, frameNumber, scale, G2VertSpace, useLod);
+		}
+		else
+		{
 #ifdef _G2_GORE
-		G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod, false);
+			G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod, false);
 #else
-		G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod);
+			G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod);
 #endif
+		}
 
 		// model is built. Lets check to see if any triangles are actually hit.
 		// first up, translate the ray to model space
@@ -2030,6 +2079,11 @@ void G2API_CollisionDetect(CollisionRecord_t *collRecMap, CGhoul2Info_v &ghoul2,
 #else
 		G2_TraceModels(ghoul2, transRayStart, transRayEnd, collRecMap, entNum, traceFlags, useLod, fRadius);
 #endif
+		if (lazy)
+		{
+			G2_EndLazyTransform();
+		}
+
 		int i;
 		for ( i = 0; i < MAX_G2_COLLISIONS && collRecMap[i].mEntityNum != -1; i ++ );
 
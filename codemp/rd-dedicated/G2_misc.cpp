@@ -27,6 +27,9 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "server/server.h"
 #include "ghoul2/g2_local.h"
 
+#include <algorithm>
+#include <vector>
+
 #ifdef _G2_GORE
 #include "ghoul2/G2_gore.h"
 
@@ -189,6 +192,7 @@ public:
 	skin_t				*skin;
     shader_t            *cust_shader;
 	size_t				*TransformedVertsArray;
+	CBoneCache			*boneCache;
 	int					traceFlags;
 	bool				hitOne;
 	float				m_fRadius;
@@ -241,6 +245,7 @@ public:
 	skin(initskin),
 	cust_shader(initcust_shader),
 	TransformedVertsArray(initTransformedVertsArray),
+	boneCache(nullptr),
 	traceFlags(inittraceFlags),
 #ifdef _G2_GORE
 	m_fRadius(fRadius),
@@ -371,112 +376,496 @@ int G2_DecideTraceLod(CGhoul2Info &ghoul2, int useLod)
 	return returnLod;
 }
 
-void R_TransformEachSurface( const mdxmSurface_t *surface, vec3_t scale, IHeapAllocator *G2VertSpace, size_t *TransformedVertsArray,CBoneCache *boneCache)
-{
-	int				 j, k;
-	mdxmVertex_t 	*v;
-	float			*TransformedVerts;
+// Bone trees
+// Each surface's triangles are grouped by the bone carrying most of their weight, and every group gets a bounding
+// volume tree over the vertices as the model stores them, before skinning. That bone's matrix puts a vertex weighted
+// to it alone exactly where skinning would; a blended vertex can only be pulled away from there by as much as the
+// other bones of the group differ from this one over the group's bounds. A point trace moves the ray into each bone's
+// space and walks its tree with the boxes grown by that much, so every triangle it skips is one the ray misses, and
+// only the vertices of the remaining triangles get skinned.
+
+#define G2_TREE_LEAF_TRIS	(4)
+#define G2_TREE_MAX_DEPTH	(48)
+#define G2_TREE_EPSILON		(0.05f)
+
+struct g2BoneTreeNode_t {
+	vec3_t		mins, maxs;
+	int			first;		// leaf: first entry in the surface's triangle list, inner: index of the second child
+	int			count;		// leaf: number of triangles, inner: 0, and the first child is the next node
+};
 
-	// deform the vertexes by the lerped bones
+struct g2BoneTree_t {
+	int			bone;		// bone reference of the surface the triangles mostly follow
+	unsigned	bones;		// mask of all the bone references their vertices are weighted to
+	int			firstNode;
+	int			firstTri, numTris;
+};
 
-	int *piBoneReferences = (int*) ((byte*)surface + surface->ofsBoneReferences);
+struct g2SurfaceTrees_t {
+	int					numTrees;
+	g2BoneTree_t		*trees;
+	g2BoneTreeNode_t	*nodes;
+	int					*tris;
+	int					vertBytes;	// vertex space the surface takes once it is skinned
+};
 
-	// alloc some space for the transformed verts to get put in
-	TransformedVerts = (float *)G2VertSpace->MiniHeapAlloc(surface->numVerts * 5 * 4);
-	TransformedVertsArray[surface->thisSurfaceIndex] = (size_t)TransformedVerts;
-	if (!TransformedVerts)
+struct g2ModelTrees_t {
+	int					numSurfaces;
+	g2SurfaceTrees_t	*surfaces;	// by lod, then surface index
+	int					*meshBytes;	// vertex space every surface of a lod takes, per lod
+};
+
+static void G2_BoundTriangles( const mdxmSurface_t *surface, const int *tris, int count, vec3_t mins, vec3_t maxs )
+{
+	const mdxmTriangle_t	*triangles = (mdxmTriangle_t *)((byte *)surface + surface->ofsTriangles);
+	const mdxmVertex_t		*verts = (mdxmVertex_t *)((byte *)surface + surface->ofsVerts);
+	int						i, k;
+
+	ClearBounds( mins, maxs );
+	for ( i = 0; i < count; i++ )
 	{
-		Com_Error(ERR_DROP, "Ran out of transform space for Ghoul2 Models. Adjust MiniHeapSize in SV_SpawnServer.\n");
+		for ( k = 0; k < 3; k++ )
+		{
+			AddPointToBounds( verts[triangles[tris[i]].indexes[k]].vertCoords, mins, maxs );
+		}
 	}
+}
 
-	// whip through and actually transform each vertex
-	const int numVerts = surface->numVerts;
-	v = (mdxmVertex_t *) ((byte *)surface + surface->ofsVerts);
-	mdxmVertexTexCoord_t *pTexCoords = (mdxmVertexTexCoord_t *) &v[numVerts];
+// splits at the median triangle along the longest side of the bounds
+static void G2_BuildBoneTreeNode( const mdxmSurface_t *surface, int *tris, int count, int first, int depth, std::vector<g2BoneTreeNode_t> &nodes )
+{
+	const mdxmTriangle_t	*triangles = (mdxmTriangle_t *)((byte *)surface + surface->ofsTriangles);
+	const mdxmVertex_t		*verts = (mdxmVertex_t *)((byte *)surface + surface->ofsVerts);
+	const int				nodeNum = nodes.size();
+	g2BoneTreeNode_t		node;
+	int						axis, half;
+
+	G2_BoundTriangles( surface, tris, count, node.mins, node.maxs );
+	node.first = first;
+	node.count = count;
+	nodes.push_back( node );
+
+	if ( count <= G2_TREE_LEAF_TRIS || depth == G2_TREE_MAX_DEPTH - 1 )
+	{
+		return;
+	}
 
-	// optimisation issue
-	if ((scale[0] != 1.0) || (scale[1] != 1.0) || (scale[2] != 1.0))
+	axis = 0;
+	for ( int i = 1; i < 3; i++ )
 	{
-		for ( j = 0; j < numVerts; j++ )
+		if ( node.maxs[i] - node.mins[i] > node.maxs[axis] - node.mins[axis] )
 		{
-			vec3_t			tempVert, tempNormal;
-//			mdxmWeight_t	*w;
+			axis = i;
+		}
+	}
+
+	half = count / 2;
+	std::nth_element( tris, tris + half, tris + count, [&]( int a, int b ) {
+		const mdxmTriangle_t &ta = triangles[a], &tb = triangles[b];
+		return verts[ta.indexes[0]].vertCoords[axis] + verts[ta.indexes[1]].vertCoords[axis] + verts[ta.indexes[2]].vertCoords[axis]
+			< verts[tb.indexes[0]].vertCoords[axis] + verts[tb.indexes[1]].vertCoords[axis] + verts[tb.indexes[2]].vertCoords[axis];
+	} );
+
+	nodes[nodeNum].count = 0;
+	G2_BuildBoneTreeNode( surface, tris, half, first, depth + 1, nodes );
+	nodes[nodeNum].first = nodes.size();
+	G2_BuildBoneTreeNode( surface, tris + half, count - half, first + half, depth + 1, nodes );
+}
 
-			VectorClear( tempVert );
-			VectorClear( tempNormal );
-//			w = v->weights;
+static void G2_BuildSurfaceTrees( const mdxmSurface_t *surface, g2SurfaceTrees_t *st )
+{
+	const mdxmTriangle_t			*triangles = (mdxmTriangle_t *)((byte *)surface + surface->ofsTriangles);
+	const mdxmVertex_t				*verts = (mdxmVertex_t *)((byte *)surface + surface->ofsVerts);
+	std::vector<int>				byBone[1 << iG2_BITS_PER_BONEREF];
+	unsigned						masks[1 << iG2_BITS_PER_BONEREF] = {};
+	std::vector<g2BoneTreeNode_t>	nodes;
+	int								i, j, k, numTris;
+
+	for ( i = 0; i < surface->numTriangles; i++ )
+	{
+		float		weights[1 << iG2_BITS_PER_BONEREF] = {};
+		unsigned	mask = 0;
+		int			best = 0;
+
+		for ( j = 0; j < 3; j++ )
+		{
+			const mdxmVertex_t	*v = &verts[triangles[i].indexes[j]];
+			const int			iNumWeights = G2_GetVertWeights( v );
+			float				fTotalWeight = 0.0f;
 
-			const int iNumWeights = G2_GetVertWeights( v );
+			for ( k = 0; k < iNumWeights; k++ )
+			{
+				const int iBoneIndex = G2_GetVertBoneIndex( v, k );
+				weights[iBoneIndex] += G2_GetVertBoneWeight( v, k, fTotalWeight, iNumWeights );
+				mask |= 1u << iBoneIndex;
+			}
+		}
 
-			float fTotalWeight = 0.0f;
-			for ( k = 0 ; k < iNumWeights ; k++ )
+		for ( j = 1; j < (1 << iG2_BITS_PER_BONEREF); j++ )
+		{
+			if ( weights[j] > weights[best] )
 			{
-				int		iBoneIndex	= G2_GetVertBoneIndex( v, k );
-				float	fBoneWeight	= G2_GetVertBoneWeight( v, k, fTotalWeight, iNumWeights );
+				best = j;
+			}
+		}
 
-				const mdxaBone_t &bone=EvalBoneCache(piBoneReferences[iBoneIndex],boneCache);
+		byBone[best].push_back( i );
+		masks[best] |= mask;
+	}
 
-				tempVert[0] += fBoneWeight * ( DotProduct( bone.matrix[0], v->vertCoords ) + bone.matrix[0][3] );
-				tempVert[1] += fBoneWeight * ( DotProduct( bone.matrix[1], v->vertCoords ) + bone.matrix[1][3] );
-				tempVert[2] += fBoneWeight * ( DotProduct( bone.matrix[2], v->vertCoords ) + bone.matrix[2][3] );
+	st->numTrees = 0;
+	for ( i = 0; i < (1 << iG2_BITS_PER_BONEREF); i++ )
+	{
+		if ( !byBone[i].empty() )
+		{
+			st->numTrees++;
+		}
+	}
+	if ( !st->numTrees )
+	{
+		return;
+	}
 
-				tempNormal[0] += fBoneWeight * DotProduct( bone.matrix[0], v->normal );
-				tempNormal[1] += fBoneWeight * DotProduct( bone.matrix[1], v->normal );
-				tempNormal[2] += fBoneWeight * DotProduct( bone.matrix[2], v->normal );
-			}
-			int pos = j * 5;
+	st->trees = (g2BoneTree_t *)Hunk_Alloc( st->numTrees * sizeof( g2BoneTree_t ), h_low );
+	st->tris = (int *)Hunk_Alloc( surface->numTriangles * sizeof( int ), h_low );
 
-			// copy tranformed verts into temp space
-			TransformedVerts[pos++] = tempVert[0] * scale[0];
-			TransformedVerts[pos++] = tempVert[1] * scale[1];
-			TransformedVerts[pos++] = tempVert[2] * scale[2];
-			// we will need the S & T coors too for hitlocation and hitmaterial stuff
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[0];
-			TransformedVerts[pos] = pTexCoords[j].texCoords[1];
+	numTris = 0;
+	g2BoneTree_t *tree = st->trees;
+	for ( i = 0; i < (1 << iG2_BITS_PER_BONEREF); i++ )
+	{
+		const int count = byBone[i].size();
 
-			v++;// = (mdxmVertex_t *)&v->weights[/*v->numWeights*/surface->maxVertBoneWeights];
+		if ( !count )
+		{
+			continue;
 		}
+
+		tree->bone = i;
+		tree->bones = masks[i];
+		tree->firstNode = nodes.size();
+		tree->firstTri = numTris;
+		tree->numTris = count;
+
+		memcpy( st->tris + numTris, byBone[i].data(), count * sizeof( int ) );
+		G2_BuildBoneTreeNode( surface, st->tris + numTris, count, numTris, 0, nodes );
+		numTris += count;
+		tree++;
 	}
-	else
+
+	st->nodes = (g2BoneTreeNode_t *)Hunk_Alloc( nodes.size() * sizeof( g2BoneTreeNode_t ), h_low );
+	memcpy( st->nodes, nodes.data(), nodes.size() * sizeof( g2BoneTreeNode_t ) );
+}
+
+// skinned vertices, then a flag per vertex telling whether it has been skinned yet
+static inline int G2_SurfaceVertBytes( const mdxmSurface_t *surface )
+{
+	return surface->numVerts * 5 * 4 + ((surface->numVerts + 3) & ~3);
+}
+
+// called when a mesh is registered, the trees go away with the model
+void G2_BuildBoneTrees( model_t *mod )
+{
+	const mdxmHeader_t	*mdxm = mod->mdxm;
+	g2ModelTrees_t		*mt;
+	int					i, l;
+
+	mt = (g2ModelTrees_t *)Hunk_Alloc( sizeof( g2ModelTrees_t ), h_low );
+	mt->numSurfaces = mdxm->numSurfaces;
+	mt->surfaces = (g2SurfaceTrees_t *)Hunk_Alloc( mdxm->numLODs * mdxm->numSurfaces * sizeof( g2SurfaceTrees_t ), h_low );
+	mt->meshBytes = (int *)Hunk_Alloc( mdxm->numLODs * sizeof( int ), h_low );
+
+	for ( l = 0; l < mdxm->numLODs; l++ )
+	{
+		mt->meshBytes[l] = mdxm->numSurfaces * sizeof( size_t );
+		for ( i = 0; i < mdxm->numSurfaces; i++ )
+		{
+			const mdxmSurface_t *surface = (mdxmSurface_t *)G2_FindSurface( mod, i, l );
+			g2SurfaceTrees_t *st = &mt->surfaces[l * mdxm->numSurfaces + surface->thisSurfaceIndex];
+
+			G2_BuildSurfaceTrees( surface, st );
+			st->vertBytes = G2_SurfaceVertBytes( surface );
+			mt->meshBytes[l] += st->vertBytes;
+		}
+	}
+
+	mod->g2Trees = mt;
+}
+
+// Inverts a bone matrix, which may be scaled. norm is the Frobenius norm of the inverse rotation, a bound on how much
+// it can stretch a distance.
+static bool G2_InvertBone( const mdxaBone_t &in, mdxaBone_t &out, float *norm )
+{
+	const float	(*m)[4] = in.matrix;
+	float		det;
+	int			i, j;
+
+	out.matrix[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	out.matrix[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+	out.matrix[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+	out.matrix[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	out.matrix[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+	out.matrix[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+	out.matrix[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	out.matrix[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+	out.matrix[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+	det = m[0][0] * out.matrix[0][0] + m[0][1] * out.matrix[1][0] + m[0][2] * out.matrix[2][0];
+	if ( fabsf( det ) < 1e-6f )
+	{
+		return false;
+	}
+
+	*norm = 0.0f;
+	for ( i = 0; i < 3; i++ )
+	{
+		for ( j = 0; j < 3; j++ )
+		{
+			out.matrix[i][j] /= det;
+			*norm += out.matrix[i][j] * out.matrix[i][j];
+		}
+	}
+	*norm = sqrtf( *norm );
+
+	for ( i = 0; i < 3; i++ )
+	{
+		out.matrix[i][3] = -( out.matrix[i][0] * m[0][3] + out.matrix[i][1] * m[1][3] + out.matrix[i][2] * m[2][3] );
+	}
+	return true;
+}
+
+// furthest apart two bones put any point in the box, which is at one of its corners
+static float G2_BoneStray( const mdxaBone_t &bone, const mdxaBone_t &other, const vec3_t mins, const vec3_t maxs )
+{
+	float	stray = 0.0f;
+	int		corner, i;
+
+	for ( corner = 0; corner < 8; corner++ )
 	{
-		int pos = 0;
-	  	for ( j = 0; j < numVerts; j++ )
+		vec3_t p, d;
+
+		p[0] = (corner & 1) ? maxs[0] : mins[0];
+		p[1] = (corner & 2) ? maxs[1] : mins[1];
+		p[2] = (corner & 4) ? maxs[2] : mins[2];
+
+		for ( i = 0; i < 3; i++ )
 		{
-			vec3_t			tempVert, tempNormal;
-//			const mdxmWeight_t	*w;
+			d[i] = (other.matrix[i][0] - bone.matrix[i][0]) * p[0] + (other.matrix[i][1] - bone.matrix[i][1]) * p[1]
+				+ (other.matrix[i][2] - bone.matrix[i][2]) * p[2] + (other.matrix[i][3] - bone.matrix[i][3]);
+		}
+		stray = Q_max( stray, DotProduct( d, d ) );
+	}
+	return sqrtf( stray );
+}
 
-			VectorClear( tempVert );
-			VectorClear( tempNormal );
-//			w = v->weights;
+static bool G2_SegmentHitsBox( const vec3_t start, const vec3_t delta, const vec3_t mins, const vec3_t maxs, float grow )
+{
+	float	enter = 0.0f, leave = 1.0f;
+	int		i;
 
-			const int iNumWeights = G2_GetVertWeights( v );
+	for ( i = 0; i < 3; i++ )
+	{
+		const float lo = mins[i] - grow;
+		const float hi = maxs[i] + grow;
 
-			float fTotalWeight = 0.0f;
-			for ( k = 0 ; k < iNumWeights ; k++ )
+		if ( fabsf( delta[i] ) < 1e-8f )
+		{
+			if ( start[i] < lo || start[i] > hi )
 			{
-				int		iBoneIndex	= G2_GetVertBoneIndex( v, k );
-				float	fBoneWeight	= G2_GetVertBoneWeight( v, k, fTotalWeight, iNumWeights );
+				return false;
+			}
+			continue;
+		}
+
+		float t0 = (lo - start[i]) / delta[i];
+		float t1 = (hi - start[i]) / delta[i];
+		if ( t0 > t1 )
+		{
+			std::swap( t0, t1 );
+		}
+		enter = Q_max( enter, t0 );
+		leave = Q_min( leave, t1 );
+		if ( enter > leave )
+		{
+			return false;
+		}
+	}
+	return true;
+}
 
-				const mdxaBone_t &bone=EvalBoneCache(piBoneReferences[iBoneIndex],boneCache);
+// Lazy skinning for point traces: a surface only gets its vertex buffer when the trace reaches it, and only the
+// vertices of triangles the trace tests are skinned.
+static struct {
+	bool			active;
+	vec3_t			scale;
+	IHeapAllocator	*vertSpace;
+} g2LazyTransform;
 
-				tempVert[0] += fBoneWeight * ( DotProduct( bone.matrix[0], v->vertCoords ) + bone.matrix[0][3] );
-				tempVert[1] += fBoneWeight * ( DotProduct( bone.matrix[1], v->vertCoords ) + bone.matrix[1][3] );
-				tempVert[2] += fBoneWeight * ( DotProduct( bone.matrix[2], v->vertCoords ) + bone.matrix[2][3] );
+// gives the triangles of the surface the ray could hit, in ascending order like a full scan
+static int G2_BoneTreeCandidates( const mdxmSurface_t *surface, const g2SurfaceTrees_t *st, CTraceSurface &TS, int *candidates )
+{
+	const int	*piBoneReferences = (int *)((byte *)surface + surface->ofsBoneReferences);
+	int			stack[G2_TREE_MAX_DEPTH + 1];
+	int			i, k, num;
 
-				tempNormal[0] += fBoneWeight * DotProduct( bone.matrix[0], v->normal );
-				tempNormal[1] += fBoneWeight * DotProduct( bone.matrix[1], v->normal );
-				tempNormal[2] += fBoneWeight * DotProduct( bone.matrix[2], v->normal );
+	num = 0;
+	for ( i = 0; i < st->numTrees; i++ )
+	{
+		const g2BoneTree_t		&tree = st->trees[i];
+		const g2BoneTreeNode_t	*nodes = st->nodes + tree.firstNode;
+		const mdxaBone_t		bone = EvalBoneCache( piBoneReferences[tree.bone], TS.boneCache );
+		mdxaBone_t				inv;
+		vec3_t					start, end, delta;
+		float					norm, stray, grow;
+		int						depth;
+
+		if ( !G2_InvertBone( bone, inv, &norm ) )
+		{	// a collapsed bone can't rule anything out
+			memcpy( candidates + num, st->tris + tree.firstTri, tree.numTris * sizeof( int ) );
+			num += tree.numTris;
+			continue;
+		}
+
+		stray = 0.0f;
+		for ( k = 0; k < (1 << iG2_BITS_PER_BONEREF); k++ )
+		{
+			if ( k != tree.bone && (tree.bones & (1u << k)) )
+			{
+				stray = Q_max( stray, G2_BoneStray( bone, EvalBoneCache( piBoneReferences[k], TS.boneCache ), nodes[0].mins, nodes[0].maxs ) );
 			}
+		}
+		grow = stray * norm + G2_TREE_EPSILON;
+
+		// the skinned vertices were scaled after the bones, so undo that first
+		for ( k = 0; k < 3; k++ )
+		{
+			start[k] = TS.rayStart[k] / g2LazyTransform.scale[k];
+			end[k] = TS.rayEnd[k] / g2LazyTransform.scale[k];
+		}
+		TransformAndTranslatePoint( start, start, &inv );
+		TransformAndTranslatePoint( end, end, &inv );
+		VectorSubtract( end, start, delta );
 
-			// copy tranformed verts into temp space
-			TransformedVerts[pos++] = tempVert[0];
-			TransformedVerts[pos++] = tempVert[1];
-			TransformedVerts[pos++] = tempVert[2];
-			// we will need the S & T coors too for hitlocation and hitmaterial stuff
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[0];
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[1];
+		depth = 0;
+		stack[depth++] = 0;
+		while ( depth )
+		{
+			const g2BoneTreeNode_t *node = &nodes[stack[--depth]];
+
+			if ( !G2_SegmentHitsBox( start, delta, node->mins, node->maxs, grow ) )
+			{
+				continue;
+			}
 
-			v++;// = (mdxmVertex_t *)&v->weights[/*v->numWeights*/surface->maxVertBoneWeights];
+			if ( node->count )
+			{
+				memcpy( candidates + num, st->tris + node->first, node->count * sizeof( int ) );
+				num += node->count;
+			}
+			else
+			{
+				stack[depth++] = node->first;
+				stack[depth++] = node - nodes + 1;
+			}
+		}
+	}
+
+	std::sort( candidates, candidates + num );
+	return num;
+}
+
+// the skinning for one vertex, the same for lazy and full transforms
+static inline void G2_SkinVertex( const mdxmVertex_t *v, const mdxmVertexTexCoord_t *pTexCoord, const int *piBoneReferences, CBoneCache *boneCache, const vec3_t scale, float *out )
+{
+	vec3_t		tempVert;
+	int			k;
+
+	VectorClear( tempVert );
+
+	const int iNumWeights = G2_GetVertWeights( v );
+
+	float fTotalWeight = 0.0f;
+	for ( k = 0 ; k < iNumWeights ; k++ )
+	{
+		int		iBoneIndex	= G2_GetVertBoneIndex( v, k );
+		float	fBoneWeight	= G2_GetVertBoneWeight( v, k, fTotalWeight, iNumWeights );
+
+		const mdxaBone_t &bone=EvalBoneCache(piBoneReferences[iBoneIndex],boneCache);
+
+		tempVert[0] += fBoneWeight * ( DotProduct( bone.matrix[0], v->vertCoords ) + bone.matrix[0][3] );
+		tempVert[1] += fBoneWeight * ( DotProduct( bone.matrix[1], v->vertCoords ) + bone.matrix[1][3] );
+		tempVert[2] += fBoneWeight * ( DotProduct( bone.matrix[2], v->vertCoords ) + bone.matrix[2][3] );
+	}
+
+	// copy tranformed verts into temp space
+	out[0] = tempVert[0] * scale[0];
+	out[1] = tempVert[1] * scale[1];
+	out[2] = tempVert[2] * scale[2];
+	// we will need the S & T coors too for hitlocation and hitmaterial stuff
+	out[3] = pTexCoord->texCoords[0];
+	out[4] = pTexCoord->texCoords[1];
+}
+
+static float *G2_SurfaceVerts( const mdxmSurface_t *surface, IHeapAllocator *G2VertSpace, size_t *TransformedVertsArray )
+{
+	float *verts = (float *)TransformedVertsArray[surface->thisSurfaceIndex];
+
+	if ( !verts )
+	{
+		verts = (float *)G2VertSpace->MiniHeapAlloc( G2_SurfaceVertBytes( surface ) );
+		if ( !verts )
+		{
+			Com_Error(ERR_DROP, "Ran out of transform space for Ghoul2 Models. Adjust MiniHeapSize in SV_SpawnServer.\n");
+		}
+		memset( &verts[surface->numVerts * 5], 0, surface->numVerts );
+		TransformedVertsArray[surface->thisSurfaceIndex] = (size_t)verts;
+	}
+	return verts;
+}
+
+static void G2_LazySkinVertex( const mdxmSurface_t *surface, float *verts, int index, CBoneCache *boneCache )
+{
+	byte *skinned = (byte *)&verts[surface->numVerts * 5];
+
+	if ( skinned[index] )
+	{
+		return;
+	}
+
+	const mdxmVertex_t *v = (mdxmVertex_t *)((byte *)surface + surface->ofsVerts);
+	const mdxmVertexTexCoord_t *pTexCoords = (mdxmVertexTexCoord_t *)&v[surface->numVerts];
+	const int *piBoneReferences = (int *)((byte *)surface + surface->ofsBoneReferences);
+
+	G2_SkinVertex( &v[index], &pTexCoords[index], piBoneReferences, boneCache, g2LazyTransform.scale, &verts[index * 5] );
+	skinned[index] = 1;
+}
+
+// skins whatever a lazy trace earlier in the frame left out
+void R_TransformEachSurface( const mdxmSurface_t *surface, vec3_t scale, IHeapAllocator *G2VertSpace, size_t *TransformedVertsArray,CBoneCache *boneCache)
+{
+	int				 j;
+	mdxmVertex_t 	*v;
+	float			*TransformedVerts;
+	byte			*skinned;
+
+	// deform the vertexes by the lerped bones
+
+	int *piBoneReferences = (int*) ((byte*)surface + surface->ofsBoneReferences);
+
+	// alloc some space for the transformed verts to get put in
+	TransformedVerts = G2_SurfaceVerts(surface, G2VertSpace, TransformedVertsArray);
+
+	// whip through and actually transform each vertex
+	const int numVerts = surface->numVerts;
+	v = (mdxmVertex_t *) ((byte *)surface + surface->ofsVerts);
+	mdxmVertexTexCoord_t *pTexCoords = (mdxmVertexTexCoord_t *) &v[numVerts];
+	skinned = (byte *)&TransformedVerts[numVerts * 5];
+
+	for ( j = 0; j < numVerts; j++ )
+	{
+		if ( !skinned[j] )
+		{
+			G2_SkinVertex( &v[j], &pTexCoords[j], piBoneReferences, boneCache, scale, &TransformedVerts[j * 5] );
+			skinned[j] = 1;
 		}
 	}
 }
@@ -523,11 +912,72 @@ void G2_TransformSurfaces(int surfaceNum, surfaceInfo_v &rootSList,
 }
 
 // main calling point for the model transform for collision detection. At this point all of the skeleton has been transformed.
-#ifdef _G2_GORE
-void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod, bool ApplyGore)
-#else
-void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod)
-#endif
+// Skinned vertices stay in the vertex space until it is reset, so more traces against the same models at the same
+// time, lod and scale pick them up instead of skinning them again. Bolted models hang off their parent's bones, so
+// the instance is only reused as a whole. Also works out how much vertex space it may still take: all of it when it
+// has to be built from scratch, otherwise whatever surfaces a lazy trace hasn't given a buffer yet.
+static bool G2_MeshCached(CGhoul2Info_v &ghoul2, const int frameNum, int useLod, bool ApplyGore, const vec3_t scale, IHeapAllocator *G2VertSpace, int *bytes)
+{
+	int		i, j, lod;
+	bool	cached = true;
+
+	*bytes = 0;
+
+	for (i=0; i<ghoul2.size(); i++)
+	{
+		const CGhoul2Info &g=ghoul2[i];
+
+		if (!g.mValid)
+		{
+			continue;
+		}
+
+		lod = ApplyGore ? useLod : G2_DecideTraceLod(ghoul2[i], useLod);
+		if (lod >= g.currentModel->mdxm->numLODs)
+		{
+			continue;
+		}
+
+		if (!g.mTransformedVertsArray || g.mMeshFrameNum != frameNum || g.mMeshLod != lod || g.mMeshModel != g.currentModel
+			|| g.mMeshVertSpace != G2VertSpace || g.mMeshVertGeneration != G2VertSpace->MiniHeapGeneration()
+			|| !VectorCompare(g.mMeshScale, scale))
+		{
+			cached = false;
+		}
+
+		if (g.currentModel->g2Trees)
+		{
+			*bytes += g.currentModel->g2Trees->meshBytes[lod];
+		}
+	}
+
+	if (cached)
+	{
+		*bytes = 0;
+		for (i=0; i<ghoul2.size(); i++)
+		{
+			const CGhoul2Info &g=ghoul2[i];
+
+			if (!g.mValid || !g.mTransformedVertsArray || !g.currentModel->g2Trees || g.mMeshLod >= g.currentModel->mdxm->numLODs)
+			{
+				continue;
+			}
+
+			const int numSurfaces = g.currentModel->g2Trees->numSurfaces;
+			const g2SurfaceTrees_t *st = &g.currentModel->g2Trees->surfaces[g.mMeshLod * numSurfaces];
+			for (j=0; j<numSurfaces; j++)
+			{
+				if (!g.mTransformedVertsArray[j])
+				{
+					*bytes += st[j].vertBytes;
+				}
+			}
+		}
+	}
+	return cached;
+}
+
+static void G2_TransformModelSurfaces(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod, bool ApplyGore, bool lazy)
 {
 	int				i, lod;
 	vec3_t			correctScale;
@@ -554,6 +1004,17 @@ void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale,
 		correctScale[2] = 1.0;
 	}
 
+	// stop us building this model more than once per frame
+	int meshBytes;
+	bool cached = G2_MeshCached(ghoul2, frameNum, useLod, ApplyGore, correctScale, G2VertSpace, &meshBytes);
+
+	// make sure everything it may still need fits, rather than running out halfway through
+	if (meshBytes && G2VertSpace->MiniHeapRemaining() <= meshBytes)
+	{
+		G2VertSpace->ResetHeap();
+		cached = false;
+	}
+
 	// walk each possible model for this entity and try rendering it out
 	for (i=0; i<ghoul2.size(); i++)
 	{
@@ -565,8 +1026,6 @@ void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale,
 		}
 		assert(g.mBoneCache);
 //		assert(G2_MODEL_OK(&g));
-		// stop us building this model more than once per frame
-		g.mMeshFrameNum = frameNum;
 
 		// decide the LOD
 #ifdef _G2_GORE
@@ -594,17 +1053,33 @@ void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale,
 		}
 #endif
 
-		// give us space for the transformed vertex array to be put in
-		if (!(g.mFlags & GHOUL2_ZONETRANSALLOC))
-		{ //do not stomp if we're using zone space
-			g.mTransformedVertsArray = (size_t*)G2VertSpace->MiniHeapAlloc(g.currentModel->mdxm->numSurfaces * sizeof (size_t));
-			if (!g.mTransformedVertsArray)
-			{
-				Com_Error(ERR_DROP, "Ran out of transform space for Ghoul2 Models. Adjust MiniHeapSize in SV_SpawnServer.\n");
+		if (!cached)
+		{
+			// give us space for the transformed vertex array to be put in
+			if (!(g.mFlags & GHOUL2_ZONETRANSALLOC))
+			{ //do not stomp if we're using zone space
+				g.mTransformedVertsArray = (size_t*)G2VertSpace->MiniHeapAlloc(g.currentModel->mdxm->numSurfaces * sizeof (size_t));
+				if (!g.mTransformedVertsArray)
+				{
+					Com_Error(ERR_DROP, "Ran out of transform space for Ghoul2 Models. Adjust MiniHeapSize in SV_SpawnServer.\n");
+				}
 			}
+
+			memset(g.mTransformedVertsArray, 0, g.currentModel->mdxm->numSurfaces * sizeof (size_t));
+
+			g.mMeshFrameNum = frameNum;
+			g.mMeshLod = lod;
+			g.mMeshModel = g.currentModel;
+			g.mMeshVertSpace = G2VertSpace;
+			g.mMeshVertGeneration = G2VertSpace->MiniHeapGeneration();
+			VectorCopy(correctScale, g.mMeshScale);
 		}
 
-		memset(g.mTransformedVertsArray, 0, g.currentModel->mdxm->numSurfaces * sizeof (size_t));
+		// the trace skins what it needs
+		if (lazy)
+		{
+			continue;
+		}
 
 		G2_FindOverrideSurface(-1,g.mSlist); //reset the quick surface override lookup;
 		// recursively call the model surface transform
@@ -621,6 +1096,42 @@ void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale,
 	}
 }
 
+#ifdef _G2_GORE
+void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod, bool ApplyGore)
+{
+	g2LazyTransform.active = false;
+	G2_TransformModelSurfaces(ghoul2, frameNum, scale, G2VertSpace, useLod, ApplyGore, false);
+}
+#else
+void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod)
+{
+	g2LazyTransform.active = false;
+	G2_TransformModelSurfaces(ghoul2, frameNum, scale, G2VertSpace, useLod, false, false);
+}
+#endif
+
+// Sets the model up for a point trace without skinning anything it hasn't skinned yet this frame, G2_TraceModels
+// skins the vertices of the triangles it can't rule out through the bone trees. The trace has to follow straight
+// away, before the skeleton changes, and G2_EndLazyTransform has to come after it.
+void G2_TransformModelLazy(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod)
+{
+	int i;
+
+	g2LazyTransform.active = true;
+	g2LazyTransform.vertSpace = G2VertSpace;
+	for (i=0; i<3; i++)
+	{
+		g2LazyTransform.scale[i] = scale[i] ? scale[i] : 1.0f;
+	}
+
+	G2_TransformModelSurfaces(ghoul2, frameNum, scale, G2VertSpace, useLod, false, true);
+}
+
+void G2_EndLazyTransform(void)
+{
+	g2LazyTransform.active = false;
+}
+
 // work out how much space a triangle takes
 static float	G2_AreaOfTri(const vec3_t A, const vec3_t B, const vec3_t C)
 {
@@ -1042,14 +1553,45 @@ static SVertexTemp GoreVerts[MAX_GORE_VERTS];
 // now we're at poly level, check each model space transformed poly against the model world transfomed ray
 static bool G2_TracePolys(const mdxmSurface_t *surface, const mdxmSurfHierarchy_t *surfInfo, CTraceSurface &TS)
 {
-	int				j, numTris;
+	static int		candidates[SHADER_MAX_INDEXES / 3];
+	int				j, n, numTris;
+	const int		*triList = nullptr;
+	const float		*verts;
 
 	// whip through and actually transform each vertex
 	const mdxmTriangle_t *tris = (mdxmTriangle_t *) ((byte *)surface + surface->ofsTriangles);
-	const float *verts = (float *)TS.TransformedVertsArray[surface->thisSurfaceIndex];
 	numTris = surface->numTriangles;
-	for ( j = 0; j < numTris; j++ )
+	if (g2LazyTransform.active)
+	{
+		const g2ModelTrees_t *mt = TS.currentModel->g2Trees;
+		float *lazyVerts = G2_SurfaceVerts(surface, g2LazyTransform.vertSpace, TS.TransformedVertsArray);
+
+		if (mt)
+		{
+			numTris = G2_BoneTreeCandidates(surface, &mt->surfaces[TS.lod * mt->numSurfaces + surface->thisSurfaceIndex], TS, candidates);
+			triList = candidates;
+		}
+		for ( n = 0; n < numTris; n++ )
+		{
+			j = triList ? triList[n] : n;
+			G2_LazySkinVertex(surface, lazyVerts, tris[j].indexes[0], TS.boneCache);
+			G2_LazySkinVertex(surface, lazyVerts, tris[j].indexes[1], TS.boneCache);
+			G2_LazySkinVertex(surface, lazyVerts, tris[j].indexes[2], TS.boneCache);
+		}
+		verts = lazyVerts;
+	}
+	else
+	{
+		verts = (float *)TS.TransformedVertsArray[surface->thisSurfaceIndex];
+		if (!verts)
+		{
+			return false;
+		}
+	}
+
+	for ( n = 0; n < numTris; n++ )
 	{
+		j = triList ? triList[n] : n;
 		float			face;
 		vec3_t	hitPoint, normal;
 		// determine actual coords for this triangle
@@ -1531,6 +2073,7 @@ void G2_TraceModels(CGhoul2Info_v &ghoul2, vec3_t rayStart, vec3_t rayEnd, Colli
 #else
 		CTraceSurface TS(ghoul2[i].mSurfaceRoot, ghoul2[i].mSlist,  (model_t *)ghoul2[i].currentModel, lod, rayStart, rayEnd, collRecMap, entNum, i, skin, cust_shader, ghoul2[i].mTransformedVertsArray, eG2TraceType, fRadius);
 #endif
+		TS.boneCache = ghoul2[i].mBoneCache;
 		// start the surface recursion loop
 		G2_TraceSurfaces(TS);
 
@@ -3214,6 +3214,7 @@ bool R_LoadMDXM( model_t *mod, void *buffer, const char *mod_name, bool &bAlread
 
 	if (bAlreadyFound)
 	{
+		G2_BuildBoneTrees(mod);
 		return true;	// All done. Stop, go no further, do not LittleLong(), do not pass Go...
 	}
 
@@ -3305,6 +3306,8 @@ bool R_LoadMDXM( model_t *mod, void *buffer, const char *mod_name, bool &bAlread
 		// find the next LOD
 		lod = (mdxmLOD_t *)( (byte *)lod + lod->ofsEnd );
 	}
+
+	G2_BuildBoneTrees(mod);
 	return true;
 }
 
@@ -26,6 +26,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "qcommon/q_shared.h"
 #include "qcommon/q_common.h"
+#include "qcommon/com_demo.h"
 #include "game/g_public.h"
 #include "game/bg_public.h"
 #include "rd-common/tr_public.h"
@@ -51,12 +52,12 @@ enum clientState_e {
 struct svEntity_t {
 	struct worldSector_t *worldSector;
 	svEntity_t           *nextEntityInWorldSector;
+	svEntity_t          **areaGridCell; // list the entity is linked into with sv_broadphase 1
 	entityState_t         baseline; // for delta compression of initial sighting
 	int                   numClusters; // if -1, use headnode instead
 	int                   clusternums[MAX_ENT_CLUSTERS];
 	int                   lastCluster; // if all the clusters don't fit in clusternums
 	int                   areanum, areanum2;
-	int                   snapshotCounter; // used to prevent double adding from portal views
 };
 
 struct server_t {
@@ -65,10 +66,13 @@ struct server_t {
 	int             serverId; // changes each server start
 	int             restartedServerId; // serverId before a map_restart
 	int             checksumFeed; // 
-	int             snapshotCounter; // incremented for each snapshot built
 	int             timeResidual; // <= 1000 / sv_frame->value
 	int             nextFrameTime; // when time > nextFrameTime, process world
 	char           *configstrings[MAX_CONFIGSTRINGS];
+	bool            configstringDirty[MAX_CONFIGSTRINGS]; // changed since the last SV_FlushConfigstrings
+	int             dirtyConfigstrings[MAX_CONFIGSTRINGS]; // queue of changed indexes, in the order they were first changed
+	int             firstDirtyConfigstring;
+	int             numDirtyConfigstrings;
 	svEntity_t      svEntities[MAX_GENTITIES];
 	char           *entityParsePoint; // used during game VM init
 	sharedEntity_t *gentities; // the game virtual machine will update these on init and changes
@@ -96,17 +100,23 @@ struct clientSnapshot_t {
 #endif
 	int             num_entities;
 	int             first_entity; // into the circular sv_packet_entities[] the entities MUST be in increasing state number order, otherwise the delta compression will fail
-	int             messageSent; // time the message was transmitted
-	int             messageAcked; // time the message was acked
+	int             messageSent; // Sys_Milliseconds when the message was transmitted
+	int             messageAcked; // Sys_Milliseconds when the ack arrived
 	int             messageSize; // used to rate drop packets
 };
 
+struct svDownload_t;
+
 struct demoInfo_t {
 	char         demoName[MAX_OSPATH];
 	bool         demorecording;
 	bool         demowaiting; // don't record until a non-delta message is sent
 	int          minDeltaFrame; // the first non-delta frame stored in the demo.  cannot delta against frames older than this
 	fileHandle_t demofile;
+	demoWriter_t *writer; // non-null when recording an indexed demo
+	int          keyframeTime; // svs.time of the last keyframe written to an indexed demo
+	bool         keyframeWaiting; // the next snapshot stored is encoded non-delta for the demo alone
+	int          keyframeSequence; // that snapshot's message, the demo gets its own deltas until the client acks one from here on
 	bool         isBot;
 	int          botReliableAcknowledge; // for bots, need to maintain a separate reliableAcknowledge to record server messages into the demo file
 };
@@ -129,15 +139,10 @@ struct client_t {
 	sharedEntity_t   *gentity; // SV_GentityNum(clientnum)
 	char              name[MAX_NAME_LENGTH]; // extracted from userinfo, high bits masked
 	char              downloadName[MAX_QPATH]; // if not empty string, we are downloading
-	fileHandle_t      download; // file being downloaded
+	svDownload_t     *download; // file being downloaded, opened once and shared with other clients downloading it
 	int               downloadSize; // total bytes (can't use EOF because of paks)
-	int               downloadCount; // bytes sent
 	int               downloadClientBlock; // last block we sent to the client, awaiting ack
-	int               downloadCurrentBlock; // current block number
 	int               downloadXmitBlock; // last block we xmited
-	unsigned char    *downloadBlocks[MAX_DOWNLOAD_WINDOW]; // the buffers for the download blocks
-	int               downloadBlockSize[MAX_DOWNLOAD_WINDOW];
-	bool              downloadEOF; // We have sent the EOF block
 	int               downloadSendTime; // time we last got an ack from the client
 	int               deltaMessage; // frame last client usercmd message
 	int               lastReliableTime; // svs.time when reliable command was last received
@@ -168,13 +173,15 @@ struct serverStatic_t {
 	time_t         startTime; // time since epoch the executable was started
 	int            snapFlagServerBit; // ^= SNAPFLAG_SERVERCOUNT every SV_SpawnServer()
 	client_t      *clients; // [sv_maxclients->integer];
-	int            numSnapshotEntities; // sv_maxclients->integer*PACKET_BACKUP*MAX_SNAPSHOT_ENTITIES
+	int            numSnapshotEntities; // deltaSnapshotEntities + sv_maxclients->integer*MAX_SNAPSHOT_ENTITIES
+	int            deltaSnapshotEntities; // how far back a delta may reach, sv_maxclients->integer*PACKET_BACKUP*MAX_SNAPSHOT_ENTITIES
 	int            nextSnapshotEntities; // next snapshotEntities to use
 	entityState_t *snapshotEntities; // [numSnapshotEntities]
 	int            nextHeartbeatTime;
 	netadr_t       redirectAddress; // for rcon return messages
 	netadr_t       authorizeAddress; // for rcon return messages
 	bool           gameStarted; // gvm is loaded
+	int            serverinfoModificationCount; // bumped whenever CS_SERVERINFO changes
 };
 
 // Structure for managing bans
@@ -188,6 +195,7 @@ struct leakyBucket_t {
 	netadrtype_e   type;
 	union {
 		byte _4[4];
+		byte _6[16];
 	} ipv;
 	int            lastTime;
 	signed char    burst;
@@ -240,6 +248,7 @@ void            SV_ExecuteClientCommand        ( client_t *cl, const char *s, bo
 void            SV_ExecuteClientMessage        ( client_t *cl, msg_t *msg );
 char           *SV_ExpandNewlines              ( char *in );
 void            SV_FinalMessage                ( char *message );
+void            SV_FlushConfigstrings          ( void );
 playerState_t  *SV_GameClientNum               ( int num );
 sharedEntity_t *SV_GEntityForSvEntity          ( svEntity_t *svEnt );
 sharedEntity_t *SV_GentityNum                  ( int num );
@@ -251,6 +260,7 @@ void            SV_Heartbeat_f                 ( void );
 void            SV_InitGameProgs               ( void );
 bool            SV_inPVS                       ( const vec3_t p1, const vec3_t p2 );
 void            SV_LinkEntity                  ( sharedEntity_t *ent );
+void            SV_MarkClusterEntities         ( const byte *pvs, byte *entityBits );
 void            SV_MasterHeartbeat             ( void );
 void            SV_MasterShutdown              ( void );
 bool            SV_Netchan_Process             ( client_t *client, msg_t *msg );
@@ -260,12 +270,13 @@ int             SV_NumForGentity               ( sharedEntity_t *ent );
 int             SV_PointContents               ( const vec3_t p, int passEntityNum );
 void            SV_RecordDemo                  ( client_t *cl, char *demoName );
 void            SV_RemoveOperatorCommands      ( void );
+void            SV_ResetQueryCache             ( void );
 void            SV_SectorList_f                ( void );
 void            SV_SendClientGameState         ( client_t *client );
 void            SV_SendClientMapChange         ( client_t *client );
 void            SV_SendClientMessages          ( void );
 void            SV_SendClientSnapshot          ( client_t *client );
-void            SV_SendMessageToClient         ( msg_t *msg, client_t *client );
+void            SV_SendMessageToClient         ( msg_t *msg, client_t *client, msg_t *demoMsg = nullptr );
 void            SV_SendServerCommand           ( client_t *cl, const char *fmt, ...);
 void            SV_SetConfigstring             ( int index, const char *val );
 void            SV_SetUserinfo                 ( int index, const char *val );
@@ -274,6 +285,7 @@ void            SV_StopAutoRecordDemos         ( void );
 void            SV_StopRecordDemo              ( client_t *cl );
 svEntity_t     *SV_SvEntityForGentity          ( sharedEntity_t *gEnt );
 void            SV_Trace                       ( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod );
+void            SV_TraceBatch                  ( trace_t *results, const traceRequest_t *requests, int count );
 void            SV_UnlinkEntity                ( sharedEntity_t *ent );
 void            SV_UpdateConfigstrings         ( client_t *client );
 void            SV_UpdateServerCommandsToClient( client_t *client, msg_t *msg );
@@ -290,6 +290,9 @@ static void SV_MapRestart_f( void ) {
 	sv.state = SS_GAME;
 	sv.restarting = false;
 
+	// configstrings changed by the restart go out ahead of the map_restart command
+	SV_FlushConfigstrings();
+
 	// connect and begin all the clients
 	for (i=0 ; i<sv_maxclients->integer ; i++) {
 		client = &svs.clients[i];
@@ -572,6 +575,11 @@ static void SV_RehashBans_f( void )
 				{
 					serverBans[index].subnet = 32;
 				}
+				else if ( serverBans[index].ip.type == NA_IP6 &&
+					(serverBans[index].subnet < 1 || serverBans[index].subnet > 128) )
+				{
+					serverBans[index].subnet = 128;
+				}
 			}
 
 			curpos = newlinepos + 1;
@@ -653,12 +661,15 @@ static bool SV_ParseCIDRNotation( netadr_t *dest, int *mask, char *adrstr )
 				*mask = 32;
 		}
 		else
-			*mask = 32;
+		{
+			if ( *mask < 1 || *mask > 128 )
+				*mask = 128;
+		}
 	}
-	//else if ( dest->type == NA_IP )
-	//	*mask = 32;
-	else
+	else if ( dest->type == NA_IP )
 		*mask = 32;
+	else
+		*mask = 128;
 
 	return false;
 }
@@ -694,7 +705,7 @@ static void SV_AddBanToList( bool isexception )
 
 	banstring = Cmd_Argv( 1 );
 
-	if ( strchr( banstring, '.' ) /*|| strchr( banstring, ':' )*/ )
+	if ( strchr( banstring, '.' ) || strchr( banstring, ':' ) )
 	{
 		// This is an ip address, not a client num.
 
@@ -730,13 +741,18 @@ static void SV_AddBanToList( bool isexception )
 					mask = 32;
 			}
 			else
-				mask = 32;
+			{
+				if ( mask < 1 || mask > 128 )
+					mask = 128;
+			}
 		}
-		else
+		else if ( ip.type == NA_IP )
 			mask = 32;
+		else
+			mask = 128;
 	}
 
-	if ( ip.type != NA_IP )
+	if ( ip.type != NA_IP && ip.type != NA_IP6 )
 	{
 		Com_Printf( "Error: Can ban players connected via the internet only.\n" );
 		return;
@@ -1360,9 +1376,42 @@ static void SV_KillServer_f( void ) {
 	SV_Shutdown( "killserver" );
 }
 
+// builds the message a demo starts with, without taking the pending server commands off the client
+static void SV_CreateDemoGameStateMessage( client_t *cl, msg_t *msg ) {
+	// NOTE, MRE: all server->client messages now acknowledge
+	int tmp = cl->reliableSent;
+	SV_CreateClientGameStateMessage( cl, msg );
+	cl->reliableSent = tmp;
+
+	// finished writing the client packet
+	MSG_WriteByte( msg, svc_EOF );
+}
+
+// writes a gamestate playback can start from, the snapshot stored after it has to be non-delta compressed
+static void SV_WriteDemoKeyframe( client_t *cl, int sequence ) {
+	byte		bufData[MAX_MSGLEN];
+	msg_t		msg;
+
+	MSG_Init( &msg, bufData, sizeof( bufData ) );
+	SV_CreateDemoGameStateMessage( cl, &msg );
+	Demo_WriteGamestate( cl->demo.writer, svs.time, sequence, msg.data, msg.cursize );
+
+	cl->demo.keyframeTime = svs.time;
+}
+
 void SV_WriteDemoMessage ( client_t *cl, msg_t *msg, int headerBytes ) {
 	int		len, swlen;
 
+	if ( cl->demo.writer ) {
+		Demo_WriteMessage( cl->demo.writer, cl->netchan.outgoingSequence, msg->data + headerBytes, msg->cursize - headerBytes );
+		if ( sv_demoKeyframes->integer > 0 && svs.time - cl->demo.keyframeTime >= sv_demoKeyframes->integer * 1000 ) {
+			SV_WriteDemoKeyframe( cl, cl->netchan.outgoingSequence );
+			// the demo gets a snapshot of its own, the client keeps delta compressing against what it acked
+			cl->demo.keyframeWaiting = true;
+		}
+		return;
+	}
+
 	// write the packet sequence
 	len = cl->netchan.outgoingSequence;
 	swlen = LittleLong( len );
@@ -1384,9 +1433,14 @@ void SV_StopRecordDemo( client_t *cl ) {
 	}
 
 	// finish up
-	len = -1;
-	FS_Write (&len, 4, cl->demo.demofile);
-	FS_Write (&len, 4, cl->demo.demofile);
+	if ( cl->demo.writer ) {
+		Demo_EndWrite( cl->demo.writer );
+		cl->demo.writer = nullptr;
+	} else {
+		len = -1;
+		FS_Write (&len, 4, cl->demo.demofile);
+		FS_Write (&len, 4, cl->demo.demofile);
+	}
 	FS_FCloseFile (cl->demo.demofile);
 	cl->demo.demofile = 0;
 	cl->demo.demorecording = false;
@@ -1441,11 +1495,20 @@ void SV_DemoFilename( char *buf, int bufSize ) {
 	Com_sprintf( buf, bufSize, "demo%s", timeStr );
 }
 
+// The file a demo of that name is recorded to, keyframed demos have their own extension
+static bool SV_DemoPath( char *name, int nameSize, const char *demoName ) {
+	const bool indexed = sv_demoKeyframes->integer > 0;
+
+	Com_sprintf( name, nameSize, "demos/%s.%s_%d", demoName, indexed ? DEMO_INDEXED_EXT : "dm", PROTOCOL_VERSION );
+	return indexed;
+}
+
 void SV_RecordDemo( client_t *cl, char *demoName ) {
 	char		name[MAX_OSPATH];
 	byte		bufData[MAX_MSGLEN];
 	msg_t		msg;
 	int			len;
+	bool		indexed;
 
 	if ( cl->demo.demorecording ) {
 		Com_Printf( "Already recording.\n" );
@@ -1459,9 +1522,10 @@ void SV_RecordDemo( client_t *cl, char *demoName ) {
 
 	// open the demo file
 	Q_strncpyz( cl->demo.demoName, demoName, sizeof( cl->demo.demoName ) );
-	Com_sprintf( name, sizeof( name ), "demos/%s.dm_%d", cl->demo.demoName, PROTOCOL_VERSION );
+	indexed = SV_DemoPath( name, sizeof( name ), cl->demo.demoName );
 	Com_Printf( "recording to %s.\n", name );
-	cl->demo.demofile = FS_FOpenFileWrite( name );
+	// demo files are written from a background thread so a slow disk doesn't hold up the frame
+	cl->demo.demofile = FS_FOpenFileWriteAsync( name );
 	if ( !cl->demo.demofile ) {
 		Com_Printf ("ERROR: couldn't open.\n");
 		return;
@@ -1470,20 +1534,21 @@ void SV_RecordDemo( client_t *cl, char *demoName ) {
 
 	// don't start saving messages until a non-delta compressed message is received
 	cl->demo.demowaiting = true;
+	cl->demo.keyframeWaiting = false;
+	cl->demo.keyframeSequence = 0;
 
 	cl->demo.isBot = ( cl->netchan.remoteAddress.type == NA_BOT ) ? true : false;
 	cl->demo.botReliableAcknowledge = cl->reliableSent;
 
+	if ( indexed ) {
+		cl->demo.writer = Demo_BeginWrite( cl->demo.demofile );
+		SV_WriteDemoKeyframe( cl, cl->netchan.outgoingSequence - 1 );
+		return;
+	}
+
 	// write out the gamestate message
 	MSG_Init( &msg, bufData, sizeof( bufData ) );
-
-	// NOTE, MRE: all server->client messages now acknowledge
-	int tmp = cl->reliableSent;
-	SV_CreateClientGameStateMessage( cl, &msg );
-	cl->reliableSent = tmp;
-
-	// finished writing the client packet
-	MSG_WriteByte( &msg, svc_EOF );
+	SV_CreateDemoGameStateMessage( cl, &msg );
 
 	// write it to the demo file
 	len = LittleLong( cl->netchan.outgoingSequence - 1 );
@@ -1711,12 +1776,12 @@ static void SV_Record_f( void ) {
 	if ( Cmd_Argc() >= 2 ) {
 		s = Cmd_Argv( 1 );
 		Q_strncpyz( demoName, s, sizeof( demoName ) );
-		Com_sprintf( name, sizeof( name ), "demos/%s.dm_%d", demoName, PROTOCOL_VERSION );
+		SV_DemoPath( name, sizeof( name ), demoName );
 	} else {
 		// timestamp the file
 		SV_DemoFilename( demoName, sizeof( demoName ) );
 
-		Com_sprintf (name, sizeof(name), "demos/%s.dm_%d", demoName, PROTOCOL_VERSION );
+		SV_DemoPath( name, sizeof( name ), demoName );
 
 		if ( FS_FileExists( name ) ) {
 			Com_Printf( "Record: Couldn't create a file\n");
@@ -1751,7 +1816,7 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_AddCommand ("systeminfo", SV_Systeminfo_f, "Prints the systeminfo variables that are replicated to clients" );
 	Cmd_AddCommand ("dumpuser", SV_DumpUser_f, "Prints the userinfo for a given userid" );
 	Cmd_AddCommand ("map_restart", SV_MapRestart_f, "Restart the current map" );
-	Cmd_AddCommand ("sectorlist", SV_SectorList_f);
+	Cmd_AddCommand ("sectorlist", SV_SectorList_f, "Prints the entity broadphase contents and area query cost since the last call" );
 	Cmd_AddCommand ("map", SV_Map_f, "Load a new map with cheats disabled" );
 	Cmd_SetCommandCompletionFunc( "map", SV_CompleteMapName );
 	Cmd_AddCommand ("devmap", SV_Map_f, "Load a new map with cheats enabled" );
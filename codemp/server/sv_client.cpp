@@ -533,25 +533,72 @@ void SV_ClientEnterWorld( client_t *client, usercmd_t *cmd ) {
 
 // CLIENT COMMAND EXECUTION
 
+#define MAX_DOWNLOAD_FILES	16
+
+// files being downloaded, each opened once however many clients are downloading it
+struct svDownload_t {
+	char			name[MAX_QPATH];
+	sysSharedFile_t	*file;
+	int				size;
+	int				users;
+};
+
+static svDownload_t svDownloads[MAX_DOWNLOAD_FILES];
+
+static svDownload_t *SV_OpenDownload( const char *name ) {
+	svDownload_t *dl, *unused = nullptr;
+
+	for ( dl = svDownloads ; dl < svDownloads + MAX_DOWNLOAD_FILES ; dl++ ) {
+		if ( !dl->users ) {
+			if ( !unused ) {
+				unused = dl;
+			}
+		} else if ( !Q_stricmp( dl->name, name ) ) {
+			dl->users++;
+			return dl;
+		}
+	}
+
+	if ( !unused ) {
+		Com_Printf( "clientDownload: already sending %d different files\n", MAX_DOWNLOAD_FILES );
+		return nullptr;
+	}
+	unused->file = FS_SV_OpenSharedFile( name, &unused->size );
+	if ( !unused->file ) {
+		return nullptr;
+	}
+	Q_strncpyz( unused->name, name, sizeof( unused->name ) );
+	unused->users = 1;
+	return unused;
+}
+
+static void SV_ReleaseDownload( svDownload_t *dl ) {
+	if ( --dl->users == 0 ) {
+		Sys_CloseSharedFile( dl->file );
+		dl->file = nullptr;
+	}
+}
+
+// The file goes out in full blocks followed by a short one, then a zero-length block marks the end
+static int SV_DownloadEOFBlock( const client_t *cl ) {
+	return ( cl->downloadSize + MAX_DOWNLOAD_BLKSIZE - 1 ) / MAX_DOWNLOAD_BLKSIZE;
+}
+
+static int SV_DownloadBlockSize( const client_t *cl, int block ) {
+	if ( block >= SV_DownloadEOFBlock( cl ) ) {
+		return 0;
+	}
+	return Q_min( MAX_DOWNLOAD_BLKSIZE, cl->downloadSize - block * MAX_DOWNLOAD_BLKSIZE );
+}
+
 // clear/free any download vars
 static void SV_CloseDownload( client_t *cl ) {
-	int i;
-
 	// EOF
 	if (cl->download) {
-		FS_FCloseFile( cl->download );
+		SV_ReleaseDownload( cl->download );
 	}
-	cl->download = 0;
+	cl->download = nullptr;
 	*cl->downloadName = 0;
-
-	// Free the temporary buffer space
-	for (i = 0; i < MAX_DOWNLOAD_WINDOW; i++) {
-		if (cl->downloadBlocks[i]) {
-			Z_Free( cl->downloadBlocks[i] );
-			cl->downloadBlocks[i] = nullptr;
-		}
-	}
-
 }
 
 // Abort a download if in progress
@@ -587,7 +634,7 @@ static void SV_NextDownload_f( client_t *cl )
 		Com_DPrintf( "clientDownload: %d : client acknowledge of block %d\n", cl - svs.clients, block );
 
 		// Find out if we are done.  A zero-length block indicates EOF
-		if (cl->downloadBlockSize[cl->downloadClientBlock % MAX_DOWNLOAD_WINDOW] == 0) {
+		if (!cl->download || cl->downloadClientBlock == SV_DownloadEOFBlock( cl )) {
 			Com_Printf( "clientDownload: %d : file \"%s\" completed\n", cl - svs.clients, cl->downloadName );
 			SV_CloseDownload( cl );
 			return;
@@ -620,6 +667,8 @@ static void SV_BeginDownload_f( client_t *cl ) {
 void SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 {
 	int curindex;
+	int currentBlock, blockSize, readSize;
+	byte block[MAX_DOWNLOAD_BLKSIZE];
 	int rate;
 	int blockspersnap;
 	int unreferenced = 1;
@@ -671,12 +720,10 @@ void SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 			}
 		}
 
-		cl->download = 0;
-
 		// We open the file here
 		if ( !sv_allowDownload->integer ||
 			idPack || unreferenced ||
-			( cl->downloadSize = FS_SV_FOpenFileRead( cl->downloadName, &cl->download ) ) < 0 ) {
+			!( cl->download = SV_OpenDownload( cl->downloadName ) ) ) {
 			// cannot auto-download file
 			if(unreferenced)
 			{
@@ -720,53 +767,19 @@ void SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 
 			*cl->downloadName = 0;
 
-			if(cl->download)
-				FS_FCloseFile(cl->download);
-
 			return;
 		}
 
 		Com_Printf( "clientDownload: %d : beginning \"%s\"\n", (int) (cl - svs.clients), cl->downloadName );
 
 		// Init
-		cl->downloadCurrentBlock = cl->downloadClientBlock = cl->downloadXmitBlock = 0;
-		cl->downloadCount = 0;
-		cl->downloadEOF = false;
-	}
-
-	// Perform any reads that we need to
-	while (cl->downloadCurrentBlock - cl->downloadClientBlock < MAX_DOWNLOAD_WINDOW &&
-		cl->downloadSize != cl->downloadCount) {
-
-		curindex = (cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW);
-
-		if (!cl->downloadBlocks[curindex])
-			cl->downloadBlocks[curindex] = (unsigned char *)Z_Malloc( MAX_DOWNLOAD_BLKSIZE, TAG_DOWNLOAD, true );
-
-		cl->downloadBlockSize[curindex] = FS_Read( cl->downloadBlocks[curindex], MAX_DOWNLOAD_BLKSIZE, cl->download );
-
-		if (cl->downloadBlockSize[curindex] < 0) {
-			// EOF right now
-			cl->downloadCount = cl->downloadSize;
-			break;
-		}
-
-		cl->downloadCount += cl->downloadBlockSize[curindex];
-
-		// Load in next block
-		cl->downloadCurrentBlock++;
+		cl->downloadSize = cl->download->size;
+		cl->downloadClientBlock = cl->downloadXmitBlock = 0;
 	}
 
-	// Check to see if we have eof condition and add the EOF block
-	if (cl->downloadCount == cl->downloadSize &&
-		!cl->downloadEOF &&
-		cl->downloadCurrentBlock - cl->downloadClientBlock < MAX_DOWNLOAD_WINDOW) {
-
-		cl->downloadBlockSize[cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW] = 0;
-		cl->downloadCurrentBlock++;
-
-		cl->downloadEOF = true;  // We have added the EOF block
-	}
+	// blocks are read from the shared file as they go out, so the window is just the next few after the last ack
+	// including the EOF block
+	currentBlock = Q_min( cl->downloadClientBlock + MAX_DOWNLOAD_WINDOW, SV_DownloadEOFBlock( cl ) + 1 );
 
 	// Loop up to window size times based on how many blocks we can fit in the
 	// client snapMsec and rate
@@ -798,10 +811,10 @@ void SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 		// Write out the next section of the file, if we have already reached our window,
 		// automatically start retransmitting
 
-		if (cl->downloadClientBlock == cl->downloadCurrentBlock)
+		if (cl->downloadClientBlock == currentBlock)
 			return; // Nothing to transmit
 
-		if (cl->downloadXmitBlock == cl->downloadCurrentBlock) {
+		if (cl->downloadXmitBlock == currentBlock) {
 			// We have transmitted the complete window, should we start resending?
 
 			//FIXME:  This uses a hardcoded one second timeout for lost blocks
@@ -813,7 +826,7 @@ void SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 		}
 
 		// Send current block
-		curindex = (cl->downloadXmitBlock % MAX_DOWNLOAD_WINDOW);
+		blockSize = SV_DownloadBlockSize( cl, cl->downloadXmitBlock );
 
 		MSG_WriteByte( msg, svc_download );
 		MSG_WriteShort( msg, cl->downloadXmitBlock );
@@ -822,11 +835,17 @@ void SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 		if ( cl->downloadXmitBlock == 0 )
 			MSG_WriteLong( msg, cl->downloadSize );
 
-		MSG_WriteShort( msg, cl->downloadBlockSize[curindex] );
+		MSG_WriteShort( msg, blockSize );
 
 		// Write the block
-		if ( cl->downloadBlockSize[curindex] ) {
-			MSG_WriteData( msg, cl->downloadBlocks[curindex], cl->downloadBlockSize[curindex] );
+		if ( blockSize ) {
+			// a file cut short since it was opened is padded out, the client's checksum will throw it away
+			readSize = Sys_ReadSharedFile( cl->download->file, cl->downloadXmitBlock * MAX_DOWNLOAD_BLKSIZE, block, blockSize );
+			if ( readSize != blockSize ) {
+				Com_Printf( "clientDownload: %d : \"%s\" couldn't be read\n", (int) (cl - svs.clients), cl->downloadName );
+				memset( block + readSize, 0, blockSize - readSize );
+			}
+			MSG_WriteData( msg, block, blockSize );
 		}
 
 		Com_DPrintf( "clientDownload: %d : writing block %d\n", (int) (cl - svs.clients), cl->downloadXmitBlock );
@@ -1279,8 +1298,8 @@ static void SV_UserMove( client_t *cl, msg_t *msg, bool delta ) {
 		oldcmd = cmd;
 	}
 
-	// save time for ping calculation
-	cl->frames[ cl->messageAcknowledge & PACKET_MASK ].messageAcked = svs.time;
+	// save time for ping calculation, from when the packet arrived rather than when the frame got to it
+	cl->frames[ cl->messageAcknowledge & PACKET_MASK ].messageAcked = msg->time ? msg->time : Sys_Milliseconds();
 
 	// TTimo
 	// catch the no-cp-yet situation before SV_ClientEnterWorld
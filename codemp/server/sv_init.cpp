@@ -34,10 +34,12 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "server/sv_gameapi.h"
 
 // Creates and sends the server command necessary to update the CS index for the given client
+// Queued directly rather than through SV_SendServerCommand, which would flush pending configstrings again
 static void SV_SendConfigstring(client_t *client, int index)
 {
 	int maxChunkSize = MAX_STRING_CHARS - 24;
 	int len;
+	char msg[MAX_STRING_CHARS];
 
 	len = strlen(sv.configstrings[index]);
 
@@ -60,16 +62,18 @@ static void SV_SendConfigstring(client_t *client, int index)
 			Q_strncpyz( buf, &sv.configstrings[index][sent],
 				maxChunkSize );
 
-			SV_SendServerCommand( client, "%s %i \"%s\"\n", cmd,
+			Com_sprintf( msg, sizeof( msg ), "%s %i \"%s\"\n", cmd,
 				index, buf );
+			SV_AddServerCommand( client, msg );
 
 			sent += (maxChunkSize - 1);
 			remaining -= (maxChunkSize - 1);
 		}
 	} else {
 		// standard cs, just send it
-		SV_SendServerCommand( client, "cs %i \"%s\"\n", index,
+		Com_sprintf( msg, sizeof( msg ), "cs %i \"%s\"\n", index,
 			sv.configstrings[index] );
+		SV_AddServerCommand( client, msg );
 	}
 }
 
@@ -95,9 +99,6 @@ void SV_UpdateConfigstrings(client_t *client)
 }
 
 void SV_SetConfigstring (int index, const char *val) {
-	int		i;
-	client_t	*client;
-
 	if ( index < 0 || index >= MAX_CONFIGSTRINGS ) {
 		Com_Error (ERR_DROP, "SV_SetConfigstring: bad index %i\n", index);
 	}
@@ -115,11 +116,33 @@ void SV_SetConfigstring (int index, const char *val) {
 	Z_Free( sv.configstrings[index] );
 	sv.configstrings[index] = CopyString( val );
 
-	// send it to all the clients if we aren't
-	// spawning a new server
+	if ( index == CS_SERVERINFO ) {
+		svs.serverinfoModificationCount++;
+	}
+
+	// send it to all the clients if we aren't spawning a new server
+	// the game often sets the same index several times a frame, so only the last value goes out
 	if ( sv.state == SS_GAME || sv.restarting ) {
+		if ( !sv.configstringDirty[index] ) {
+			sv.configstringDirty[index] = true;
+			sv.dirtyConfigstrings[( sv.firstDirtyConfigstring + sv.numDirtyConfigstrings++ ) % MAX_CONFIGSTRINGS] = index;
+		}
+	}
+}
+
+// Sends the configstrings changed since the last flush to all relevent clients.
+// Called once a frame before snapshots go out, and before any other server command so clients see them in order
+void SV_FlushConfigstrings( void ) {
+	int			i, index;
+	client_t	*client;
+
+	// an index is queued at most once, so changes made while flushing (the game reacting to a dropped client) fit
+	while ( sv.numDirtyConfigstrings ) {
+		index = sv.dirtyConfigstrings[sv.firstDirtyConfigstring];
+		sv.firstDirtyConfigstring = ( sv.firstDirtyConfigstring + 1 ) % MAX_CONFIGSTRINGS;
+		sv.numDirtyConfigstrings--;
+		sv.configstringDirty[index] = false;
 
-		// send the data to all relevent clients
 		for (i = 0, client = svs.clients; i < sv_maxclients->integer ; i++, client++) {
 			if ( client->state < CS_ACTIVE ) {
 				if ( client->state == CS_PRIMED )
@@ -211,14 +234,16 @@ void SV_Startup( void ) {
 
 	svs.clients = (client_t *)Z_Malloc (sizeof(client_t) * sv_maxclients->integer, TAG_CLIENTS, true );
 	if ( dedicated->integer ) {
-		svs.numSnapshotEntities = sv_maxclients->integer * PACKET_BACKUP * MAX_SNAPSHOT_ENTITIES;
+		svs.deltaSnapshotEntities = sv_maxclients->integer * PACKET_BACKUP * MAX_SNAPSHOT_ENTITIES;
 		Cvar_Set( "r_Ghoul2AnimSmooth", "0");
 		Cvar_Set( "r_Ghoul2UnSqashAfterSmooth", "0");
 
 	} else {
 		// we don't need nearly as many when playing locally
-		svs.numSnapshotEntities = sv_maxclients->integer * 4 * MAX_SNAPSHOT_ENTITIES;
+		svs.deltaSnapshotEntities = sv_maxclients->integer * 4 * MAX_SNAPSHOT_ENTITIES;
 	}
+	// one frame more than deltas reach, so the job threads can copy in every client before any is encoded
+	svs.numSnapshotEntities = svs.deltaSnapshotEntities + sv_maxclients->integer * MAX_SNAPSHOT_ENTITIES;
 	SV_ChallengeInit();
 	svs.initialized = true;
 
@@ -291,11 +316,12 @@ void SV_ChangeMaxClients( void ) {
 
 	// allocate new snapshot entities
 	if ( dedicated->integer ) {
-		svs.numSnapshotEntities = sv_maxclients->integer * PACKET_BACKUP * MAX_SNAPSHOT_ENTITIES;
+		svs.deltaSnapshotEntities = sv_maxclients->integer * PACKET_BACKUP * MAX_SNAPSHOT_ENTITIES;
 	} else {
 		// we don't need nearly as many when playing locally
-		svs.numSnapshotEntities = sv_maxclients->integer * 4 * MAX_SNAPSHOT_ENTITIES;
+		svs.deltaSnapshotEntities = sv_maxclients->integer * 4 * MAX_SNAPSHOT_ENTITIES;
 	}
+	svs.numSnapshotEntities = svs.deltaSnapshotEntities + sv_maxclients->integer * MAX_SNAPSHOT_ENTITIES;
 }
 
 void SV_ClearServer(void) {
@@ -460,6 +486,7 @@ void SV_SpawnServer( char *server, bool killBots, ForceReload_e eForceReload ) {
 
 	// wipe the entire per-level structure
 	SV_ClearServer();
+	SV_ResetQueryCache();
 	for ( i = 0 ; i < MAX_CONFIGSTRINGS ; i++ ) {
 		sv.configstrings[i] = CopyString("");
 	}
@@ -647,7 +674,7 @@ void SV_SpawnServer( char *server, bool killBots, ForceReload_e eForceReload ) {
 
 #ifdef DEDICATED
 
-#define G2_VERT_SPACE_SERVER_SIZE 256
+#define G2_VERT_SPACE_SERVER_SIZE 2048
 IHeapAllocator *G2VertSpaceServer = nullptr;
 CMiniHeap IHeapAllocator_singleton(G2_VERT_SPACE_SERVER_SIZE * 1024);
 
@@ -865,6 +892,7 @@ void SV_Shutdown( char *finalmsg )
 		Z_Free( svs.clients );
 	}
 	Com_Memset( &svs, 0, sizeof( svs ) );
+	SV_ResetQueryCache();
 
 	Cvar_Set( "sv_running", "0" );
 
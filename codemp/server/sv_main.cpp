@@ -107,6 +107,9 @@ void QDECL SV_SendServerCommand(client_t *cl, const char *fmt, ...) {
 		return;
 	}
 
+	// pending configstrings were changed first, so they go first
+	SV_FlushConfigstrings();
+
 	if ( cl != nullptr ) {
 		SV_AddServerCommand( cl, (char *)message );
 		return;
@@ -229,6 +232,7 @@ static long SVC_HashForAddress( netadr_t address ) {
 
 	switch ( address.type ) {
 		case NA_IP:  ip = address.ip;  size = 4; break;
+		case NA_IP6: ip = address.ip6; size = 8; break; // one bucket per /64, a host usually owns the whole prefix
 		default: break;
 	}
 
@@ -257,6 +261,12 @@ static leakyBucket_t *SVC_BucketForAddress( netadr_t address, int burst, int per
 				}
 				break;
 
+			case NA_IP6:
+				if ( memcmp( bucket->ipv._6, address.ip6, 8 ) == 0 ) {
+					return bucket;
+				}
+				break;
+
 			default:
 				break;
 		}
@@ -288,6 +298,7 @@ static leakyBucket_t *SVC_BucketForAddress( netadr_t address, int burst, int per
 			bucket->type = address.type;
 			switch ( address.type ) {
 				case NA_IP:  Com_Memcpy( bucket->ipv._4, address.ip, 4 );   break;
+				case NA_IP6: Com_Memcpy( bucket->ipv._6, address.ip6, 16 ); break;
 				default: break;
 			}
 
@@ -344,17 +355,191 @@ bool SVC_RateLimitAddress( netadr_t from, int burst, int period ) {
 	return SVC_RateLimit( bucket, burst, period );
 }
 
+// getinfo/getstatus replies
+// Browsers and master list scrapers poll these constantly, so the replies are kept and only rebuilt once the
+// serverinfo or what they report about the players has changed. The challenge is spliced in per request.
+
+// what the replies report about a client, to tell when they went stale
+struct svQueryClient_t {
+	bool	connected;
+	bool	bot;
+	int		score;
+	int		ping;
+	char	name[MAX_NAME_LENGTH];
+};
+
+struct svQueryCache_t {
+	int				serverinfoModificationCount;	// of svs when last checked
+	bool			infoStale;
+	bool			statusStale;
+	svQueryClient_t	clients[MAX_CLIENTS];
+	char			info[MAX_INFO_STRING];			// infoResponse keys, the challenge goes last
+	int				infoLength;
+	char			status[MAX_MSGLEN];				// serverinfo, a newline and a line per player
+	int				statusLength;
+	int				serverinfoLength;
+};
+
+static svQueryCache_t	svQuery;
+static char				svQueryReply[MAX_MSGLEN];
+
+// svs is cleared on shutdown, which resets the serverinfo modification count the cache goes by
+void SV_ResetQueryCache( void ) {
+	Com_Memset( &svQuery, 0, sizeof( svQuery ) );
+	svQuery.infoStale = svQuery.statusStale = true;
+}
+
+// Marks the replies stale if anything they report has changed since they were built
+static void SVC_CheckQueryCache( void ) {
+	svQueryClient_t	*qc;
+	client_t		*cl;
+	bool			connected, bot;
+	int				i, score;
+
+	if ( svQuery.serverinfoModificationCount != svs.serverinfoModificationCount ) {
+		svQuery.serverinfoModificationCount = svs.serverinfoModificationCount;
+		svQuery.infoStale = svQuery.statusStale = true;
+	}
+
+	for ( i = 0 ; i < sv_maxclients->integer ; i++ ) {
+		cl = &svs.clients[i];
+		qc = &svQuery.clients[i];
+
+		connected = cl->state >= CS_CONNECTED;
+		bot = cl->netchan.remoteAddress.type == NA_BOT;
+		if ( connected != qc->connected || bot != qc->bot ) {
+			qc->connected = connected;
+			qc->bot = bot;
+			svQuery.infoStale = svQuery.statusStale = true;
+		}
+		if ( !connected ) {
+			continue;
+		}
+
+		score = SV_GameClientNum( i )->persistant[PERS_SCORE];
+		if ( score != qc->score || cl->ping != qc->ping || strcmp( cl->name, qc->name ) ) {
+			qc->score = score;
+			qc->ping = cl->ping;
+			Q_strncpyz( qc->name, cl->name, sizeof( qc->name ) );
+			svQuery.statusStale = true;
+		}
+	}
+}
+
+static void SVC_BuildStatus( void ) {
+	char	player[1024];
+	int		i, playerLength;
+
+	Q_strncpyz( svQuery.status, sv.configstrings[CS_SERVERINFO], MAX_INFO_STRING );
+	svQuery.serverinfoLength = strlen( svQuery.status );
+	svQuery.status[svQuery.serverinfoLength] = '\n';
+	svQuery.statusLength = svQuery.serverinfoLength + 1;
+
+	for ( i = 0 ; i < sv_maxclients->integer ; i++ ) {
+		if ( !svQuery.clients[i].connected ) {
+			continue;
+		}
+		Com_sprintf( player, sizeof( player ), "%i %i \"%s\"\n",
+			svQuery.clients[i].score, svQuery.clients[i].ping, svQuery.clients[i].name );
+		playerLength = strlen( player );
+		if ( svQuery.statusLength + playerLength >= (int)sizeof( svQuery.status ) ) {
+			break;		// can't hold any more
+		}
+		memcpy( svQuery.status + svQuery.statusLength, player, playerLength );
+		svQuery.statusLength += playerLength;
+	}
+	svQuery.status[svQuery.statusLength] = '\0';
+
+	svQuery.statusStale = false;
+}
+
+static void SVC_BuildInfo( void ) {
+	int		i, count, humans, wDisable;
+	char	*infostring = svQuery.info;
+
+	// don't count privateclients
+	count = humans = 0;
+	for ( i = sv_privateClients->integer ; i < sv_maxclients->integer ; i++ ) {
+		if ( svQuery.clients[i].connected ) {
+			count++;
+			if ( !svQuery.clients[i].bot ) {
+				humans++;
+			}
+		}
+	}
+
+	infostring[0] = 0;
+
+	Info_SetValueForKey( infostring, "protocol", va("%i", PROTOCOL_VERSION) );
+	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
+	Info_SetValueForKey( infostring, "mapname", mapname->string );
+	Info_SetValueForKey( infostring, "clients", va("%i", count) );
+	Info_SetValueForKey( infostring, "g_humanplayers", va("%i", humans) );
+	Info_SetValueForKey( infostring, "sv_maxclients",
+		va("%i", sv_maxclients->integer - sv_privateClients->integer ) );
+	Info_SetValueForKey( infostring, "gametype", va("%i", g_gametype->integer ) );
+	Info_SetValueForKey( infostring, "needpass", va("%i", g_needpass->integer ) );
+	Info_SetValueForKey( infostring, "truejedi", va("%i", g_jediVmerc->integer ) );
+	if ( g_gametype->integer == GT_DUEL || g_gametype->integer == GT_POWERDUEL )
+	{
+		wDisable = g_duelWeaponDisable->integer;
+	}
+	else
+	{
+		wDisable = g_weaponDisable->integer;
+	}
+	Info_SetValueForKey( infostring, "wdisable", va("%i", wDisable ) );
+	Info_SetValueForKey( infostring, "fdisable", va("%i", g_forcePowerDisable->integer ) );
+	//Info_SetValueForKey( infostring, "pure", va("%i", sv_pure->integer ) );
+	Info_SetValueForKey( infostring, "autodemo", va("%i", sv_autoDemo->integer ) );
+
+	if( sv_minPing->integer ) {
+		Info_SetValueForKey( infostring, "minPing", va("%i", sv_minPing->integer) );
+	}
+	if( sv_maxPing->integer ) {
+		Info_SetValueForKey( infostring, "maxPing", va("%i", sv_maxPing->integer) );
+	}
+	if( fs_game->string[0] ) {
+		Info_SetValueForKey( infostring, "game", fs_game->string );
+	}
+
+	svQuery.infoLength = strlen( infostring );
+	svQuery.infoStale = false;
+}
+
+// Formats the challenge key the way Info_SetValueForKey would add it to an info string of infoLength,
+// empty where it would have refused
+static int SVC_ChallengeKey( char *key, int keySize, const char *challenge, int infoLength ) {
+	int length;
+
+	key[0] = '\0';
+	if ( !challenge[0] || strpbrk( challenge, "\\;\"" ) ) {
+		return 0;
+	}
+
+	length = Com_sprintf( key, keySize, "\\challenge\\%s", challenge );
+	if ( length + infoLength >= MAX_INFO_STRING ) {
+		key[0] = '\0';
+		return 0;
+	}
+	return length;
+}
+
+// NET_OutOfBandPrint cuts replies off at the same length
+static int SVC_AppendReply( int length, const char *s, int sLength ) {
+	if ( sLength > MAX_MSGLEN - 1 - length ) {
+		sLength = MAX_MSGLEN - 1 - length;
+	}
+	memcpy( svQueryReply + length, s, sLength );
+	return length + sLength;
+}
+
 // Responds with all the info that qplug or qspy can see about the server and all connected players.
 // Used for getting detailed information after the simple info query.
 void SVC_Status( netadr_t from ) {
-	char	player[1024];
-	char	status[MAX_MSGLEN];
-	int		i;
-	client_t	*cl;
-	playerState_t	*ps;
-	int		statusLength;
-	int		playerLength;
-	char	infostring[MAX_INFO_STRING];
+	static const char header[] = "\xff\xff\xff\xff" "statusResponse\n";
+	char	key[MAX_STRING_CHARS];
+	int		length, keyLength;
 
 	// Prevent using getstatus as an amplifier
 	if ( SVC_RateLimitAddress( from, 10, 1000 ) ) {
@@ -376,38 +561,27 @@ void SVC_Status( netadr_t from ) {
 	if(strlen(Cmd_Argv(1)) > 128)
 		return;
 
-	Q_strncpyz( infostring, Cvar_InfoString( CVAR_SERVERINFO ), sizeof( infostring ) );
+	SVC_CheckQueryCache();
+	if ( svQuery.statusStale ) {
+		SVC_BuildStatus();
+	}
 
 	// echo back the parameter to status. so master servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
-
-	status[0] = 0;
-	statusLength = 0;
-
-	for (i=0 ; i < sv_maxclients->integer ; i++) {
-		cl = &svs.clients[i];
-		if ( cl->state >= CS_CONNECTED ) {
-			ps = SV_GameClientNum( i );
-			Com_sprintf (player, sizeof(player), "%i %i \"%s\"\n",
-				ps->persistant[PERS_SCORE], cl->ping, cl->name);
-			playerLength = strlen(player);
-			if (statusLength + playerLength >= (int)sizeof(status) ) {
-				break;		// can't hold any more
-			}
-			strcpy (status + statusLength, player);
-			statusLength += playerLength;
-		}
-	}
+	keyLength = SVC_ChallengeKey( key, sizeof( key ), Cmd_Argv(1), svQuery.serverinfoLength );
 
-	NET_OutOfBandPrint( NS_SERVER, from, "statusResponse\n%s\n%s", infostring, status );
+	length = SVC_AppendReply( 0, header, sizeof( header ) - 1 );
+	length = SVC_AppendReply( length, key, keyLength );
+	length = SVC_AppendReply( length, svQuery.status, svQuery.statusLength );
+	NET_SendPacket( NS_SERVER, length, svQueryReply, from );
 }
 
 // Responds with a short info message that should be enough to determine if a user is interested in a server to do a
 //	full status
 void SVC_Info( netadr_t from ) {
-	int		i, count, humans, wDisable;
-	char	infostring[MAX_INFO_STRING];
+	static const char header[] = "\xff\xff\xff\xff" "infoResponse\n";
+	char	key[MAX_STRING_CHARS];
+	int		length, keyLength;
 
 	// Prevent using getinfo as an amplifier
 	if ( SVC_RateLimitAddress( from, 10, 1000 ) ) {
@@ -432,57 +606,20 @@ void SVC_Info( netadr_t from ) {
 	if(strlen(Cmd_Argv(1)) > 128)
 		return;
 
-	// don't count privateclients
-	count = humans = 0;
-	for ( i = sv_privateClients->integer ; i < sv_maxclients->integer ; i++ ) {
-		if ( svs.clients[i].state >= CS_CONNECTED ) {
-			count++;
-			if ( svs.clients[i].netchan.remoteAddress.type != NA_BOT ) {
-				humans++;
-			}
-		}
+	SVC_CheckQueryCache();
+	if ( svQuery.infoStale ) {
+		SVC_BuildInfo();
 	}
 
-	infostring[0] = 0;
-
 	// echo back the parameter to status. so servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
+	keyLength = SVC_ChallengeKey( key, sizeof( key ), Cmd_Argv(1), svQuery.infoLength );
 
-	Info_SetValueForKey( infostring, "protocol", va("%i", PROTOCOL_VERSION) );
-	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
-	Info_SetValueForKey( infostring, "mapname", mapname->string );
-	Info_SetValueForKey( infostring, "clients", va("%i", count) );
-	Info_SetValueForKey( infostring, "g_humanplayers", va("%i", humans) );
-	Info_SetValueForKey( infostring, "sv_maxclients",
-		va("%i", sv_maxclients->integer - sv_privateClients->integer ) );
-	Info_SetValueForKey( infostring, "gametype", va("%i", g_gametype->integer ) );
-	Info_SetValueForKey( infostring, "needpass", va("%i", g_needpass->integer ) );
-	Info_SetValueForKey( infostring, "truejedi", va("%i", g_jediVmerc->integer ) );
-	if ( g_gametype->integer == GT_DUEL || g_gametype->integer == GT_POWERDUEL )
-	{
-		wDisable = g_duelWeaponDisable->integer;
-	}
-	else
-	{
-		wDisable = g_weaponDisable->integer;
-	}
-	Info_SetValueForKey( infostring, "wdisable", va("%i", wDisable ) );
-	Info_SetValueForKey( infostring, "fdisable", va("%i", g_forcePowerDisable->integer ) );
-	//Info_SetValueForKey( infostring, "pure", va("%i", sv_pure->integer ) );
-	Info_SetValueForKey( infostring, "autodemo", va("%i", sv_autoDemo->integer ) );
-
-	if( sv_minPing->integer ) {
-		Info_SetValueForKey( infostring, "minPing", va("%i", sv_minPing->integer) );
-	}
-	if( sv_maxPing->integer ) {
-		Info_SetValueForKey( infostring, "maxPing", va("%i", sv_maxPing->integer) );
-	}
-	if( fs_game->string[0] ) {
-		Info_SetValueForKey( infostring, "game", fs_game->string );
-	}
-
-	NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s", infostring );
+	// keys are prepended as they're set, the challenge was set first so it comes last
+	length = SVC_AppendReply( 0, header, sizeof( header ) - 1 );
+	length = SVC_AppendReply( length, svQuery.info, svQuery.infoLength );
+	length = SVC_AppendReply( length, key, keyLength );
+	NET_SendPacket( NS_SERVER, length, svQueryReply, from );
 }
 
 void SV_FlushRedirect( char *outputbuf ) {
@@ -1024,6 +1161,9 @@ void SV_Frame( int msec ) {
 	// check timeouts
 	SV_CheckTimeouts();
 
+	// send this frame's configstring changes, once per index
+	SV_FlushConfigstrings();
+
 	// send messages back to the clients
 	SV_SendClientMessages();
 
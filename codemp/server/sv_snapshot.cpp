@@ -28,6 +28,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/com_cvars.h"
 #include "sys/sys_public.h"
 
+#include <atomic>
+
 // Delta encode a client frame onto the network channel
 // A normal server packet will look like:
 //	4	sequence number (high bit set if an oversize fragment)
@@ -42,6 +44,128 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 //	<playerstate>
 //	<packetentities>
 
+// Most clients get the same entity transitions in a frame, so each encoded delta is kept for the
+// rest of SV_SendClientMessages and its bits are spliced into the other messages. Entity states
+// can't change until the game runs again, which is why the cache is only open for that call.
+#define DELTA_CACHE_SLOTS		4				// distinct from states kept per entity
+#define DELTA_CACHE_POOL		(1024*1024)		// encoded bits for the whole frame
+#define DELTA_CACHE_MAXBYTES	(sizeof(entityState_t)*2)
+
+enum deltaSlotState_e {
+	DELTA_SLOT_FILLING = 1,
+	DELTA_SLOT_READY,
+	DELTA_SLOT_FAILED
+};
+
+struct deltaCacheSlot_t {
+	std::atomic<int>	state;		// frame << 2 | deltaSlotState_e, stale slots are free
+	bool				force;
+	int					numBits;
+	int					poolOffset;
+	entityState_t		from;
+	entityState_t		to;
+};
+
+static deltaCacheSlot_t	svDeltaSlots[MAX_GENTITIES][DELTA_CACHE_SLOTS];
+static byte				svDeltaPool[DELTA_CACHE_POOL];
+static std::atomic<int>	svDeltaPoolUsed;
+static int				svDeltaFrame;
+static bool				svDeltaActive;
+
+static void SV_BeginDeltaCache( void ) {
+	int i, j;
+
+	if ( ++svDeltaFrame >= (1<<28) ) {
+		// keep clear of the frame numbers still in the slots
+		for ( i = 0 ; i < MAX_GENTITIES ; i++ ) {
+			for ( j = 0 ; j < DELTA_CACHE_SLOTS ; j++ ) {
+				svDeltaSlots[i][j].state = 0;
+			}
+		}
+		svDeltaFrame = 1;
+	}
+	svDeltaPoolUsed = 0;
+	svDeltaActive = true;
+}
+
+static void SV_EndDeltaCache( void ) {
+	svDeltaActive = false;
+}
+
+// The direct path checks for overflow before every write, none of those checks can fail if the
+// whole run leaves the same room
+static bool SV_DeltaFits( msg_t *msg, int numBits ) {
+	return msg->maxsize - ( ( ( msg->bit + numBits ) >> 3 ) + 1 ) >= 4;
+}
+
+// Same bits as MSG_WriteDeltaEntity. Safe to call from the snapshot jobs, a transition another
+// thread is still encoding just gets encoded again.
+static void SV_WriteDeltaEntityCached( msg_t *msg, entityState_t *from, entityState_t *to, bool force ) {
+	deltaCacheSlot_t	*slot, *claimed;
+	int					i, state, frameBits, numBytes, offset;
+	byte				buf[DELTA_CACHE_MAXBYTES];
+	msg_t				scratch;
+
+	if ( !svDeltaActive || !from || !to ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	frameBits = svDeltaFrame << 2;
+	claimed = nullptr;
+	for ( i = 0 ; i < DELTA_CACHE_SLOTS && !claimed ; i++ ) {
+		slot = &svDeltaSlots[to->number][i];
+		state = slot->state.load( std::memory_order_acquire );
+
+		if ( state == ( frameBits | DELTA_SLOT_READY ) ) {
+			if ( slot->force != force || memcmp( &slot->from, from, sizeof( *from ) ) || memcmp( &slot->to, to, sizeof( *to ) ) ) {
+				continue;
+			}
+			if ( !SV_DeltaFits( msg, slot->numBits ) ) {
+				break;
+			}
+			MSG_WriteEncodedBits( msg, svDeltaPool + slot->poolOffset, slot->numBits );
+			return;
+		}
+
+		// slots fill in order, so the first stale one means nothing further on matches
+		if ( ( state & ~3 ) != frameBits && slot->state.compare_exchange_strong( state, frameBits | DELTA_SLOT_FILLING ) ) {
+			claimed = slot;
+		}
+	}
+
+	if ( !claimed ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	MSG_Init( &scratch, buf, sizeof( buf ) );
+	scratch.allowoverflow = true;
+	MSG_WriteDeltaEntity( &scratch, from, to, force );
+
+	numBytes = ( scratch.bit + 7 ) >> 3;
+	offset = svDeltaPoolUsed.fetch_add( numBytes );
+	if ( scratch.overflowed || offset + numBytes > DELTA_CACHE_POOL ) {
+		claimed->state.store( frameBits | DELTA_SLOT_FAILED, std::memory_order_release );
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	memcpy( svDeltaPool + offset, buf, numBytes );
+	claimed->force = force;
+	claimed->numBits = scratch.bit;
+	claimed->poolOffset = offset;
+	claimed->from = *from;
+	claimed->to = *to;
+	claimed->state.store( frameBits | DELTA_SLOT_READY, std::memory_order_release );
+
+	if ( SV_DeltaFits( msg, scratch.bit ) ) {
+		MSG_WriteEncodedBits( msg, buf, scratch.bit );
+	} else {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+	}
+}
+
 // Writes a delta update of an entityState_t list to the message.
 static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg ) {
 	entityState_t	*oldent, *newent;
@@ -79,7 +203,7 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 			// delta update from old position
 			// because the force parm is false, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity (msg, oldent, newent, false );
+			SV_WriteDeltaEntityCached (msg, oldent, newent, false );
 			oldindex++;
 			newindex++;
 			continue;
@@ -87,7 +211,7 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 
 		if ( newnum < oldnum ) {
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity (msg, &sv.svEntities[newnum].baseline, newent, true );
+			SV_WriteDeltaEntityCached (msg, &sv.svEntities[newnum].baseline, newent, true );
 			newindex++;
 			continue;
 		}
@@ -103,65 +227,14 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 	MSG_WriteBits( msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );	// end of packetentities
 }
 
-static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
-	clientSnapshot_t	*frame, *oldframe;
-	int					lastframe;
+// Writes the snapshot being sent, delta compressed from oldframe (lastframe messages back) or from nothing
+static void SV_WriteSnapshotFrame( client_t *client, msg_t *msg, clientSnapshot_t *oldframe, int lastframe ) {
+	clientSnapshot_t	*frame;
 	int					i;
 	int					snapFlags;
-	int					deltaMessage;
 
-	// this is the snapshot we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
-	// bots never acknowledge, but it doesn't matter since the only use case is for serverside demos
-	// in which case we can delta against the very last message every time
-	deltaMessage = client->deltaMessage;
-	if ( client->demo.isBot ) {
-		client->deltaMessage = client->netchan.outgoingSequence;
-	}
-
-	// try to use a previous frame as the source for delta compressing the snapshot
-	if ( deltaMessage <= 0 || client->state != CS_ACTIVE ) {
-		// client is asking for a retransmit
-		oldframe = nullptr;
-		lastframe = 0;
-	} else if ( client->netchan.outgoingSequence - deltaMessage
-		>= (PACKET_BACKUP - 3) ) {
-		// client hasn't gotten a good message through in a long time
-		Com_DPrintf ("%s: Delta request from out of date packet.\n", client->name);
-		oldframe = nullptr;
-		lastframe = 0;
-	} else if ( client->demo.demorecording && client->demo.demowaiting ) {
-		// demo is waiting for a non-delta-compressed frame for this client, so don't delta compress
-		oldframe = nullptr;
-		lastframe = 0;
-	} else if ( client->demo.minDeltaFrame > deltaMessage ) {
-		// we saved a non-delta frame to the demo and sent it to the client, but the client didn't ack it
-		// we can't delta against an old frame that's not in the demo without breaking the demo.  so send
-		// non-delta frames until the client acks.
-		oldframe = nullptr;
-		lastframe = 0;
-	} else {
-		// we have a valid snapshot to delta from
-		oldframe = &client->frames[ deltaMessage & PACKET_MASK ];
-		lastframe = client->netchan.outgoingSequence - deltaMessage;
-
-		// the snapshot's entities may still have rolled off the buffer, though
-		if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities ) {
-			Com_DPrintf ("%s: Delta request from out of date entities.\n", client->name);
-			oldframe = nullptr;
-			lastframe = 0;
-		}
-	}
-
-	if ( oldframe == nullptr ) {
-		if ( client->demo.demowaiting ) {
-			// this is a non-delta frame, so we can delta against it in the demo
-			client->demo.minDeltaFrame = client->netchan.outgoingSequence;
-		}
-		client->demo.demowaiting = false;
-	}
-
 	MSG_WriteByte (msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -227,6 +300,68 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 	}
 }
 
+static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
+	clientSnapshot_t	*frame, *oldframe;
+	int					lastframe;
+	int					deltaMessage;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+	// bots never acknowledge, but it doesn't matter since the only use case is for serverside demos
+	// in which case we can delta against the very last message every time
+	deltaMessage = client->deltaMessage;
+	if ( client->demo.isBot ) {
+		client->deltaMessage = client->netchan.outgoingSequence;
+	}
+
+	// try to use a previous frame as the source for delta compressing the snapshot
+	if ( deltaMessage <= 0 || client->state != CS_ACTIVE ) {
+		// client is asking for a retransmit
+		oldframe = nullptr;
+		lastframe = 0;
+	} else if ( client->netchan.outgoingSequence - deltaMessage
+		>= (PACKET_BACKUP - 3) ) {
+		// client hasn't gotten a good message through in a long time
+		Com_DPrintf ("%s: Delta request from out of date packet.\n", client->name);
+		oldframe = nullptr;
+		lastframe = 0;
+	} else if ( client->demo.demorecording && client->demo.demowaiting ) {
+		// demo is waiting for a non-delta-compressed frame for this client, so don't delta compress
+		oldframe = nullptr;
+		lastframe = 0;
+	} else if ( client->demo.minDeltaFrame > deltaMessage ) {
+		// we saved a non-delta frame to the demo and sent it to the client, but the client didn't ack it
+		// we can't delta against an old frame that's not in the demo without breaking the demo.  so send
+		// non-delta frames until the client acks.
+		oldframe = nullptr;
+		lastframe = 0;
+	} else {
+		// we have a valid snapshot to delta from
+		oldframe = &client->frames[ deltaMessage & PACKET_MASK ];
+		lastframe = client->netchan.outgoingSequence - deltaMessage;
+
+		// the snapshot's entities may still have rolled off the buffer, though
+		// (measured from the end of this frame's entities, which is where the ring stood when they were copied in;
+		// with job threads later clients have been copied in too, into the extra frame the ring keeps for them)
+		if ( oldframe->first_entity <= frame->first_entity + frame->num_entities - svs.deltaSnapshotEntities ) {
+			Com_DPrintf ("%s: Delta request from out of date entities.\n", client->name);
+			oldframe = nullptr;
+			lastframe = 0;
+		}
+	}
+
+	if ( oldframe == nullptr ) {
+		if ( client->demo.demowaiting ) {
+			// this is a non-delta frame, so we can delta against it in the demo
+			client->demo.minDeltaFrame = client->netchan.outgoingSequence;
+		}
+		client->demo.demowaiting = false;
+	}
+
+	SV_WriteSnapshotFrame( client, msg, oldframe, lastframe );
+}
+
 // (re)send all server commands the client hasn't acknowledged yet
 void SV_UpdateServerCommandsToClient( client_t *client, msg_t *msg ) {
 	int		i;
@@ -251,6 +386,7 @@ void SV_UpdateServerCommandsToClient( client_t *client, msg_t *msg ) {
 struct snapshotEntityNumbers_t {
 	int		numSnapshotEntities;
 	int		snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	byte	added[MAX_GENTITIES/8]; // used to prevent double adding from portal views
 };
 
 static int QDECL SV_QsortEntityNumbers( const void *a, const void *b ) {
@@ -270,35 +406,133 @@ static int QDECL SV_QsortEntityNumbers( const void *a, const void *b ) {
 	return 1;
 }
 
-static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+static void SV_AddEntToSnapshot( int e, snapshotEntityNumbers_t *eNums ) {
 	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+	if ( eNums->added[e >> 3] & (1 << (e & 7)) ) {
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->added[e >> 3] |= 1 << (e & 7);
 
 	// if we are full, silently discard entities
 	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES ) {
 		return;
 	}
 
-	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = gEnt->s.number;
+	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = e;
 	eNums->numSnapshotEntities++;
 }
 
+// Entities that may be sent to someone this frame, gathered once by SV_BuildSnapshotCandidates so the
+// per client visibility pass doesn't have to walk every gentity. Kept as parallel arrays, in entity order.
+struct snapshotCandidates_t {
+	int			numCandidates;
+	int			candidateNum[MAX_GENTITIES]; // by entity number, -1 if not a candidate
+	byte		noCull[MAX_GENTITIES/8]; // entities that can be sent without a visible cluster
+	int			number[MAX_GENTITIES];
+	int			svFlags[MAX_GENTITIES];
+	int			singleClient[MAX_GENTITIES];
+	uint32_t	broadcastClients[MAX_GENTITIES][2];
+	bool		isPortalEnt[MAX_GENTITIES];
+	int			areanum[MAX_GENTITIES];
+	int			areanum2[MAX_GENTITIES];
+	int			numClusters[MAX_GENTITIES];
+	int			firstCluster[MAX_GENTITIES]; // index into clusternums
+	int			lastCluster[MAX_GENTITIES];
+	vec3_t		center[MAX_GENTITIES]; // only used for sv cull distance
+	float		diameter[MAX_GENTITIES];
+	int			clusternums[MAX_GENTITIES * MAX_ENT_CLUSTERS];
+};
+
+static snapshotCandidates_t svCandidates;
+
+// Filters out everything that doesn't depend on the viewer. Must run after the game frame and before any
+// snapshot is built.
+static void SV_BuildSnapshotCandidates( void ) {
+	int				e, i, n, numClusterNums;
+	sharedEntity_t	*ent;
+	svEntity_t		*svEnt;
+	vec3_t			diff;
+
+	svCandidates.numCandidates = 0;
+	Com_Memset( svCandidates.candidateNum, -1, sizeof( svCandidates.candidateNum ) );
+	Com_Memset( svCandidates.noCull, 0, sizeof( svCandidates.noCull ) );
+
+	// during an error shutdown message we may need to transmit
+	// the shutdown message after the server has shutdown
+	if ( !sv.state ) {
+		return;
+	}
+
+	numClusterNums = 0;
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		ent = SV_GentityNum(e);
+
+		// never send entities that aren't linked in
+		if ( !ent->r.linked ) {
+			continue;
+		}
+
+		if (ent->s.eFlags & EF_PERMANENT)
+		{	// he's permanent, so don't send him down!
+			continue;
+		}
+
+		if (ent->s.number != e) {
+			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = e;
+		}
+
+		// entities can be flagged to explicitly not be sent to the client
+		if ( ent->r.svFlags & SVF_NOCLIENT ) {
+			continue;
+		}
+
+		svEnt = SV_SvEntityForGentity( ent );
+
+		n = svCandidates.numCandidates++;
+		svCandidates.candidateNum[e] = n;
+		svCandidates.number[n] = e;
+		svCandidates.svFlags[n] = ent->r.svFlags;
+		svCandidates.singleClient[n] = ent->r.singleClient;
+		svCandidates.broadcastClients[n][0] = ent->r.broadcastClients[0];
+		svCandidates.broadcastClients[n][1] = ent->r.broadcastClients[1];
+		svCandidates.isPortalEnt[n] = ent->s.isPortalEnt;
+		svCandidates.areanum[n] = svEnt->areanum;
+		svCandidates.areanum2[n] = svEnt->areanum2;
+		svCandidates.numClusters[n] = svEnt->numClusters;
+		svCandidates.firstCluster[n] = numClusterNums;
+		svCandidates.lastCluster[n] = svEnt->lastCluster;
+		for ( i = 0 ; i < svEnt->numClusters ; i++ ) {
+			svCandidates.clusternums[numClusterNums++] = svEnt->clusternums[i];
+		}
+
+		if ( (ent->r.svFlags & SVF_BROADCAST) || ent->r.broadcastClients[0] || ent->r.broadcastClients[1]
+			|| ent->s.isPortalEnt || svEnt->lastCluster )
+		{
+			svCandidates.noCull[e >> 3] |= 1 << (e & 7);
+		}
+
+		VectorAdd( ent->r.absmax, ent->r.absmin, svCandidates.center[n] );
+		VectorScale( svCandidates.center[n], 0.5f, svCandidates.center[n] );
+		VectorSubtract( ent->r.absmax, ent->r.absmin, diff );
+		svCandidates.diameter[n] = VectorLength( diff );
+	}
+}
+
 float g_svCullDist = -1.0f;
 static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *frame,
 									snapshotEntityNumbers_t *eNums, bool portal ) {
-	int		e, i;
-	sharedEntity_t *ent;
-	svEntity_t	*svEnt;
+	int		c, e, i, b;
+	int		svFlags;
 	int		l;
-	int		clientarea, clientcluster;
+	int		clientarea, clientcluster, clientNum;
 	int		leafnum;
 	byte	*clientpvs;
 	byte	*bitvector;
+	const int *clusternums;
+	byte	pvsEntities[MAX_GENTITIES/8];
 	vec3_t	difference;
-	float	length, radius;
+	float	length;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -315,76 +549,71 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 	frame->areabytes = CM_WriteAreaBits( frame->areabits, clientarea );
 
 	clientpvs = CM_ClusterPVS (clientcluster);
+	clientNum = frame->ps.clientNum;
 
-	for ( e = 0 ; e < sv.num_entities ; e++ ) {
-		ent = SV_GentityNum(e);
+	// only entities touching a visible cluster can pass the leaf check below, so start from those
+	Com_Memcpy( pvsEntities, svCandidates.noCull, sizeof( pvsEntities ) );
+	SV_MarkClusterEntities( clientpvs, pvsEntities );
 
-		// never send entities that aren't linked in
-		if ( !ent->r.linked ) {
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		b = pvsEntities[e >> 3];
+		if ( !b ) {
+			e |= 7;
 			continue;
 		}
-
-		if (ent->s.eFlags & EF_PERMANENT)
-		{	// he's permanent, so don't send him down!
+		if ( !(b & (1 << (e & 7))) ) {
 			continue;
 		}
-
-		if (ent->s.number != e) {
-			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
-		}
-
-		// entities can be flagged to explicitly not be sent to the client
-		if ( ent->r.svFlags & SVF_NOCLIENT ) {
+		c = svCandidates.candidateNum[e];
+		if ( c == -1 ) {
 			continue;
 		}
+		svFlags = svCandidates.svFlags[c];
 
 		// entities can be flagged to be sent to only one client
-		if ( ent->r.svFlags & SVF_SINGLECLIENT ) {
-			if ( ent->r.singleClient != frame->ps.clientNum ) {
+		if ( svFlags & SVF_SINGLECLIENT ) {
+			if ( svCandidates.singleClient[c] != clientNum ) {
 				continue;
 			}
 		}
 		// entities can be flagged to be sent to everyone but one client
-		if ( ent->r.svFlags & SVF_NOTSINGLECLIENT ) {
-			if ( ent->r.singleClient == frame->ps.clientNum ) {
+		if ( svFlags & SVF_NOTSINGLECLIENT ) {
+			if ( svCandidates.singleClient[c] == clientNum ) {
 				continue;
 			}
 		}
 
-		svEnt = SV_SvEntityForGentity( ent );
-
 		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+		if ( eNums->added[e >> 3] & (1 << (e & 7)) ) {
 			continue;
 		}
 
 		// entities can request not to be sent to certain clients (NOTE: always send to ourselves)
-		if ( e != frame->ps.clientNum && (ent->r.svFlags & SVF_BROADCASTCLIENTS)
-			&& !(ent->r.broadcastClients[frame->ps.clientNum/32] & (1 << (frame->ps.clientNum % 32))) )
+		if ( e != clientNum && (svFlags & SVF_BROADCASTCLIENTS)
+			&& !(svCandidates.broadcastClients[c][clientNum/32] & (1 << (clientNum % 32))) )
 		{
 			continue;
 		}
 		// broadcast entities are always sent, and so is the main player so we don't see noclip weirdness
-		if ( (ent->r.svFlags & SVF_BROADCAST) || e == frame->ps.clientNum
-			|| (ent->r.broadcastClients[frame->ps.clientNum/32] & (1 << (frame->ps.clientNum % 32))) )
+		if ( (svFlags & SVF_BROADCAST) || e == clientNum
+			|| (svCandidates.broadcastClients[c][clientNum/32] & (1 << (clientNum % 32))) )
 		{
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+			SV_AddEntToSnapshot( e, eNums );
 			continue;
 		}
 
-		if (ent->s.isPortalEnt)
+		if (svCandidates.isPortalEnt[c])
 		{ //rww - portal entities are always sent as well
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+			SV_AddEntToSnapshot( e, eNums );
 			continue;
 		}
 
 		// ignore if not touching a PV leaf
 		// check area
-		if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
+		if ( !CM_AreasConnected( clientarea, svCandidates.areanum[c] ) ) {
 			// doors can legally straddle two areas, so
 			// we may need to check another one
-			if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
+			if ( !CM_AreasConnected( clientarea, svCandidates.areanum2[c] ) ) {
 				continue;		// blocked by a door
 			}
 		}
@@ -392,12 +621,13 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		bitvector = clientpvs;
 
 		// check individual leafs
-		if ( !svEnt->numClusters ) {
+		if ( !svCandidates.numClusters[c] ) {
 			continue;
 		}
+		clusternums = &svCandidates.clusternums[svCandidates.firstCluster[c]];
 		l = 0;
-		for ( i=0 ; i < svEnt->numClusters ; i++ ) {
-			l = svEnt->clusternums[i];
+		for ( i=0 ; i < svCandidates.numClusters[c] ; i++ ) {
+			l = clusternums[i];
 			if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
 				break;
 			}
@@ -405,14 +635,14 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 		// if we haven't found it to be visible,
 		// check overflow clusters that coudln't be stored
-		if ( i == svEnt->numClusters ) {
-			if ( svEnt->lastCluster ) {
-				for ( ; l <= svEnt->lastCluster ; l++ ) {
+		if ( i == svCandidates.numClusters[c] ) {
+			if ( svCandidates.lastCluster[c] ) {
+				for ( ; l <= svCandidates.lastCluster[c] ; l++ ) {
 					if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
 						break;
 					}
 				}
-				if ( l == svEnt->lastCluster ) {
+				if ( l == svCandidates.lastCluster[c] ) {
 					continue;	// not visible
 				}
 			} else {
@@ -422,25 +652,21 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 		if (g_svCullDist != -1.0f)
 		{ //do a distance cull check
-			VectorAdd(ent->r.absmax, ent->r.absmin, difference);
-			VectorScale(difference, 0.5f, difference);
-			VectorSubtract(origin, difference, difference);
+			VectorSubtract(origin, svCandidates.center[c], difference);
 			length = VectorLength(difference);
-
-			// calculate the diameter
-			VectorSubtract(ent->r.absmax, ent->r.absmin, difference);
-			radius = VectorLength(difference);
-			if (length-radius >= g_svCullDist)
+			if (length-svCandidates.diameter[c] >= g_svCullDist)
 			{ //then don't add it
 				continue;
 			}
 		}
 
 		// add it
-		SV_AddEntToSnapshot( svEnt, ent, eNums );
+		SV_AddEntToSnapshot( e, eNums );
 
 		// if its a portal entity, add everything visible from its camera position
-		if ( ent->r.svFlags & SVF_PORTAL ) {
+		if ( svFlags & SVF_PORTAL ) {
+			sharedEntity_t *ent = SV_GentityNum(e);
+
 			if ( ent->s.generic1 ) {
 				vec3_t dir;
 				VectorSubtract(ent->s.origin, origin, dir);
@@ -456,25 +682,20 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 // Decides which entities are going to be visible to the client, and copies off the playerstate and areabits.
 // This properly handles multiple recursive portals, but the render currently doesn't.
 // For viewing through other player's eyes, client can be something other than client->gentity
-static void SV_BuildClientSnapshot( client_t *client ) {
+// Only touches the client's own frame and entityNumbers, so it may run on a job thread.
+static void SV_BuildClientSnapshotEntities( client_t *client, snapshotEntityNumbers_t *entityNumbers ) {
 	vec3_t						org;
 	clientSnapshot_t			*frame;
-	snapshotEntityNumbers_t		entityNumbers;
 	int							i;
-	sharedEntity_t				*ent;
-	entityState_t				*state;
-	svEntity_t					*svEnt;
 	sharedEntity_t				*clent;
 	playerState_t				*ps;
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
-
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	entityNumbers->numSnapshotEntities = 0;
+	Com_Memset( entityNumbers->added, 0, sizeof( entityNumbers->added ) );
 	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
 	frame->num_entities = 0;
@@ -498,8 +719,7 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	if ( clientNum < 0 || clientNum >= MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "SV_SvEntityForGentity: bad gEnt" );
 	}
-	svEnt = &sv.svEntities[ clientNum ];
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	entityNumbers->added[clientNum >> 3] |= 1 << (clientNum & 7);
 
 	// find the client's viewpoint
 	VectorCopy( ps->origin, org );
@@ -507,26 +727,36 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, false );
+	SV_AddEntitiesVisibleFromPoint( org, frame, entityNumbers, false );
 
 	// if there were portals visible, there may be out of order entities
 	// in the list which will need to be resorted for the delta compression
 	// to work correctly.  This also catches the error condition
 	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-		sizeof( entityNumbers.snapshotEntities[0] ), SV_QsortEntityNumbers );
+	qsort( entityNumbers->snapshotEntities, entityNumbers->numSnapshotEntities,
+		sizeof( entityNumbers->snapshotEntities[0] ), SV_QsortEntityNumbers );
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
 	for ( i = 0 ; i < MAX_MAP_AREA_BYTES/4 ; i++ ) {
 		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
 	}
+}
+
+// Copies the entity states picked by SV_BuildClientSnapshotEntities into the shared svs.snapshotEntities ring.
+static void SV_CopySnapshotEntities( client_t *client, snapshotEntityNumbers_t *entityNumbers ) {
+	clientSnapshot_t	*frame;
+	sharedEntity_t		*ent;
+	entityState_t		*state;
+	int					i;
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// copy the entity states out
 	frame->num_entities = 0;
 	frame->first_entity = svs.nextSnapshotEntities;
-	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ ) {
-		ent = SV_GentityNum(entityNumbers.snapshotEntities[i]);
+	for ( i = 0 ; i < entityNumbers->numSnapshotEntities ; i++ ) {
+		ent = SV_GentityNum(entityNumbers->snapshotEntities[i]);
 		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
 		*state = ent->s;
 		svs.nextSnapshotEntities++;
@@ -538,6 +768,13 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	}
 }
 
+static void SV_BuildClientSnapshot( client_t *client ) {
+	snapshotEntityNumbers_t		entityNumbers;
+
+	SV_BuildClientSnapshotEntities( client, &entityNumbers );
+	SV_CopySnapshotEntities( client, &entityNumbers );
+}
+
 #define	HEADER_RATE_BYTES	48		// include our header, IP header, and some overhead
 // Return the number of msec a given size message is supposed to take to clear, based on the current rate
 static int SV_RateMsec( client_t *client, int messageSize ) {
@@ -572,7 +809,8 @@ static int SV_RateMsec( client_t *client, int messageSize ) {
 }
 
 // Called by SV_SendClientSnapshot and SV_SendClientGameState
-void SV_SendMessageToClient( msg_t *msg, client_t *client ) {
+// demoMsg, if given, is stored in a recording demo in place of msg
+void SV_SendMessageToClient( msg_t *msg, client_t *client, msg_t *demoMsg ) {
 	int			rateMsec;
 
 	// MW - my attempt to fix illegible server message errors caused by
@@ -587,12 +825,12 @@ void SV_SendMessageToClient( msg_t *msg, client_t *client ) {
 
 	// record information about the message
 	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg->cursize;
-	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = Sys_Milliseconds();
 	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
 
 	// save the message to demo.  this must happen before sending over network as that encodes the backing databuf
 	if ( client->demo.demorecording && !client->demo.demowaiting ) {
-		msg_t msgcopy = *msg;
+		msg_t msgcopy = demoMsg ? *demoMsg : *msg;
 		MSG_WriteByte( &msgcopy, svc_EOF );
 		SV_WriteDemoMessage( client, &msgcopy, 0 );
 	}
@@ -642,119 +880,307 @@ void SV_SendMessageToClient( msg_t *msg, client_t *client ) {
 	}
 }
 
-// Also called by SV_FinalMessage
-void SV_SendClientSnapshot( client_t *client ) {
+// rww - if the client hasn't been sent an svc_setgame yet then make sure there is one sent before the next snap
+static void SV_SendClientGamedir( client_t *client ) {
 	byte		msg_buf[MAX_MSGLEN];
 	msg_t		msg;
+	int			i = 0;
 
-	if (!client->sentGamedir)
-	{ //rww - if this is the case then make sure there is an svc_setgame sent before this snap
-		int i = 0;
-
-		MSG_Init (&msg, msg_buf, sizeof(msg_buf));
-
-		//have to include this for each message.
-		MSG_WriteLong( &msg, client->lastClientCommand );
+	MSG_Init (&msg, msg_buf, sizeof(msg_buf));
 
-		MSG_WriteByte (&msg, svc_setgame);
+	//have to include this for each message.
+	MSG_WriteLong( &msg, client->lastClientCommand );
 
-		const char *gamedir = FS_GetCurrentGameDir(true);
+	MSG_WriteByte (&msg, svc_setgame);
 
-		while (gamedir[i])
-		{
-			MSG_WriteByte(&msg, gamedir[i]);
-			i++;
-		}
-		MSG_WriteByte(&msg, 0);
+	const char *gamedir = FS_GetCurrentGameDir(true);
 
-		// MW - my attempt to fix illegible server message errors caused by
-		// packet fragmentation of initial snapshot.
-		//rww - reusing this code here
-		while(client->state&&client->netchan.unsentFragments)
-		{
-			// send additional message fragments if the last message
-			// was too large to send at once
-			Com_Printf ("[ISM]SV_SendClientGameState() [1] for %s, writing out old fragments\n", client->name);
-			SV_Netchan_TransmitNextFragment(&client->netchan);
-		}
+	while (gamedir[i])
+	{
+		MSG_WriteByte(&msg, gamedir[i]);
+		i++;
+	}
+	MSG_WriteByte(&msg, 0);
 
-		// record information about the message
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg.cursize;
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
+	// MW - my attempt to fix illegible server message errors caused by
+	// packet fragmentation of initial snapshot.
+	//rww - reusing this code here
+	while(client->state&&client->netchan.unsentFragments)
+	{
+		// send additional message fragments if the last message
+		// was too large to send at once
+		Com_Printf ("[ISM]SV_SendClientGameState() [1] for %s, writing out old fragments\n", client->name);
+		SV_Netchan_TransmitNextFragment(&client->netchan);
+	}
 
-		// send the datagram
-		SV_Netchan_Transmit( client, &msg );	//msg->cursize, msg->data );
+	// record information about the message
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg.cursize;
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = Sys_Milliseconds();
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
 
-		client->sentGamedir = true;
-	}
+	// send the datagram
+	SV_Netchan_Transmit( client, &msg );	//msg->cursize, msg->data );
 
-	// build the snapshot
-	SV_BuildClientSnapshot( client );
+	client->sentGamedir = true;
+}
 
+static bool SV_ClientWantsAutoDemo( client_t *client ) {
 	if ( sv_autoDemo->integer && !client->demo.demorecording ) {
 		if ( client->netchan.remoteAddress.type != NA_BOT || sv_autoDemoBots->integer ) {
-			SV_BeginAutoRecordDemos();
+			return true;
 		}
 	}
+	return false;
+}
+
+// Starts auto recording if wanted. Returns false if the snapshot only needs to be built and not sent.
+static bool SV_CheckClientSnapshotMessage( client_t *client ) {
+	if ( SV_ClientWantsAutoDemo( client ) ) {
+		SV_BeginAutoRecordDemos();
+	}
 
 	// bots need to have their snapshots built, but
 	// they query them directly without needing to be sent
 	if ( client->netchan.remoteAddress.type == NA_BOT && !client->demo.demorecording ) {
-		return;
+		return false;
 	}
 
-	MSG_Init (&msg, msg_buf, sizeof(msg_buf));
-	msg.allowoverflow = true;
+	return true;
+}
+
+// Writes everything up to and including the snapshot itself. Only touches the client's own state,
+// so it may run on a job thread once the snapshot has been built.
+static void SV_WriteClientSnapshotMessage( client_t *client, msg_t *msg, byte *data, int length ) {
+	MSG_Init (msg, data, length);
+	msg->allowoverflow = true;
 
 	// NOTE, MRE: all server->client messages now acknowledge
 	// let the client know which reliable clientCommands we have received
-	MSG_WriteLong( &msg, client->lastClientCommand );
+	MSG_WriteLong( msg, client->lastClientCommand );
 
 	// (re)send any reliable server commands
-	SV_UpdateServerCommandsToClient( client, &msg );
+	SV_UpdateServerCommandsToClient( client, msg );
 
 	// send over all the relevant entityState_t
 	// and the playerState_t
-	SV_WriteSnapshotToClient( client, &msg );
+	SV_WriteSnapshotToClient( client, msg );
+}
+
+// After a keyframe an indexed demo needs a non-delta snapshot to start from, and then snapshots that only delta
+// from what it stored until the client acks one of those. They are encoded for the demo alone, so the client's
+// own messages keep delta compressing against what it acked. Returns false if the demo can store msg as it is.
+static bool SV_WriteDemoSnapshotMessage( client_t *client, msg_t *msg, byte *data, int length ) {
+	clientSnapshot_t	*frame, *oldframe;
+	int					lastframe;
+
+	if ( !client->demo.demorecording || client->demo.demowaiting ) {
+		return false;
+	}
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+	if ( client->demo.keyframeWaiting ) {
+		client->demo.keyframeWaiting = false;
+		client->demo.keyframeSequence = client->netchan.outgoingSequence;
+		oldframe = nullptr;
+		lastframe = 0;
+	} else if ( client->demo.keyframeSequence && client->deltaMessage < client->demo.keyframeSequence ) {
+		// the previous message is in the demo whichever copy of it was stored
+		oldframe = &client->frames[ ( client->netchan.outgoingSequence - 1 ) & PACKET_MASK ];
+		lastframe = 1;
+		if ( oldframe->first_entity <= frame->first_entity + frame->num_entities - svs.deltaSnapshotEntities ) {
+			oldframe = nullptr;
+			lastframe = 0;
+		}
+	} else {
+		client->demo.keyframeSequence = 0;
+		return false;
+	}
+
+	MSG_Init (msg, data, length);
+	msg->allowoverflow = true;
+
+	MSG_WriteLong( msg, client->lastClientCommand );
+	SV_UpdateServerCommandsToClient( client, msg );
+	SV_WriteSnapshotFrame( client, msg, oldframe, lastframe );
+
+	if ( msg->overflowed ) {
+		MSG_Clear (msg);
+	}
+	return true;
+}
+
+static void SV_FinishClientSnapshotMessage( client_t *client, msg_t *msg ) {
+	byte		demoBuf[MAX_MSGLEN];
+	msg_t		demoMsg;
 
 	// Add any download data if the client is downloading
-	SV_WriteDownloadToClient( client, &msg );
+	SV_WriteDownloadToClient( client, msg );
 
 	// check for overflow
-	if ( msg.overflowed ) {
+	if ( msg->overflowed ) {
 		Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
-		MSG_Clear (&msg);
+		MSG_Clear (msg);
+	}
+
+	if ( SV_WriteDemoSnapshotMessage( client, &demoMsg, demoBuf, sizeof(demoBuf) ) ) {
+		SV_SendMessageToClient( msg, client, &demoMsg );
+	} else {
+		SV_SendMessageToClient( msg, client );
+	}
+}
+
+static void SV_SendClientSnapshotFromCandidates( client_t *client ) {
+	byte		msg_buf[MAX_MSGLEN];
+	msg_t		msg;
+
+	if (!client->sentGamedir) {
+		SV_SendClientGamedir( client );
+	}
+
+	// build the snapshot
+	SV_BuildClientSnapshot( client );
+
+	if ( !SV_CheckClientSnapshotMessage( client ) ) {
+		return;
 	}
 
-	SV_SendMessageToClient( &msg, client );
+	SV_WriteClientSnapshotMessage( client, &msg, msg_buf, sizeof(msg_buf) );
+	SV_FinishClientSnapshotMessage( client, &msg );
 }
 
-void SV_SendClientMessages( void ) {
-	int			i;
-	client_t	*c;
+// Also called by SV_FinalMessage and outside the regular frame, so the candidates are gathered again
+void SV_SendClientSnapshot( client_t *client ) {
+	SV_BuildSnapshotCandidates();
+	SV_SendClientSnapshotFromCandidates( client );
+}
+
+// Returns true if a new snapshot should be generated for the client this frame
+static bool SV_ClientReadyForSnapshot( client_t *c ) {
+	if (!c->state) {
+		return false;		// not connected
+	}
+
+	if ( svs.time < c->nextSnapshotTime ) {
+		return false;		// not time yet
+	}
 
-	// send a message to each connected client
+	// send additional message fragments if the last message
+	// was too large to send at once
+	if ( c->netchan.unsentFragments ) {
+		c->nextSnapshotTime = svs.time +
+			SV_RateMsec( c, c->netchan.unsentLength - c->netchan.unsentFragmentStart );
+		SV_Netchan_TransmitNextFragment( &c->netchan );
+		return false;
+	}
+
+	return true;
+}
+
+// com_jobThreads > 0: snapshot building and encoding for every client is spread over the job threads.
+// Everything that touches state shared between clients stays on this thread and runs in client order.
+// Every client is copied into the snapshot entity ring before any is encoded; the ring is one frame longer
+// than deltas reach, so the later clients can't overwrite an old frame an earlier one deltas from.
+struct snapshotJob_t {
+	client_t				*client;
+	bool					sendMessage;
+	snapshotEntityNumbers_t	entityNumbers;
+	msg_t					msg;
+	byte					msgBuf[MAX_MSGLEN];
+};
+
+static snapshotJob_t svSnapshotJobs[MAX_CLIENTS];
+
+static void SV_BuildSnapshotJob( int index, void *data ) {
+	snapshotJob_t *job = (snapshotJob_t *)data + index;
+
+	SV_BuildClientSnapshotEntities( job->client, &job->entityNumbers );
+}
+
+static void SV_WriteSnapshotJob( int index, void *data ) {
+	snapshotJob_t *job = (snapshotJob_t *)data + index;
+
+	if ( job->sendMessage ) {
+		SV_WriteClientSnapshotMessage( job->client, &job->msg, job->msgBuf, sizeof(job->msgBuf) );
+	}
+}
+
+static void SV_SendClientMessagesParallel( void ) {
+	int				i, numJobs;
+	client_t		*c;
+	snapshotJob_t	*job;
+
+	bool			autoDemo = false;
+
+	numJobs = 0;
 	for (i=0, c = svs.clients ; i < sv_maxclients->integer ; i++, c++) {
-		if (!c->state) {
-			continue;		// not connected
+		if ( !SV_ClientReadyForSnapshot( c ) ) {
+			continue;
 		}
 
-		if ( svs.time < c->nextSnapshotTime ) {
-			continue;		// not time yet
+		svSnapshotJobs[numJobs++].client = c;
+		autoDemo |= SV_ClientWantsAutoDemo( c );
+	}
+
+	// starting auto demos changes how the clients after the one that starts them are sent,
+	// so that frame goes out one client at a time
+	if ( autoDemo ) {
+		for ( i = 0 ; i < numJobs ; i++ ) {
+			SV_SendClientSnapshotFromCandidates( svSnapshotJobs[i].client );
 		}
+		return;
+	}
 
-		// send additional message fragments if the last message
-		// was too large to send at once
-		if ( c->netchan.unsentFragments ) {
-			c->nextSnapshotTime = svs.time +
-				SV_RateMsec( c, c->netchan.unsentLength - c->netchan.unsentFragmentStart );
-			SV_Netchan_TransmitNextFragment( &c->netchan );
-			continue;
+	for ( i = 0 ; i < numJobs ; i++ ) {
+		job = &svSnapshotJobs[i];
+		if (!job->client->sentGamedir) {
+			SV_SendClientGamedir( job->client );
 		}
+		job->sendMessage = SV_CheckClientSnapshotMessage( job->client );
+	}
 
-		// generate and send a new message
-		SV_SendClientSnapshot( c );
+	Com_ParallelFor( numJobs, SV_BuildSnapshotJob, svSnapshotJobs );
+
+	// the snapshot entity ring is shared, fill it in client order
+	for ( i = 0 ; i < numJobs ; i++ ) {
+		SV_CopySnapshotEntities( svSnapshotJobs[i].client, &svSnapshotJobs[i].entityNumbers );
+	}
+
+	Com_ParallelFor( numJobs, SV_WriteSnapshotJob, svSnapshotJobs );
+
+	for ( i = 0 ; i < numJobs ; i++ ) {
+		job = &svSnapshotJobs[i];
+		if ( job->sendMessage ) {
+			SV_FinishClientSnapshotMessage( job->client, &job->msg );
+		}
 	}
 }
 
+void SV_SendClientMessages( void ) {
+	int			i;
+	client_t	*c;
+
+	// the visibility filters that don't depend on the viewer are shared by every client this frame
+	SV_BuildSnapshotCandidates();
+
+	// every client's snapshot goes out in as few system calls as possible
+	NET_BeginPacketBatch();
+	SV_BeginDeltaCache();
+
+	if ( Com_JobThreads() ) {
+		SV_SendClientMessagesParallel();
+	} else {
+		// send a message to each connected client
+		for (i=0, c = svs.clients ; i < sv_maxclients->integer ; i++, c++) {
+			if ( !SV_ClientReadyForSnapshot( c ) ) {
+				continue;
+			}
+
+			// generate and send a new message
+			SV_SendClientSnapshotFromCandidates( c );
+		}
+	}
+
+	SV_EndDeltaCache();
+	NET_EndPacketBatch();
+}
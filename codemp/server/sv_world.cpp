@@ -27,6 +27,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "server/server.h"
 #include "ghoul2/ghoul2_shared.h"
 #include "qcommon/cm_public.h"
+#include "qcommon/com_cvar.h"
 #include "qcommon/com_cvars.h"
 
 // Returns a headnode that can be used for testing or clipping to a given entity.
@@ -64,20 +65,85 @@ struct worldSector_t {
 worldSector_t	sv_worldSectors[AREA_NODES];
 int			sv_numworldSectors;
 
+// sv_broadphase 1 replaces the sector tree with a loose grid. Entities are bucketed by the centre of their box in
+//	the finest of a few XY grids whose cells are at least as large as the entity, so nothing reaches more than half
+//	a cell outside of its own cell and a query only visits the cells overlapping its box grown by that margin.
+// Entities too large for every grid or centred outside of the world go into a single list that is always scanned.
+
+#define	GRID_LEVELS		3
+#define	GRID_MAX_CELLS	256	// per axis, coarser cells are used on larger maps
+
+struct areaGrid_t {
+	float		cellSize;
+	int			width, height;
+	svEntity_t	**cells;
+};
+
+static const float	sv_areaGridCellSizes[GRID_LEVELS] = { 128.0f, 512.0f, 2048.0f };
+static areaGrid_t	sv_areaGrids[GRID_LEVELS];
+static svEntity_t	*sv_areaGridOversize;
+static vec3_t		sv_areaGridMins;
+static int			sv_broadphaseMode; // sv_broadphase as of the last SV_ClearWorld
+
+// area query cost since the last sectorlist
+struct areaStats_t {
+	int		queries;
+	int		nodes;		// sectors or grid cells visited
+	int		tests;		// entity bounds tested
+	int		results;
+};
+
+static thread_local areaStats_t	sv_areaStats; // traces on job threads count separately
+
+static int SV_CountEntities( const svEntity_t *list ) {
+	int c = 0;
+
+	for ( ; list ; list = list->nextEntityInWorldSector ) {
+		c++;
+	}
+	return c;
+}
+
 void SV_SectorList_f( void ) {
-	int				i, c;
-	worldSector_t	*sec;
-	svEntity_t		*ent;
+	int				i, j, c, total, occupied, most;
+	areaGrid_t		*grid;
 
-	for ( i = 0 ; i < AREA_NODES ; i++ ) {
-		sec = &sv_worldSectors[i];
+	if ( sv_broadphaseMode == 1 ) {
+		for ( i = 0 ; i < GRID_LEVELS ; i++ ) {
+			grid = &sv_areaGrids[i];
+			if ( !grid->cells ) {
+				continue;
+			}
 
-		c = 0;
-		for ( ent = sec->entities ; ent ; ent = ent->nextEntityInWorldSector ) {
-			c++;
+			total = occupied = most = 0;
+			for ( j = 0 ; j < grid->width * grid->height ; j++ ) {
+				c = SV_CountEntities( grid->cells[j] );
+				if ( c ) {
+					occupied++;
+				}
+				total += c;
+				if ( c > most ) {
+					most = c;
+				}
+			}
+			Com_Printf( "grid %i: %ix%i cells of %.0f units, %i entities in %i cells, at most %i per cell\n",
+				i, grid->width, grid->height, grid->cellSize, total, occupied, most );
+		}
+		Com_Printf( "oversize: %i entities\n", SV_CountEntities( sv_areaGridOversize ) );
+	} else {
+		for ( i = 0 ; i < AREA_NODES ; i++ ) {
+			Com_Printf( "sector %i: %i entities\n", i, SV_CountEntities( sv_worldSectors[i].entities ) );
 		}
-		Com_Printf( "sector %i: %i entities\n", i, c );
 	}
+
+	if ( sv_areaStats.queries ) {
+		Com_Printf( "%i area queries, per query: %.1f nodes, %.1f entity tests, %.1f results\n",
+			sv_areaStats.queries,
+			(float)sv_areaStats.nodes / sv_areaStats.queries,
+			(float)sv_areaStats.tests / sv_areaStats.queries,
+			(float)sv_areaStats.results / sv_areaStats.queries );
+	}
+	Com_Memset( &sv_areaStats, 0, sizeof( sv_areaStats ) );
 }
 
 // Builds a uniformly subdivided tree for the given world size
@@ -116,6 +182,174 @@ worldSector_t *SV_CreateworldSector( int depth, vec3_t mins, vec3_t maxs ) {
 	return anode;
 }
 
+// PVS CLUSTER INDEX
+// Every explicit cluster an entity touches (svEntity_t::clusternums) has a link in that cluster's chain, so snapshot
+//	building can go from the clusters a client sees straight to the entities in them.
+// Link i of entity e is e * MAX_ENT_CLUSTERS + i.
+
+struct clusterLink_t {
+	int		prev, next; // -1 terminated
+	int		cluster;
+};
+
+static clusterLink_t	sv_clusterLinks[MAX_GENTITIES * MAX_ENT_CLUSTERS];
+static int				*sv_clusterEntities; // first link per cluster, hunk allocated per map
+static int				sv_numClusters;
+
+static void SV_UnlinkEntityClusters( svEntity_t *ent ) {
+	int				i, link;
+	clusterLink_t	*cl;
+
+	if ( !sv_clusterEntities ) {
+		return;
+	}
+
+	for ( i = 0 ; i < ent->numClusters ; i++ ) {
+		link = (ent - sv.svEntities) * MAX_ENT_CLUSTERS + i;
+		cl = &sv_clusterLinks[link];
+		if ( cl->prev != -1 ) {
+			sv_clusterLinks[cl->prev].next = cl->next;
+		} else {
+			sv_clusterEntities[cl->cluster] = cl->next;
+		}
+		if ( cl->next != -1 ) {
+			sv_clusterLinks[cl->next].prev = cl->prev;
+		}
+	}
+}
+
+static void SV_LinkEntityClusters( svEntity_t *ent ) {
+	int				i, link, cluster;
+	clusterLink_t	*cl;
+
+	if ( !sv_clusterEntities ) {
+		return;
+	}
+
+	for ( i = 0 ; i < ent->numClusters ; i++ ) {
+		cluster = ent->clusternums[i];
+		if ( cluster < 0 || cluster >= sv_numClusters ) {
+			Com_Error( ERR_DROP, "SV_LinkEntityClusters: bad cluster %i", cluster );
+		}
+		link = (ent - sv.svEntities) * MAX_ENT_CLUSTERS + i;
+		cl = &sv_clusterLinks[link];
+		cl->cluster = cluster;
+		cl->prev = -1;
+		cl->next = sv_clusterEntities[cluster];
+		if ( cl->next != -1 ) {
+			sv_clusterLinks[cl->next].prev = link;
+		}
+		sv_clusterEntities[cluster] = link;
+	}
+}
+
+// Sets the bit of every entity that has an explicit cluster visible in pvs. Entities that overflowed their
+// clusternums are only marked by the clusters they did store, so callers have to check lastCluster themselves.
+void SV_MarkClusterEntities( const byte *pvs, byte *entityBits ) {
+	int		cluster, link, e;
+
+	if ( !sv_clusterEntities ) {
+		return;
+	}
+
+	for ( cluster = 0 ; cluster < sv_numClusters ; cluster++ ) {
+		if ( !pvs[cluster >> 3] ) {
+			cluster |= 7;	// skip the whole byte
+			continue;
+		}
+		if ( !(pvs[cluster >> 3] & (1 << (cluster & 7))) ) {
+			continue;
+		}
+		for ( link = sv_clusterEntities[cluster] ; link != -1 ; link = sv_clusterLinks[link].next ) {
+			e = link / MAX_ENT_CLUSTERS;
+			entityBits[e >> 3] |= 1 << (e & 7);
+		}
+	}
+}
+
+static void SV_CreateAreaGrids( const vec3_t mins, const vec3_t maxs ) {
+	int			i, numCells;
+	float		cellSize;
+	areaGrid_t	*grid;
+
+	VectorCopy( mins, sv_areaGridMins );
+
+	for ( i = 0 ; i < GRID_LEVELS ; i++ ) {
+		grid = &sv_areaGrids[i];
+
+		cellSize = sv_areaGridCellSizes[i];
+		while ( maxs[0] - mins[0] > cellSize * GRID_MAX_CELLS || maxs[1] - mins[1] > cellSize * GRID_MAX_CELLS ) {
+			cellSize *= 2.0f;
+		}
+
+		grid->cellSize = cellSize;
+		grid->width = Com_Clampi( 1, GRID_MAX_CELLS, (int)ceilf( (maxs[0] - mins[0]) / cellSize ) );
+		grid->height = Com_Clampi( 1, GRID_MAX_CELLS, (int)ceilf( (maxs[1] - mins[1]) / cellSize ) );
+
+		numCells = grid->width * grid->height;
+		grid->cells = (svEntity_t **)Hunk_Alloc( numCells * sizeof(svEntity_t *), h_high );
+		Com_Memset( grid->cells, 0, numCells * sizeof(svEntity_t *) );
+	}
+}
+
+// Cell coordinate of v along one grid axis, clamped to [-1, size] so huge boxes can't overflow the conversion
+static int SV_AreaGridCoord( float v, float cellSize, int size ) {
+	v = floorf( v / cellSize );
+	if ( v < -1.0f ) {
+		return -1;
+	}
+	if ( v > (float)size ) {
+		return size;
+	}
+	return (int)v;
+}
+
+static void SV_LinkEntityToGrid( const sharedEntity_t *gEnt, svEntity_t *ent ) {
+	int			i, x, y;
+	float		size;
+	areaGrid_t	*grid;
+	svEntity_t	**list;
+
+	size = gEnt->r.absmax[0] - gEnt->r.absmin[0];
+	if ( gEnt->r.absmax[1] - gEnt->r.absmin[1] > size ) {
+		size = gEnt->r.absmax[1] - gEnt->r.absmin[1];
+	}
+
+	list = &sv_areaGridOversize;
+	for ( i = 0 ; i < GRID_LEVELS ; i++ ) {
+		grid = &sv_areaGrids[i];
+		if ( size > grid->cellSize ) {
+			continue;
+		}
+
+		x = SV_AreaGridCoord( 0.5f * (gEnt->r.absmin[0] + gEnt->r.absmax[0]) - sv_areaGridMins[0], grid->cellSize, grid->width );
+		y = SV_AreaGridCoord( 0.5f * (gEnt->r.absmin[1] + gEnt->r.absmax[1]) - sv_areaGridMins[1], grid->cellSize, grid->height );
+		if ( x >= 0 && x < grid->width && y >= 0 && y < grid->height ) {
+			list = &grid->cells[y * grid->width + x];
+		}
+		break;
+	}
+
+	ent->areaGridCell = list;
+	ent->nextEntityInWorldSector = *list;
+	*list = ent;
+}
+
+static void SV_UnlinkEntityFromGrid( svEntity_t *ent ) {
+	svEntity_t	**list;
+
+	for ( list = ent->areaGridCell ; *list ; list = &(*list)->nextEntityInWorldSector ) {
+		if ( *list == ent ) {
+			*list = ent->nextEntityInWorldSector;
+			ent->areaGridCell = nullptr;
+			return;
+		}
+	}
+
+	ent->areaGridCell = nullptr;
+	Com_Printf( "WARNING: SV_UnlinkEntity: not found in area grid\n" );
+}
+
 // called after the world model has been loaded, before linking any entities
 void SV_ClearWorld( void ) {
 	clipHandle_t	h;
@@ -124,10 +358,27 @@ void SV_ClearWorld( void ) {
 	Com_Memset( sv_worldSectors, 0, sizeof(sv_worldSectors) );
 	sv_numworldSectors = 0;
 
+	// sv.svEntities was cleared with the rest of sv, so no entity has any cluster links yet
+	sv_numClusters = CM_NumClusters();
+	sv_clusterEntities = (int *)Hunk_Alloc( sv_numClusters * sizeof(int), h_high );
+	Com_Memset( sv_clusterEntities, -1, sv_numClusters * sizeof(int) );
+
 	// get world map bounds
 	h = CM_InlineModel( 0 );
 	CM_ModelBounds( h, mins, maxs );
 	SV_CreateworldSector( 0, mins, maxs );
+
+	// force latched values to get set
+	sv_broadphase = Cvar_Get( "sv_broadphase", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	sv_broadphaseMode = sv_broadphase->integer;
+
+	Com_Memset( sv_areaGrids, 0, sizeof( sv_areaGrids ) );
+	sv_areaGridOversize = nullptr;
+	Com_Memset( &sv_areaStats, 0, sizeof( sv_areaStats ) );
+
+	if ( sv_broadphaseMode == 1 ) {
+		SV_CreateAreaGrids( mins, maxs );
+	}
 }
 
 // call before removing an entity, and before trying to move one,
@@ -141,6 +392,11 @@ void SV_UnlinkEntity( sharedEntity_t *gEnt ) {
 
 	gEnt->r.linked = false;
 
+	if ( ent->areaGridCell ) {
+		SV_UnlinkEntityFromGrid( ent );
+		return;
+	}
+
 	ws = ent->worldSector;
 	if ( !ws ) {
 		return;		// not linked in anywhere
@@ -181,7 +437,7 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 
 	ent = SV_SvEntityForGentity( gEnt );
 
-	if ( ent->worldSector ) {
+	if ( ent->worldSector || ent->areaGridCell ) {
 		SV_UnlinkEntity( gEnt );	// unlink from old position
 	}
 
@@ -252,6 +508,7 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	gEnt->r.absmax[2] += 1;
 
 	// link to PVS leafs
+	SV_UnlinkEntityClusters( ent );
 	ent->numClusters = 0;
 	ent->lastCluster = 0;
 	ent->areanum = -1;
@@ -303,8 +560,16 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 		ent->lastCluster = CM_LeafCluster( lastLeaf );
 	}
 
+	SV_LinkEntityClusters( ent );
+
 	gEnt->r.linkcount++;
 
+	if ( sv_broadphaseMode == 1 ) {
+		SV_LinkEntityToGrid( gEnt, ent );
+		gEnt->r.linked = true;
+		return;
+	}
+
 	// find the first world sector node that the ent's box crosses
 	node = sv_worldSectors;
 	while (1)
@@ -338,14 +603,17 @@ struct areaParms_t {
 	int			count, maxcount;
 };
 
-void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
+// Returns false once the list is full
+static bool SV_AreaEntitiesInList( svEntity_t *list, areaParms_t *ap ) {
 	svEntity_t	*check, *next;
 	sharedEntity_t *gcheck;
 
-	for ( check = node->entities  ; check ; check = next ) {
+	sv_areaStats.nodes++;
+	for ( check = list ; check ; check = next ) {
 		next = check->nextEntityInWorldSector;
 
 		gcheck = SV_GEntityForSvEntity( check );
+		sv_areaStats.tests++;
 
 		if ( gcheck->r.absmin[0] > ap->maxs[0]
 		|| gcheck->r.absmin[1] > ap->maxs[1]
@@ -358,13 +626,21 @@ void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 
 		if ( ap->count == ap->maxcount ) {
 			Com_DPrintf ("SV_AreaEntities: MAXCOUNT\n");
-			return;
+			return false;
 		}
 
 		ap->list[ap->count] = check - sv.svEntities;
 		ap->count++;
 	}
 
+	return true;
+}
+
+void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
+	if ( !SV_AreaEntitiesInList( node->entities, ap ) ) {
+		return;
+	}
+
 	if (node->axis == -1) {
 		return;		// terminal node
 	}
@@ -378,6 +654,35 @@ void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 	}
 }
 
+static void SV_AreaEntitiesGrid( areaParms_t *ap ) {
+	int			i, x, y, x0, x1, y0, y1;
+	float		margin;
+	areaGrid_t	*grid;
+
+	if ( !SV_AreaEntitiesInList( sv_areaGridOversize, ap ) ) {
+		return;
+	}
+
+	for ( i = 0 ; i < GRID_LEVELS ; i++ ) {
+		grid = &sv_areaGrids[i];
+
+		// entities reach up to half a cell past the cell holding their centre
+		margin = grid->cellSize * 0.5f;
+		x0 = Com_Clampi( 0, grid->width - 1, SV_AreaGridCoord( ap->mins[0] - margin - sv_areaGridMins[0], grid->cellSize, grid->width ) );
+		x1 = Com_Clampi( 0, grid->width - 1, SV_AreaGridCoord( ap->maxs[0] + margin - sv_areaGridMins[0], grid->cellSize, grid->width ) );
+		y0 = Com_Clampi( 0, grid->height - 1, SV_AreaGridCoord( ap->mins[1] - margin - sv_areaGridMins[1], grid->cellSize, grid->height ) );
+		y1 = Com_Clampi( 0, grid->height - 1, SV_AreaGridCoord( ap->maxs[1] + margin - sv_areaGridMins[1], grid->cellSize, grid->height ) );
+
+		for ( y = y0 ; y <= y1 ; y++ ) {
+			for ( x = x0 ; x <= x1 ; x++ ) {
+				if ( !SV_AreaEntitiesInList( grid->cells[y * grid->width + x], ap ) ) {
+					return;
+				}
+			}
+		}
+	}
+}
+
 // fills in a table of entity numbers with entities that have bounding boxes
 // that intersect the given area.  It is possible for a non-axial bmodel
 // to be returned that doesn't actually intersect the area on an exact
@@ -393,7 +698,14 @@ int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int
 	ap.count = 0;
 	ap.maxcount = maxcount;
 
-	SV_AreaEntities_r( sv_worldSectors, &ap );
+	if ( sv_broadphaseMode == 1 ) {
+		SV_AreaEntitiesGrid( &ap );
+	} else {
+		SV_AreaEntities_r( sv_worldSectors, &ap );
+	}
+
+	sv_areaStats.queries++;
+	sv_areaStats.results += ap.count;
 
 	return ap.count;
 }
@@ -462,7 +774,7 @@ static float VectorDistance(vec3_t p1, vec3_t p2)
 #endif
 
 static void SV_ClipMoveToEntities( moveclip_t *clip ) {
-	static int	touchlist[MAX_GENTITIES];
+	static thread_local int	touchlist[MAX_GENTITIES];
 	int			i, num;
 	sharedEntity_t *touch;
 	int			passOwnerNum;
@@ -727,6 +1039,100 @@ void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const ve
 	*results = clip.trace;
 }
 
+// TRACE BATCHES
+
+#define	TRACE_BATCH_CHUNK	16
+
+struct traceBatchEntry_t {
+	int		leaf;
+	int		index;
+};
+
+struct traceBatch_t {
+	trace_t					*results;
+	const traceRequest_t	*requests;
+	const traceBatchEntry_t	*entries;
+	int						count;
+};
+
+static int QDECL SV_QsortTraceBatchEntries( const void *a, const void *b ) {
+	const traceBatchEntry_t *ea = (const traceBatchEntry_t *)a;
+	const traceBatchEntry_t *eb = (const traceBatchEntry_t *)b;
+
+	if ( ea->leaf != eb->leaf ) {
+		return ea->leaf - eb->leaf;
+	}
+	return ea->index - eb->index;
+}
+
+static void SV_TraceBatchEntry( const traceBatch_t *batch, int entry ) {
+	int						index = batch->entries[entry].index;
+	const traceRequest_t	*r = &batch->requests[index];
+
+	SV_Trace( &batch->results[index], r->start, r->mins, r->maxs, r->end, r->passEntityNum, r->contentmask,
+		r->capsule, r->traceFlags, r->useLod );
+}
+
+static void SV_TraceBatchJob( int chunk, void *data ) {
+	const traceBatch_t	*batch = (const traceBatch_t *)data;
+	int					i, last;
+
+	last = (chunk + 1) * TRACE_BATCH_CHUNK;
+	if ( last > batch->count ) {
+		last = batch->count;
+	}
+	for ( i = chunk * TRACE_BATCH_CHUNK ; i < last ; i++ ) {
+		SV_TraceBatchEntry( batch, i );
+	}
+}
+
+// Runs every request as SV_Trace would, results[i] is the trace of requests[i].
+// Requests are run grouped by the leaf their start point is in, so rays through the same part of the tree run back
+//	to back, and are spread over the job threads. Ghoul2 collision is not thread safe, so those run here afterwards.
+void SV_TraceBatch( trace_t *results, const traceRequest_t *requests, int count ) {
+	static traceBatchEntry_t	*entries;
+	static int					maxEntries;
+	traceBatch_t				batch;
+	int							i, numWorld, numGhoul2;
+
+	if ( count <= 0 ) {
+		return;
+	}
+
+	if ( count > maxEntries ) {
+		if ( entries ) {
+			Z_Free( entries );
+		}
+		maxEntries = count;
+		entries = (traceBatchEntry_t *)Z_Malloc( maxEntries * sizeof(traceBatchEntry_t), TAG_GENERAL, false );
+	}
+
+	// ghoul2 traces go to the end of the list, outside the sorted part
+	numWorld = numGhoul2 = 0;
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( requests[i].traceFlags & G2TRFLAG_DOGHOULTRACE ) {
+			entries[count - ++numGhoul2].index = i;
+		} else {
+			entries[numWorld].leaf = CM_PointLeafnum( requests[i].start );
+			entries[numWorld].index = i;
+			numWorld++;
+		}
+	}
+	qsort( entries, numWorld, sizeof(traceBatchEntry_t), SV_QsortTraceBatchEntries );
+
+	batch.results = results;
+	batch.requests = requests;
+	batch.entries = entries;
+	batch.count = numWorld;
+
+	Com_ParallelFor( (numWorld + TRACE_BATCH_CHUNK - 1) / TRACE_BATCH_CHUNK, SV_TraceBatchJob, &batch );
+
+	// ghoul2 ones in request order
+	for ( i = count - 1 ; i >= numWorld ; i-- ) {
+		SV_TraceBatchEntry( &batch, i );
+	}
+}
+
 // returns the CONTENTS_* value from the world and all entities at the given point.
 int SV_PointContents( const vec3_t p, int passEntityNum ) {
 	int			touch[MAX_GENTITIES];
@@ -33,7 +33,9 @@ enum netadrtype_e {
 	NA_BOT,
 	NA_LOOPBACK,
 	NA_BROADCAST,
-	NA_IP
+	NA_IP,
+	NA_IP6,
+	NA_UNSPEC // only used to ask for either family when resolving a name
 };
 
 enum joystickAxis_e {
@@ -79,7 +81,9 @@ enum glContextFlag_e : uint32_t {
 struct netadr_t {
 	netadrtype_e type;
 	byte         ip[4];
+	byte         ip6[16];
 	uint16_t     port;
+	uint32_t     scope_id; // needed for ipv6 link-local addresses
 };
 
 struct sysEvent_t {
@@ -90,6 +94,9 @@ struct sysEvent_t {
 	void           *evPtr;			// this must be manually freed if not nullptr
 };
 
+// A file read in blocks at given offsets, so one handle can serve several readers at once
+struct sysSharedFile_t;
+
 // Graphics API
 struct window_t {
 	void          *handle; // OS-dependent window handle
@@ -130,6 +137,7 @@ extern "C" {
 
 uint8_t               ConvertUTF32ToExpectedCharset( uint32_t utf32 );
 const char           *Sys_Basename                 ( char *path );
+void                  Sys_CloseSharedFile          ( sysSharedFile_t *file );
 char                 *Sys_Cwd                      ( void );
 #ifdef MACOS_X
 char                 *Sys_DefaultAppPath           ( void );
@@ -153,17 +161,19 @@ bool                  Sys_LowPhysicalMemory        ( void );
 int                   Sys_Milliseconds             ( bool baseTime = false );
 int                   Sys_Milliseconds2            ( void );
 bool                  Sys_Mkdir                    ( const char *path );
+sysSharedFile_t      *Sys_OpenSharedFile           ( const char *path, int *length );
 bool                  Sys_PathCmp                  ( const char *path1, const char *path2 );
 void                  Sys_Print                    ( const char *msg );
 void NORETURN         Sys_Quit                     ( void );
 bool                  Sys_RandomBytes              ( byte *string, int len );
+int                   Sys_ReadSharedFile           ( sysSharedFile_t *file, int offset, void *buffer, int length );
 void                  Sys_SendPacket               ( int length, const void *data, netadr_t to );
 void                  Sys_SetDefaultInstallPath    ( const char *path );
 void                  Sys_SetErrorText             ( const char *text );
 void                  Sys_SetProcessorAffinity     ( void );
 void                  Sys_ShowIP                   ( void );
 void                  Sys_Sleep                    ( int msec );
-bool                  Sys_StringToAdr              ( const char *s, netadr_t *a );
+bool                  Sys_StringToAdr              ( const char *s, netadr_t *a, netadrtype_e family = NA_UNSPEC );
 void                  Sys_UnloadDll                ( void *dllHandle );
 bool                  WIN_GL_ExtensionSupported    ( const char *extension );
 void                 *WIN_GL_GetProcAddress        ( const char *proc );
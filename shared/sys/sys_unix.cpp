@@ -77,11 +77,12 @@ unsigned long sys_timeBase = 0;
    NOTE: sys_timeBase*1000 + curtime -> ms since the Epoch
      0x7fffffff ms - ~24 days
    although timeval:tv_usec is an int, I'm not sure wether it is actually used as an unsigned int
-     (which would affect the wrap period) */
-int curtime;
+     (which would affect the wrap period)
+   kept local, the network receive thread reads the clock too */
 int Sys_Milliseconds (bool baseTime)
 {
 	struct timeval tp;
+	int curtime;
 
 	gettimeofday(&tp, nullptr);
 
@@ -410,6 +411,86 @@ bool Sys_Mkdir( const char *path )
 	return true;
 }
 
+struct sysSharedFile_t {
+	int		fd;
+	int		length;
+};
+
+/*
+==================
+Sys_OpenSharedFile
+
+Opens a file for reading in blocks, returns nullptr if it can't be opened. Nothing is mapped or loaded, each
+block is read with pread when it's wanted, so a file truncated under it just reads short.
+==================
+*/
+sysSharedFile_t *Sys_OpenSharedFile( const char *path, int *length )
+{
+	struct stat		buf;
+	sysSharedFile_t	*file;
+	int				fd;
+
+	fd = open( path, O_RDONLY );
+	if( fd == -1 )
+		return nullptr;
+
+	if( fstat( fd, &buf ) == -1 || !S_ISREG( buf.st_mode ) || buf.st_size > INT_MAX )
+	{
+		close( fd );
+		return nullptr;
+	}
+
+	file = (sysSharedFile_t *)malloc( sizeof( *file ) );
+	if( !file )
+	{
+		close( fd );
+		return nullptr;
+	}
+	file->fd = fd;
+	file->length = (int)buf.st_size;
+
+	*length = file->length;
+	return file;
+}
+
+/*
+==================
+Sys_ReadSharedFile
+
+Returns the number of bytes read, less than length past the end of the file or on an error
+==================
+*/
+int Sys_ReadSharedFile( sysSharedFile_t *file, int offset, void *buffer, int length )
+{
+	ssize_t	r;
+	int		total;
+
+	for( total = 0; total < length; total += (int)r )
+	{
+		r = pread( file->fd, (byte *)buffer + total, length - total, (off_t)offset + total );
+		if( r == -1 && errno == EINTR )
+		{
+			r = 0;
+			continue;
+		}
+		if( r <= 0 )
+			break;
+	}
+
+	return total;
+}
+
+/*
+==================
+Sys_CloseSharedFile
+==================
+*/
+void Sys_CloseSharedFile( sysSharedFile_t *file )
+{
+	close( file->fd );
+	free( file );
+}
+
 char *Sys_Cwd( void )
 {
 	static char cwd[MAX_OSPATH];
@@ -260,6 +260,74 @@ bool Sys_Mkdir( const char *path ) {
 	return true;
 }
 
+struct sysSharedFile_t {
+	HANDLE	file;
+	int		length;
+};
+
+/*
+==============
+Sys_OpenSharedFile
+
+Opens a file for reading in blocks, returns nullptr if it can't be opened. Nobody can write to it while it's open.
+==============
+*/
+sysSharedFile_t *Sys_OpenSharedFile( const char *path, int *length ) {
+	HANDLE			handle;
+	LARGE_INTEGER	size;
+	sysSharedFile_t	*file;
+
+	handle = CreateFile( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	if ( handle == INVALID_HANDLE_VALUE )
+		return nullptr;
+
+	if ( !GetFileSizeEx( handle, &size ) || size.QuadPart > INT_MAX ) {
+		CloseHandle( handle );
+		return nullptr;
+	}
+
+	file = (sysSharedFile_t *)malloc( sizeof( *file ) );
+	if ( !file ) {
+		CloseHandle( handle );
+		return nullptr;
+	}
+	file->file = handle;
+	file->length = (int)size.QuadPart;
+
+	*length = file->length;
+	return file;
+}
+
+/*
+==============
+Sys_ReadSharedFile
+
+Returns the number of bytes read, less than length past the end of the file or on an error
+==============
+*/
+int Sys_ReadSharedFile( sysSharedFile_t *file, int offset, void *buffer, int length ) {
+	OVERLAPPED	ov;
+	DWORD		read;
+
+	// the offset in the OVERLAPPED makes it a positional read, the handle has no position to share
+	memset( &ov, 0, sizeof( ov ) );
+	ov.Offset = (DWORD)offset;
+	if ( !ReadFile( file->file, buffer, (DWORD)length, &read, &ov ) )
+		return 0;
+
+	return (int)read;
+}
+
+/*
+==============
+Sys_CloseSharedFile
+==============
+*/
+void Sys_CloseSharedFile( sysSharedFile_t *file ) {
+	CloseHandle( file->file );
+	free( file );
+}
+
 /*
 ==============
 Sys_Cwd